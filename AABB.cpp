@@ -1,5 +1,6 @@
 #include "AABB.h"
 #include "Sphere.h"
+#include <algorithm>
 
 
 bool AABB::containsPoint(const QVector3D &point) const
@@ -28,7 +29,13 @@ bool AABB::intersectsSphere(const Sphere &sphere) const
 
 bool AABB::intersectsAABB(const AABB &boundingBox) const
 {
-    return (mMin.x() <= boundingBox.mMax.x() && mMax.x() <= boundingBox.mMin.x() &&
-            mMin.y() <= boundingBox.mMax.y() && mMax.y() <= boundingBox.mMin.y() &&
-            mMin.z() <= boundingBox.mMax.z() && mMax.z() <= boundingBox.mMin.z());
+    return (mMin.x() <= boundingBox.mMax.x() && mMax.x() >= boundingBox.mMin.x() &&
+            mMin.y() <= boundingBox.mMax.y() && mMax.y() >= boundingBox.mMin.y() &&
+            mMin.z() <= boundingBox.mMax.z() && mMax.z() >= boundingBox.mMin.z());
+}
+
+AABB AABB::merged(const AABB &boundingBox) const
+{
+    return AABB(QVector3D(std::min(mMin.x(), boundingBox.mMin.x()), std::min(mMin.y(), boundingBox.mMin.y()), std::min(mMin.z(), boundingBox.mMin.z())),
+                QVector3D(std::max(mMax.x(), boundingBox.mMax.x()), std::max(mMax.y(), boundingBox.mMax.y()), std::max(mMax.z(), boundingBox.mMax.z())));
 }
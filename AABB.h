@@ -20,6 +20,8 @@ public:
     bool containsPoint(const QVector3D& point) const;
     bool intersectsSphere(const Sphere& sphere) const;
     bool intersectsAABB(const AABB& boundingBox) const;
+    // The smallest box around both
+    AABB merged(const AABB& boundingBox) const;
 };
 
 #endif // AABB_H
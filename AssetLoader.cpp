@@ -0,0 +1,79 @@
+#include "AssetLoader.h"
+#include <algorithm>
+
+AssetLoader::AssetLoader(unsigned threadCount)
+{
+    threadCount = std::max(1u, threadCount);
+    for (unsigned i = 0; i < threadCount; ++i)
+        mWorkers.emplace_back(&AssetLoader::workerLoop, this);
+}
+
+AssetLoader::~AssetLoader()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+        mJobs.clear();  // Unstarted jobs are dropped, their futures report a broken promise
+    }
+    mWake.notify_all();
+    for (std::thread& worker : mWorkers) worker.join();
+
+    // Nobody will run these anymore
+    RenderTask* task = mRenderTasks.exchange(nullptr, std::memory_order_acquire);
+    while (task) {
+        RenderTask* next = task->next;
+        delete task;
+        task = next;
+    }
+}
+
+void AssetLoader::postToRenderThread(std::function<void()> function)
+{
+    RenderTask* task = new RenderTask{ std::move(function), mRenderTasks.load(std::memory_order_relaxed) };
+    // On failure the CAS writes the current head into task->next, so just try again
+    while (!mRenderTasks.compare_exchange_weak(task->next, task, std::memory_order_release, std::memory_order_relaxed)) {}
+}
+
+int AssetLoader::runRenderThreadTasks()
+{
+    // Cheap check first, this is called every frame and is usually empty
+    if (!mRenderTasks.load(std::memory_order_relaxed)) return 0;
+
+    RenderTask* task = mRenderTasks.exchange(nullptr, std::memory_order_acquire);
+
+    // The list is newest first, reverse it so tasks run in the order they were posted
+    RenderTask* ordered = nullptr;
+    while (task) {
+        RenderTask* next = task->next;
+        task->next = ordered;
+        ordered = task;
+        task = next;
+    }
+
+    int count = 0;
+    while (ordered) {
+        RenderTask* next = ordered->next;
+        ordered->function();
+        delete ordered;
+        ordered = next;
+        ++count;
+    }
+    return count;
+}
+
+void AssetLoader::workerLoop()
+{
+    while (true)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mWake.wait(lock, [this]() { return mStopping || !mJobs.empty(); });
+            if (mStopping) return;
+            job = std::move(mJobs.front());
+            mJobs.pop_front();
+        }
+        job();
+        --mPendingJobs;
+    }
+}
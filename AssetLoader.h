@@ -0,0 +1,70 @@
+#ifndef ASSETLOADER_H
+#define ASSETLOADER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs asset loading off the GUI thread
+// CPU work (reading files, parsing, triangulating, decoding images) goes to a pool of worker threads through submit(),
+// anything that touches Vulkan is handed back with postToRenderThread() and runs in Renderer::startNextFrame()
+class AssetLoader
+{
+public:
+    explicit AssetLoader(unsigned threadCount = 4);
+    ~AssetLoader();
+
+    AssetLoader(const AssetLoader&) = delete;
+    AssetLoader& operator=(const AssetLoader&) = delete;
+
+    // Runs function on a worker, the future holds its result (or the exception it threw)
+    template <typename Function>
+    auto submit(Function function) -> std::future<decltype(function())>
+    {
+        using Result = decltype(function());
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::move(function));
+        std::future<Result> future = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mJobs.emplace_back([task]() { (*task)(); });
+            ++mPendingJobs;
+        }
+        mWake.notify_one();
+        return future;
+    }
+
+    // Safe to call from any thread, never blocks
+    void postToRenderThread(std::function<void()> task);
+    // Render thread only: runs everything posted so far in posting order, returns how many tasks ran
+    int runRenderThreadTasks();
+
+    // Jobs submitted but not finished yet
+    int pendingJobs() const { return mPendingJobs.load(); }
+
+private:
+    void workerLoop();
+
+    std::vector<std::thread> mWorkers;
+    std::mutex mMutex;
+    std::condition_variable mWake;
+    std::deque<std::function<void()>> mJobs;
+    bool mStopping{false};
+    std::atomic<int> mPendingJobs{0};
+
+    // Lock-free list of render thread tasks. Producers push onto the head with a CAS loop,
+    // the render thread takes the whole list with one exchange and reverses it to get the posting order back
+    struct RenderTask
+    {
+        std::function<void()> function;
+        RenderTask* next{nullptr};
+    };
+    std::atomic<RenderTask*> mRenderTasks{nullptr};
+};
+
+#endif // ASSETLOADER_H
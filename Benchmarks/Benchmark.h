@@ -0,0 +1,109 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+#include "Vertex.h"
+
+// Small helpers shared by the benchmark suites, there is no benchmark framework in the build
+namespace Benchmark
+{
+
+// Runs function repeats times and returns the fastest run in seconds, the fastest run is the least disturbed by the rest of the system
+inline double Time(const std::function<void()>& function, int repeats = 3)
+{
+    double best = 1e30;
+    for (int i = 0; i < repeats; ++i)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        function();
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+// count points spread evenly over a size x size square in XZ with a gentle height field, roughly what a decimated terrain looks like
+inline std::vector<Vertex> UniformTerrain(size_t count, float size = 1000.0f, unsigned seed = 1)
+{
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> coordinate(0.0f, size);
+    std::vector<Vertex> points(count);
+    for (Vertex& v : points)
+    {
+        const float x = coordinate(random), z = coordinate(random);
+        v = Vertex(x, 20.0f * std::sin(x * 0.01f) * std::cos(z * 0.013f), z, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+    }
+    return points;
+}
+
+// The rest is defined in BenchmarkMain.cpp, which replaces the global operator new to count allocations
+// Aligned allocations (over-aligned types) go around the count, nothing in the point code uses them
+size_t AllocationCount();
+size_t AllocatedBytes();
+// Peak resident set size of the process in bytes, 0 where it can't be read. ResetPeakMemory() brings the peak down to the current
+// size on Linux, elsewhere it stays the peak of the whole process so far and only says something about the largest run
+size_t PeakMemory();
+void ResetPeakMemory();
+// The file given with --points, empty when there was none
+const std::string& PointsFile();
+
+// What a run cost, see Measure()
+struct Measurement
+{
+    double seconds{0.0};
+    size_t peakMemory{0};
+    size_t allocations{0};
+    size_t allocatedBytes{0};
+};
+
+// Every printed row, written out as JSON with --json
+struct Row
+{
+    std::string suite;
+    std::string name;
+    size_t count{0};
+    Measurement measurement;
+    bool hasMemory{false};
+    std::string extra;
+};
+void Record(const Row& row);
+
+// Peak memory and allocations of the first run, and the fastest of repeats runs like Time()
+inline Measurement Measure(const std::function<void()>& function, int repeats = 1)
+{
+    ResetPeakMemory();
+    const size_t allocations = AllocationCount(), bytes = AllocatedBytes();
+    Measurement measurement;
+    measurement.seconds = Time(function, 1);
+    measurement.peakMemory = PeakMemory();
+    measurement.allocations = AllocationCount() - allocations;
+    measurement.allocatedBytes = AllocatedBytes() - bytes;
+    if (repeats > 1) measurement.seconds = std::min(measurement.seconds, Time(function, repeats - 1));
+    return measurement;
+}
+
+inline void PrintRow(const std::string& suite, const std::string& name, size_t count, double seconds, const std::string& extra = std::string())
+{
+    std::printf("%-14s %-28s %12zu %10.3f ms %14.0f /s %s\n", suite.c_str(), name.c_str(), count, seconds * 1000.0, count / seconds, extra.c_str());
+    Measurement measurement;
+    measurement.seconds = seconds;
+    Record(Row{ suite, name, count, measurement, false, extra });
+}
+
+inline void PrintRow(const std::string& suite, const std::string& name, size_t count, const Measurement& measurement, const std::string& extra = std::string())
+{
+    std::printf("%-14s %-28s %12zu %10.3f ms %14.0f /s %9.1f MB peak %10zu allocations %s\n", suite.c_str(), name.c_str(), count,
+                measurement.seconds * 1000.0, count / measurement.seconds, measurement.peakMemory / 1048576.0, measurement.allocations, extra.c_str());
+    Record(Row{ suite, name, count, measurement, true, extra });
+}
+
+}
+
+#endif // BENCHMARK_H
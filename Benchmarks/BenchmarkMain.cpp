@@ -0,0 +1,181 @@
+#include <cstdio>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <new>
+#include <string>
+#include <vector>
+#include "Benchmark.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+// Standalone benchmarks for the point processing code, run without a window or a Vulkan device
+// Usage: Benchmarks [--json results.json] [--points cloud.las] [suite ...], runs every suite when none are named
+// --json writes every row to a file as well, so runs before and after a change can be compared by a script
+// --points is the real point set for the triangulation suite, Assets/lasdata.txt when not given
+
+int RunKdTreeBenchmark();
+int RunNormalsBenchmark();
+int RunDelaunayBenchmark();
+int RunTriangulationBenchmark();
+int RunChangeDetectionBenchmark();
+int RunSimplificationBenchmark();
+int RunLocateBenchmark();
+int RunOctreeBenchmark();
+int RunCollisionBenchmark();
+int RunRasterizeBenchmark();
+int RunEditBenchmark();
+
+namespace
+{
+
+std::atomic<size_t> gAllocations{0};
+std::atomic<size_t> gAllocatedBytes{0};
+std::vector<Benchmark::Row> gRows;
+std::string gPointsFile;
+
+std::string Escape(const std::string& text)
+{
+    std::string escaped;
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\') escaped += '\\';
+        escaped += c;
+    }
+    return escaped;
+}
+
+bool WriteJson(const std::string& filename)
+{
+    std::ofstream file(filename);
+    if (!file) return false;
+    file << "{\n  \"results\": [";
+    for (size_t i = 0; i < gRows.size(); ++i)
+    {
+        const Benchmark::Row& row = gRows[i];
+        file << (i ? ",\n" : "\n") << "    { \"suite\": \"" << Escape(row.suite) << "\", \"name\": \"" << Escape(row.name) << "\", \"count\": " << row.count
+             << ", \"seconds\": " << row.measurement.seconds << ", \"perSecond\": " << row.count / row.measurement.seconds;
+        if (row.hasMemory)
+            file << ", \"peakMemory\": " << row.measurement.peakMemory << ", \"allocations\": " << row.measurement.allocations
+                 << ", \"allocatedBytes\": " << row.measurement.allocatedBytes;
+        file << ", \"extra\": \"" << Escape(row.extra) << "\" }";
+    }
+    file << "\n  ]\n}\n";
+    return static_cast<bool>(file);
+}
+
+}
+
+// Counts every allocation for Benchmark::Measure(), the array and nothrow forms end up here as well
+void* operator new(std::size_t size)
+{
+    gAllocations.fetch_add(1, std::memory_order_relaxed);
+    gAllocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size ? size : 1)) return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+size_t Benchmark::AllocationCount()
+{
+    return gAllocations.load(std::memory_order_relaxed);
+}
+
+size_t Benchmark::AllocatedBytes()
+{
+    return gAllocatedBytes.load(std::memory_order_relaxed);
+}
+
+size_t Benchmark::PeakMemory()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return counters.PeakWorkingSetSize;
+    return 0;
+#elif defined(__APPLE__)
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) return static_cast<size_t>(usage.ru_maxrss); // Bytes on macOS
+    return 0;
+#else
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+        if (line.compare(0, 6, "VmHWM:") == 0) return std::strtoull(line.c_str() + 6, nullptr, 10) * 1024;
+    return 0;
+#endif
+}
+
+void Benchmark::ResetPeakMemory()
+{
+#if defined(__linux__)
+    // Writing 5 resets the peak to the current resident size, Linux 4.0 and later
+    std::ofstream("/proc/self/clear_refs") << "5";
+#endif
+}
+
+const std::string& Benchmark::PointsFile()
+{
+    return gPointsFile;
+}
+
+void Benchmark::Record(const Row& row)
+{
+    gRows.push_back(row);
+}
+
+int main(int argc, char* argv[])
+{
+    const std::vector<std::pair<std::string, std::function<int()>>> suites = {
+        { "kdtree", RunKdTreeBenchmark },
+        { "normals", RunNormalsBenchmark },
+        { "delaunay", RunDelaunayBenchmark },
+        { "triangulation", RunTriangulationBenchmark },
+        { "change", RunChangeDetectionBenchmark },
+        { "simplify", RunSimplificationBenchmark },
+        { "locate", RunLocateBenchmark },
+        { "octree", RunOctreeBenchmark },
+        { "collision", RunCollisionBenchmark },
+        { "rasterize", RunRasterizeBenchmark },
+        { "edits", RunEditBenchmark },
+    };
+
+    std::vector<std::string> selected;
+    std::string json;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string argument = argv[i];
+        if ((argument == "--json" || argument == "--points") && i + 1 < argc) (argument == "--json" ? json : gPointsFile) = argv[++i];
+        else selected.push_back(argument);
+    }
+
+    int result = 0;
+    for (const auto& [name, run] : suites)
+    {
+        if (!selected.empty() && std::find(selected.begin(), selected.end(), name) == selected.end()) continue;
+        std::printf("--- %s\n", name.c_str());
+        result |= run();
+    }
+
+    if (!json.empty() && !WriteJson(json))
+    {
+        std::printf("ERROR: could not write %s\n", json.c_str());
+        result = 1;
+    }
+    return result;
+}
@@ -0,0 +1,25 @@
+#include "Benchmark.h"
+#include "ChangeDetection.h"
+#include "KdTree.h"
+#include "Parallel.h"
+
+// Cloud to cloud distances between two surveys of the same terrain, the second one sampled with a different seed and lifted a little
+int RunChangeDetectionBenchmark()
+{
+    for (size_t count : { size_t(1000000), size_t(10000000), size_t(30000000) })
+    {
+        const std::vector<Vertex> reference = Benchmark::UniformTerrain(count, 1000.0f, 1);
+        std::vector<Vertex> compared = Benchmark::UniformTerrain(count, 1000.0f, 2);
+        for (Vertex& v : compared) v.y += 0.5f;
+
+        KdTree tree;
+        Benchmark::PrintRow("change", "reference tree build", count, Benchmark::Time([&]() { tree.build(reference); }, 1));
+
+        std::vector<float> distances;
+        const double seconds = Benchmark::Time([&]() { ChangeDetection::CloudToCloud(compared, tree, distances); }, 1);
+        double mean = 0.0;
+        for (float distance : distances) mean += distance;
+        Benchmark::PrintRow("change", "c2c", count, seconds, std::to_string(Parallel::ThreadCount()) + " threads, mean " + std::to_string(mean / count).substr(0, 5));
+    }
+    return 0;
+}
@@ -0,0 +1,182 @@
+#include "Benchmark.h"
+#include "Bvh.h"
+#include "Delaunay.h"
+#include "Octree.h"
+#include "Sphere.h"
+#include "Triangle.h"
+
+namespace
+{
+
+// A scan is dense under trees and around buildings and sparse on open ground: a tenth of the points spread out, the rest in clusters
+std::vector<Vertex> ClusteredTerrain(size_t count, float size)
+{
+    std::mt19937 random(5);
+    std::uniform_real_distribution<float> coordinate(0.0f, size);
+    std::vector<QVector2D> centers(std::max<size_t>(1, count / 5000));
+    for (QVector2D& center : centers)
+    {
+        const float x = coordinate(random);
+        center = QVector2D(x, coordinate(random));
+    }
+    std::normal_distribution<float> offset(0.0f, size / 200.0f);
+    std::uniform_int_distribution<size_t> cluster(0, centers.size() - 1);
+    std::vector<Vertex> points(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        float x = coordinate(random), z = coordinate(random);
+        if (i % 10) {
+            const QVector2D& center = centers[cluster(random)];
+            x = std::clamp(center.x() + offset(random), 0.0f, size);
+            z = std::clamp(center.y() + offset(random), 0.0f, size);
+        }
+        points[i] = Vertex(x, 20.0f * std::sin(x * 0.01f) * std::cos(z * 0.013f), z, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+    }
+    return points;
+}
+
+// The collision triangles PointCloud makes of the points
+std::vector<Triangle> Triangulated(const std::vector<Vertex>& points)
+{
+    std::vector<QVector2D> positions(points.size());
+    for (size_t i = 0; i < points.size(); ++i) positions[i] = points[i].poXZ();
+    std::vector<uint32_t> indices;
+    Delaunay::TriangulateTiled(positions, indices);
+
+    std::vector<Triangle> triangles;
+    triangles.reserve(indices.size() / 3);
+    for (size_t i = 0; i < indices.size(); i += 3) triangles.emplace_back(points[indices[i]], points[indices[i + 1]], points[indices[i + 2]]);
+    return triangles;
+}
+
+// Runs query for every sphere and prints the time with the candidates per query, which is what the sweep tests in PhysicsSystem pay for
+template <typename Query>
+void QueryRow(const std::string& name, const std::vector<Sphere>& spheres, Query query)
+{
+    std::vector<int> hits;
+    size_t hitCount = 0;
+    const double seconds = Benchmark::Time([&]()
+    {
+        hitCount = 0;
+        for (const Sphere& sphere : spheres) {
+            hits.clear();
+            query(sphere, hits);
+            hitCount += hits.size();
+        }
+    });
+    Benchmark::PrintRow("collision", name, spheres.size(), seconds, "avg " + std::to_string(hitCount / double(spheres.size())).substr(0, 5) + " candidates");
+}
+
+// A survey update like Renderer::applyEdits() makes: a thousandth of the triangles move up, half as many go and as many come
+// Both indices are patched with update() and have to touch the same triangles as a Bvh built again without the removed ones
+bool UpdateRows(const std::string& set, std::vector<Triangle>& triangles, Octree& octree, Bvh& bvh, double octreeBuild, double bvhBuild)
+{
+    const size_t editCount = std::max<size_t>(2, triangles.size() / 1000);
+    std::mt19937 random(7);
+    std::uniform_int_distribution<size_t> pick(0, triangles.size() - 1);
+    std::vector<bool> taken(triangles.size(), false);
+    std::vector<int> changed, added, removed;
+    while (changed.size() + removed.size() < editCount + editCount / 2)
+    {
+        const size_t t = pick(random);
+        if (taken[t]) continue;
+        taken[t] = true;
+        (changed.size() < editCount ? changed : removed).push_back(static_cast<int>(t));
+    }
+    auto lifted = [](const Triangle& triangle, float height)
+    {
+        const QVector3D up(0.0f, height, 0.0f);
+        return Triangle(triangle.v0 + up, triangle.v1 + up, triangle.v2 + up);
+    };
+    for (int t : changed) triangles[t] = lifted(triangles[t], 0.5f);
+    for (size_t i = 0; i < editCount / 2; ++i)
+    {
+        triangles.push_back(lifted(triangles[pick(random)], 1.0f));
+        added.push_back(static_cast<int>(triangles.size() - 1));
+    }
+
+    bool patched = true;
+    const size_t edits = changed.size() + added.size() + removed.size();
+    const double octreeUpdate = Benchmark::Time([&]() { patched &= octree.update(changed, added, removed); }, 1);
+    Benchmark::PrintRow("collision", set + "octree update", edits, octreeUpdate, std::to_string(octreeBuild / octreeUpdate).substr(0, 5) + "x quicker than a build");
+    const double bvhUpdate = Benchmark::Time([&]() { patched &= bvh.update(changed, added, removed); }, 1);
+    Benchmark::PrintRow("collision", set + "bvh update", edits, bvhUpdate, std::to_string(bvhBuild / bvhUpdate).substr(0, 5) + "x quicker than a build");
+
+    // Balls on every edited triangle, the candidates cut down to those whose bounds the ball touches are the same whatever the index
+    Bvh fresh(triangles);
+    fresh.build(removed);
+    std::vector<Sphere> spheres;
+    for (const std::vector<int>* edited : { &changed, &added, &removed })
+        for (int t : *edited) spheres.emplace_back((triangles[t].v0 + triangles[t].v1 + triangles[t].v2) / 3.0f, QVector3D(), 1.0f);
+    auto touched = [&](auto& index, const Sphere& sphere)
+    {
+        std::vector<int> hits;
+        index.query(sphere, hits);
+        hits.erase(std::remove_if(hits.begin(), hits.end(), [&](int t) { return !TriangleHelpers::TriangleBounds(triangles[t]).intersectsSphere(sphere); }), hits.end());
+        std::sort(hits.begin(), hits.end());
+        return hits;
+    };
+    size_t mismatches = 0;
+    for (const Sphere& sphere : spheres)
+    {
+        const std::vector<int> expected = touched(fresh, sphere);
+        mismatches += touched(octree, sphere) != expected;
+        mismatches += touched(bvh, sphere) != expected;
+    }
+    if (!patched || mismatches)
+    {
+        std::printf("ERROR: %supdate %s, %zu of %zu queries differ from a new build\n", set.c_str(), patched ? "done" : "refused", mismatches, 2 * spheres.size());
+        return false;
+    }
+    return true;
+}
+
+}
+
+// Octree against Bvh over the same triangles, the two indices PhysicsSystem can pick between
+// The balls sit on points of the cloud, so dense areas get asked about as often as they are dense, like things dropped on a scan
+// Then both are patched for a batch of edits, see UpdateRows()
+int RunCollisionBenchmark()
+{
+    bool correct = true;
+    for (size_t pointCount : { size_t(50000), size_t(500000), size_t(2000000) })
+    {
+        const float size = 1000.0f * std::sqrt(pointCount / 1e6f);
+        for (bool clustered : { false, true })
+        {
+            const std::vector<Vertex> points = clustered ? ClusteredTerrain(pointCount, size) : Benchmark::UniformTerrain(pointCount, size);
+            std::vector<Triangle> triangles = Triangulated(points);
+            const std::string set = clustered ? "clustered " : "uniform ";
+
+            Octree octree(triangles, AABB(QVector3D(0.0f, -20.0f, 0.0f), QVector3D(size, 20.0f, size)));
+            Bvh bvh(triangles);
+            const Benchmark::Measurement octreeBuild = Benchmark::Measure([&]() { octree.build(); });
+            Benchmark::PrintRow("collision", set + "octree build", triangles.size(), octreeBuild, std::to_string(octree.nodeCount()) + " nodes");
+            const Benchmark::Measurement bvhBuild = Benchmark::Measure([&]() { bvh.build(); });
+            Benchmark::PrintRow("collision", set + "bvh build", triangles.size(), bvhBuild, std::to_string(bvh.nodeCount()) + " nodes");
+
+            const size_t queryCount = 100000;
+            std::vector<Sphere> spheres;
+            spheres.reserve(queryCount);
+            for (size_t i = 0; i < queryCount; ++i) spheres.emplace_back(points[(i * 7919) % points.size()].pos(), QVector3D(), 1.0f);
+
+            QueryRow(set + "octree sphere", spheres, [&](const Sphere& sphere, std::vector<int>& hits) { octree.query(sphere, hits); });
+            QueryRow(set + "bvh sphere", spheres, [&](const Sphere& sphere, std::vector<int>& hits) { bvh.query(sphere, hits); });
+            QueryRow(set + "octree box", spheres, [&](const Sphere& sphere, std::vector<int>& hits)
+            {
+                octree.query(AABB(sphere.mPosition - QVector3D(1.0f, 1.0f, 1.0f), sphere.mPosition + QVector3D(1.0f, 1.0f, 1.0f)), hits);
+            });
+            QueryRow(set + "bvh box", spheres, [&](const Sphere& sphere, std::vector<int>& hits)
+            {
+                bvh.query(AABB(sphere.mPosition - QVector3D(1.0f, 1.0f, 1.0f), sphere.mPosition + QVector3D(1.0f, 1.0f, 1.0f)), hits);
+            });
+            // Straight down from above the terrain, the octree has no ray query
+            QueryRow(set + "bvh ray", spheres, [&](const Sphere& sphere, std::vector<int>& hits)
+            {
+                bvh.query(QVector3D(sphere.mPosition.x(), 50.0f, sphere.mPosition.z()), QVector3D(0.0f, -1.0f, 0.0f), 100.0f, hits);
+            });
+            correct &= UpdateRows(set, triangles, octree, bvh, octreeBuild.seconds, bvhBuild.seconds);
+        }
+    }
+    return correct ? 0 : 1;
+}
@@ -0,0 +1,58 @@
+#include "Benchmark.h"
+#include "Delaunay.h"
+#include "Parallel.h"
+
+namespace
+{
+
+// Both give a triangulation of the same distinct points, so the counts match whatever they chose between cocircular points
+bool Run(const std::string& set, const std::vector<QVector2D>& points)
+{
+    const std::string threads = std::to_string(Parallel::ThreadCount()) + " threads";
+    std::vector<uint32_t> indices;
+    const double serial = Benchmark::Time([&]() { indices.clear(); Delaunay::Triangulate(points, indices); }, 1);
+    const size_t serialTriangles = indices.size() / 3;
+    Benchmark::PrintRow("delaunay", set + " serial", points.size(), serial, std::to_string(serialTriangles) + " triangles");
+    indices = {};
+
+    const double parallel = Benchmark::Time([&]() { indices.clear(); Delaunay::TriangulateTiled(points, indices); }, 1);
+    Benchmark::PrintRow("delaunay", set + " parallel", points.size(), parallel, threads + ", " + std::to_string(indices.size() / 3) + " triangles, "
+                        + std::to_string(serial / parallel).substr(0, 4) + "x serial");
+    if (indices.size() / 3 != serialTriangles)
+    {
+        std::printf("ERROR: %s parallel gave %zu triangles, serial %zu\n", set.c_str(), indices.size() / 3, serialTriangles);
+        return false;
+    }
+    return true;
+}
+
+}
+
+// One sweep over everything against the tiled triangulation, the tiled one scales with the thread count
+// The points are generated straight into 2D, 50M points as Vertex would take 1.6 GB before the triangulation even starts
+int RunDelaunayBenchmark()
+{
+    bool matches = true;
+    for (size_t count : { size_t(100000), size_t(1000000), size_t(10000000), size_t(50000000) })
+    {
+        // Same density as UniformTerrain at 1M points, so the tiles are the same size at every count
+        const float size = 1000.0f * std::sqrt(count / 1e6f);
+        std::mt19937 random(1);
+        std::uniform_real_distribution<float> coordinate(0.0f, size);
+        std::vector<QVector2D> points(count);
+        for (QVector2D& point : points)
+        {
+            const float x = coordinate(random);
+            point = QVector2D(x, coordinate(random));
+        }
+        matches &= Run("uniform", points);
+
+        // LAS files repeat an XZ position for every return of a pulse, here a fifth of the points land on another one
+        if (count > 1000000) continue;
+        std::uniform_int_distribution<size_t> pick(0, count - 1);
+        for (size_t i = 0; i < count / 5; ++i) points.push_back(points[pick(random)]);
+        std::shuffle(points.begin(), points.end(), random);
+        matches &= Run("duplicates", points);
+    }
+    return matches ? 0 : 1;
+}
@@ -0,0 +1,115 @@
+#include "Benchmark.h"
+#include "Delaunay.h"
+#include "Predicates.h"
+#include "Triangulation.h"
+#include <numeric>
+
+namespace
+{
+
+// Every edge is locally Delaunay, which for a triangulation means every circumcircle is empty: the corner across each
+// edge may not be inside the circle through the triangle on this side. Triangles wind clockwise, so InCircle() flips its sign
+size_t NonDelaunayEdges(const Triangulation& triangulation)
+{
+    const std::vector<QVector2D>& points = triangulation.points();
+    const std::vector<uint32_t>& indices = triangulation.indices();
+    const std::vector<int>& halfedges = triangulation.halfedges();
+    size_t bad = 0;
+    for (size_t e = 0; e < halfedges.size(); ++e)
+    {
+        if (halfedges[e] < 0) continue;
+        const size_t t = e / 3;
+        const QVector2D& a = points[indices[3 * t]];
+        const QVector2D& b = points[indices[3 * t + 1]];
+        const QVector2D& c = points[indices[3 * t + 2]];
+        const size_t twin = static_cast<size_t>(halfedges[e]);
+        const QVector2D& across = points[indices[3 * (twin / 3) + (twin % 3 + 2) % 3]];
+        bad += Predicates::InCircle(a, b, c, across) * Predicates::Orient2d(a, b, c) > 0.0;
+    }
+    return bad;
+}
+
+// Same distinct points as the edited triangulation, so a fresh Delaunay::Triangulate() has to end up with as many triangles
+bool Check(const std::string& step, const Triangulation& triangulation)
+{
+    std::vector<QVector2D> live;
+    for (uint32_t i = 0; i < triangulation.points().size(); ++i)
+        if (triangulation.contains(i)) live.push_back(triangulation.points()[i]);
+    std::vector<uint32_t> fresh;
+    Delaunay::Triangulate(live, fresh);
+
+    const size_t bad = NonDelaunayEdges(triangulation);
+    if (fresh.size() / 3 != triangulation.triangleCount() || bad)
+    {
+        std::printf("ERROR: after %s %zu triangles and %zu edges that aren't Delaunay, a fresh triangulation has %zu triangles\n",
+                    step.c_str(), triangulation.triangleCount(), bad, fresh.size() / 3);
+        return false;
+    }
+    return true;
+}
+
+}
+
+// Survey updates on a kept triangulation: random points going in, random points coming out and both mixed like a live scan
+// Every step is checked against triangulating what is left from scratch, which is also what an edit saves over
+int RunEditBenchmark()
+{
+    bool correct = true;
+    for (size_t count : { size_t(100000), size_t(1000000) })
+    {
+        const float size = 1000.0f * std::sqrt(count / 1e6f);
+        const std::vector<Vertex> terrain = Benchmark::UniformTerrain(count, size);
+        std::vector<QVector2D> points(count);
+        for (size_t i = 0; i < count; ++i) points[i] = terrain[i].poXZ();
+        Triangulation triangulation;
+        const double build = Benchmark::Time([&]() { triangulation.build(points); }, 1);
+        Benchmark::PrintRow("edits", "build", count, build, std::to_string(triangulation.triangleCount()) + " triangles");
+
+        const size_t editCount = count / 10;
+        std::mt19937 random(3);
+        std::uniform_real_distribution<float> coordinate(0.0f, size);
+        std::vector<QVector2D> added(editCount);
+        for (QVector2D& point : added)
+        {
+            const float x = coordinate(random);
+            point = QVector2D(x, coordinate(random));
+        }
+        std::vector<uint32_t> removed(count);
+        std::iota(removed.begin(), removed.end(), 0u);
+        std::shuffle(removed.begin(), removed.end(), random);
+        removed.resize(editCount);
+
+        size_t failed = 0;
+        const double insert = Benchmark::Time([&]() { for (const QVector2D& point : added) failed += triangulation.insert(point) < 0; }, 1);
+        Benchmark::PrintRow("edits", "insert", editCount, insert, std::to_string(count) + " points, " + std::to_string(failed) + " duplicates");
+        correct &= Check("insert", triangulation);
+
+        failed = 0;
+        const double remove = Benchmark::Time([&]() { for (uint32_t point : removed) failed += !triangulation.remove(point); }, 1);
+        Benchmark::PrintRow("edits", "remove", editCount, remove, std::to_string(count) + " points, " + std::to_string(failed) + " missing");
+        correct &= Check("remove", triangulation);
+
+        // Each new point goes in and one of the originals still left comes out, the size stays the same
+        std::vector<uint32_t> kept;
+        for (uint32_t i = 0; i < count; ++i)
+            if (triangulation.contains(i)) kept.push_back(i);
+        std::shuffle(kept.begin(), kept.end(), random);
+        for (QVector2D& point : added)
+        {
+            const float x = coordinate(random);
+            point = QVector2D(x, coordinate(random));
+        }
+        const double mixed = Benchmark::Time([&]()
+        {
+            for (size_t i = 0; i < editCount; ++i)
+            {
+                triangulation.insert(added[i]);
+                triangulation.remove(kept[i]);
+            }
+        }, 1);
+        Benchmark::PrintRow("edits", "insert and remove", 2 * editCount, mixed, std::to_string(count) + " points, "
+                            + std::to_string(static_cast<size_t>(build / mixed * 2 * editCount)) + " edits in the time of a build");
+        correct &= Check("insert and remove", triangulation);
+    }
+    return correct ? 0 : 1;
+}
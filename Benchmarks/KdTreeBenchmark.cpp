@@ -0,0 +1,50 @@
+#include "Benchmark.h"
+#include "KdTree.h"
+#include <algorithm>
+
+// Build time and query throughput of KdTree, with a brute force scan as the baseline for the small sizes
+int RunKdTreeBenchmark()
+{
+    const int k = 16;
+    for (size_t count : { size_t(10000), size_t(100000), size_t(1000000), size_t(10000000) })
+    {
+        const std::vector<Vertex> points = Benchmark::UniformTerrain(count);
+
+        KdTree tree;
+        Benchmark::PrintRow("kdtree", "build", count, Benchmark::Time([&]() { tree.build(points); }));
+
+        // Query at the points themselves, like normal estimation and outlier removal do
+        const size_t queryCount = std::min<size_t>(count, 200000);
+        std::vector<QVector3D> queries(queryCount);
+        for (size_t i = 0; i < queryCount; ++i) queries[i] = points[(i * 7919) % count].pos();
+
+        std::vector<int> neighbours;
+        Benchmark::PrintRow("kdtree", "knn16 single thread", queryCount, Benchmark::Time([&]()
+        {
+            for (const QVector3D& query : queries) tree.nearest(query, k, neighbours);
+        }));
+
+        std::vector<int> batch;
+        Benchmark::PrintRow("kdtree", "knn16 batch", queryCount, Benchmark::Time([&]() { tree.nearestBatch(queries, k, batch); }));
+
+        std::vector<size_t> offsets;
+        const double radiusTime = Benchmark::Time([&]() { tree.radiusBatch(queries, 5.0f, batch, offsets); });
+        Benchmark::PrintRow("kdtree", "radius 5 batch", queryCount, radiusTime, "avg " + std::to_string(offsets.back() / double(queryCount)).substr(0, 5) + " hits");
+
+        // What every caller would do without the tree, only feasible for the smallest size
+        if (count <= 10000)
+        {
+            const size_t bruteCount = 1000;
+            std::vector<std::pair<float, int>> distances(count);
+            Benchmark::PrintRow("kdtree", "knn16 brute force", bruteCount, Benchmark::Time([&]()
+            {
+                for (size_t q = 0; q < bruteCount; ++q)
+                {
+                    for (size_t i = 0; i < count; ++i) distances[i] = { (points[i].pos() - queries[q]).lengthSquared(), int(i) };
+                    std::partial_sort(distances.begin(), distances.begin() + k, distances.end());
+                }
+            }, 1));
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,48 @@
+#include "Benchmark.h"
+#include "Parallel.h"
+#include "Triangulation.h"
+
+// Point location in the kept triangulation, what PointCloud::surfaceAt() spends its time on
+// A path of small steps like a camera or a rolling sphere, then random positions on one thread and spread over all of them
+int RunLocateBenchmark()
+{
+    const size_t queryCount = 1000000;
+    for (size_t count : { size_t(100000), size_t(1000000), size_t(10000000) })
+    {
+        const float size = 1000.0f * std::sqrt(count / 1e6f);
+        const std::vector<Vertex> terrain = Benchmark::UniformTerrain(count, size);
+        std::vector<QVector2D> points(count);
+        for (size_t i = 0; i < count; ++i) points[i] = terrain[i].poXZ();
+        Triangulation triangulation(points);
+
+        std::vector<QVector2D> path(queryCount), scattered(queryCount);
+        std::mt19937 random(2);
+        std::uniform_real_distribution<float> coordinate(0.0f, size);
+        for (size_t i = 0; i < queryCount; ++i)
+        {
+            const float angle = i * 1e-5f;
+            path[i] = QVector2D(size * (0.5f + 0.4f * std::cos(angle)), size * (0.5f + 0.4f * std::sin(angle)));
+            scattered[i] = QVector2D(coordinate(random), coordinate(random));
+        }
+
+        int found = 0;
+        Benchmark::PrintRow("locate", "path", queryCount, Benchmark::Time([&]()
+        {
+            for (const QVector2D& point : path) found += triangulation.locate(point) >= 0;
+        }), std::to_string(count) + " points");
+        Benchmark::PrintRow("locate", "random", queryCount, Benchmark::Time([&]()
+        {
+            for (const QVector2D& point : scattered) found += triangulation.locate(point) >= 0;
+        }), std::to_string(count) + " points");
+        Benchmark::PrintRow("locate", "random parallel", queryCount, Benchmark::Time([&]()
+        {
+            Parallel::ForBlocks(0, scattered.size(), [&](size_t begin, size_t end, unsigned)
+            {
+                uint32_t hint = 0;
+                for (size_t i = begin; i < end; ++i) triangulation.locate(scattered[i], hint);
+            });
+        }), std::to_string(count) + " points, " + std::to_string(Parallel::ThreadCount()) + " threads");
+        if (found == 0) std::printf("no query hit the triangulation\n");
+    }
+    return 0;
+}
@@ -0,0 +1,70 @@
+#include "Benchmark.h"
+#include "PointCloud.h"
+#include "PointNormals.h"
+#include "Triangle.h"
+#include <filesystem>
+#include <fstream>
+#include <memory>
+
+namespace
+{
+
+// PointCloud only reads from files, so the benchmark points go through a temporary file in the importlas.py format
+std::string WriteAscii(const std::vector<Vertex>& points)
+{
+    const std::string filename = (std::filesystem::temp_directory_path() / "normals_benchmark.txt").string();
+    std::ofstream file(filename);
+    file << points.size() << "\n";
+    for (const Vertex& v : points) file << v.x << " " << v.y << " " << v.z << "\n";
+    return filename;
+}
+
+}
+
+// PCA normals against the triangulate-then-accumulate path PointCloud has always used
+// Both include reading the file and normalising, so the difference between the rows is the normal stage alone
+int RunNormalsBenchmark()
+{
+    const QVector3D min(-50.0f, -5.0f, -50.0f), max(50.0f, 5.0f, 50.0f);
+
+    // The incremental Delaunay is quadratic, so the comparison stops where it still finishes in seconds
+    for (size_t count : { size_t(2000), size_t(8000), size_t(32000) })
+    {
+        const std::string filename = WriteAscii(Benchmark::UniformTerrain(count));
+        std::vector<Triangle> triangles;
+
+        PointCloudOptions triangulated;
+        triangulated.useCache = false;
+        std::unique_ptr<PointCloud> mesh;
+        Benchmark::PrintRow("normals", "triangulate + accumulate", count, Benchmark::Time([&]()
+        {
+            triangles.clear();
+            mesh = std::make_unique<PointCloud>(filename, min, max, triangles, triangulated);
+        }, 1));
+
+        PointCloudOptions pca = triangulated;
+        pca.triangulate = false;
+        std::unique_ptr<PointCloud> cloud;
+        const double pcaTime = Benchmark::Time([&]() { cloud = std::make_unique<PointCloud>(filename, min, max, triangles, pca); });
+
+        // How far apart the two answers are, the mean angle is dominated by the hull where the triangles are long and thin
+        const std::vector<Vertex> a = mesh->getVertices(), b = cloud->getVertices();
+        double angle = 0.0;
+        for (size_t i = 0; i < a.size(); ++i)
+        {
+            const float cosine = QVector3D::dotProduct(QVector3D(a[i].r, a[i].g, a[i].b), QVector3D(b[i].r, b[i].g, b[i].b));
+            angle += std::acos(std::clamp(cosine, -1.0f, 1.0f));
+        }
+        Benchmark::PrintRow("normals", "pca k16", count, pcaTime, "mean " + std::to_string(angle / a.size() * 57.2957795).substr(0, 5) + " deg from triangulated");
+
+        std::filesystem::remove(filename);
+    }
+
+    // The sizes only the PCA path can reach, the tree build is included
+    for (size_t count : { size_t(100000), size_t(1000000), size_t(10000000) })
+    {
+        std::vector<Vertex> points = Benchmark::UniformTerrain(count);
+        Benchmark::PrintRow("normals", "pca k16 (no file)", count, Benchmark::Time([&]() { PointNormals::Estimate(points, 16); }, 1));
+    }
+    return 0;
+}
@@ -0,0 +1,90 @@
+#include "Benchmark.h"
+#include "Delaunay.h"
+#include "Octree.h"
+#include "Parallel.h"
+#include "Sphere.h"
+#include "Triangle.h"
+
+namespace
+{
+
+// The collision triangles PointCloud makes of a terrain, two per point, oBounds is the box UniformTerrain fills
+std::vector<Triangle> TerrainTriangles(size_t pointCount, AABB& oBounds)
+{
+    const float size = 1000.0f * std::sqrt(pointCount / 1e6f);
+    oBounds = AABB(QVector3D(0.0f, -20.0f, 0.0f), QVector3D(size, 20.0f, size));
+    const std::vector<Vertex> points = Benchmark::UniformTerrain(pointCount, size);
+    std::vector<QVector2D> positions(points.size());
+    for (size_t i = 0; i < points.size(); ++i) positions[i] = points[i].poXZ();
+    std::vector<uint32_t> indices;
+    Delaunay::TriangulateTiled(positions, indices);
+
+    std::vector<Triangle> triangles;
+    triangles.reserve(indices.size() / 3);
+    for (size_t i = 0; i < indices.size(); i += 3) triangles.emplace_back(points[indices[i]], points[indices[i + 1]], points[indices[i + 2]]);
+    return triangles;
+}
+
+}
+
+// Octree::build() and the three queries, with the depth and leaf size Renderer uses
+int RunOctreeBenchmark()
+{
+    const std::string threads = std::to_string(Parallel::ThreadCount()) + " threads";
+    for (size_t pointCount : { size_t(50000), size_t(500000), size_t(2000000) })
+    {
+        AABB bounds;
+        std::vector<Triangle> triangles = TerrainTriangles(pointCount, bounds);
+        const size_t count = triangles.size();
+
+        Octree tree(triangles, bounds);
+        Benchmark::PrintRow("octree", "build", count, Benchmark::Measure([&]() { tree.build(); }, 3), threads);
+
+        // Around a ball rolling over the terrain like PhysicsSystem asks, a box of the same size and the point in the middle
+        const size_t queryCount = 200000;
+        std::mt19937 random(4);
+        std::uniform_real_distribution<float> coordinate(0.0f, bounds.mMax.x());
+        std::vector<Sphere> spheres;
+        spheres.reserve(queryCount);
+        for (size_t i = 0; i < queryCount; ++i)
+        {
+            const float x = coordinate(random), z = coordinate(random);
+            spheres.emplace_back(QVector3D(x, 20.0f * std::sin(x * 0.01f) * std::cos(z * 0.013f), z), QVector3D(), 1.0f);
+        }
+        std::vector<int> hits;
+        size_t hitCount = 0;
+        double seconds = 0.0;
+        auto perQuery = [&]() { return "avg " + std::to_string(hitCount / double(queryCount)).substr(0, 5) + " hits"; };
+        seconds = Benchmark::Time([&]()
+        {
+            hitCount = 0;
+            for (const Sphere& sphere : spheres) {
+                hits.clear();
+                tree.query(sphere, hits);
+                hitCount += hits.size();
+            }
+        });
+        Benchmark::PrintRow("octree", "query sphere", queryCount, seconds, perQuery());
+        seconds = Benchmark::Time([&]()
+        {
+            hitCount = 0;
+            for (const Sphere& sphere : spheres) {
+                hits.clear();
+                tree.query(AABB(sphere.mPosition - QVector3D(1.0f, 1.0f, 1.0f), sphere.mPosition + QVector3D(1.0f, 1.0f, 1.0f)), hits);
+                hitCount += hits.size();
+            }
+        });
+        Benchmark::PrintRow("octree", "query box", queryCount, seconds, perQuery());
+        seconds = Benchmark::Time([&]()
+        {
+            hitCount = 0;
+            for (const Sphere& sphere : spheres) {
+                hits.clear();
+                tree.query(sphere.mPosition, hits);
+                hitCount += hits.size();
+            }
+        });
+        Benchmark::PrintRow("octree", "query point", queryCount, seconds, perQuery());
+    }
+    return 0;
+}
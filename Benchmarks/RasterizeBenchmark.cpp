@@ -0,0 +1,65 @@
+#include "Benchmark.h"
+#include "HeightMap.h"
+#include "Rasterize.h"
+
+namespace
+{
+
+std::string Size(const HeightGrid& grid)
+{
+    return std::to_string(grid.width) + "x" + std::to_string(grid.depth) + " grid";
+}
+
+}
+
+// Rasterize::Grid() with every reduction, the hole filling on its own, and the whole way from points to a HeightMap terrain
+// One point per square metre like UniformTerrain at 1M points, so a 1 m cell holds about one point and a 0.5 m cell leaves most empty
+int RunRasterizeBenchmark()
+{
+    const std::pair<Rasterize::Reduction, const char*> reductions[] = {
+        { Rasterize::Reduction::Min, "min" }, { Rasterize::Reduction::Max, "max" },
+        { Rasterize::Reduction::Mean, "mean" }, { Rasterize::Reduction::Idw, "idw" }
+    };
+    for (size_t count : { size_t(1000000), size_t(10000000) })
+    {
+        const std::vector<Vertex> points = Benchmark::UniformTerrain(count, 1000.0f * std::sqrt(count / 1e6f));
+        const int repeats = count <= 1000000 ? 3 : 1;
+        HeightGrid grid;
+
+        for (const auto& [reduction, name] : reductions)
+        {
+            Rasterize::Settings settings;
+            settings.reduction = reduction;
+            settings.fillHoles = false;
+            const Benchmark::Measurement measurement = Benchmark::Measure([&]() { Rasterize::Grid(points, grid, settings); }, repeats);
+            Benchmark::PrintRow("rasterize", std::string(name) + " 1 m", count, measurement, Size(grid));
+        }
+
+        Rasterize::Settings fine;
+        fine.cellSize = 0.5f;
+        fine.fillHoles = false;
+        Rasterize::Grid(points, grid, fine);
+        size_t holes = 0;
+        for (float height : grid.heights) holes += std::isnan(height);
+        // The grid is copied outside the timing, filling it changes it
+        HeightGrid filled;
+        double fillTime = 1e30;
+        for (int i = 0; i < repeats; ++i)
+        {
+            filled = grid;
+            fillTime = std::min(fillTime, Benchmark::Time([&]() { Rasterize::FillHoles(filled); }, 1));
+        }
+        Benchmark::PrintRow("rasterize", "fill holes 0.5 m", grid.heights.size(), fillTime,
+                            Size(grid) + ", " + std::to_string(100 * holes / grid.heights.size()) + "% holes");
+
+        // What File > Open point cloud as height grid does once the points are read
+        HeightMap terrain;
+        const Benchmark::Measurement toTerrain = Benchmark::Measure([&]()
+        {
+            Rasterize::Grid(points, grid);
+            terrain.makeTerrain(grid);
+        }, repeats);
+        Benchmark::PrintRow("rasterize", "mean 1 m to terrain", count, toTerrain, std::to_string(terrain.getVertices().size()) + " vertices");
+    }
+    return 0;
+}
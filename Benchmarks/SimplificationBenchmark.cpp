@@ -0,0 +1,25 @@
+#include "Benchmark.h"
+#include "Simplification.h"
+
+// Greedy insertion on the synthetic terrain at a few tolerances, with how many triangles the full triangulation (about 2n) shrinks to
+// The height field is 20 units high, so the tolerances go from survey grade to a distant LOD
+int RunSimplificationBenchmark()
+{
+    for (size_t count : { size_t(100000), size_t(1000000) })
+    {
+        const std::vector<Vertex> points = Benchmark::UniformTerrain(count);
+        for (float tolerance : { 0.05f, 0.2f, 1.0f })
+        {
+            Simplification::Settings settings;
+            settings.tolerance = tolerance;
+            std::vector<uint32_t> kept, indices;
+            float error = 0.0f;
+            const double seconds = Benchmark::Time([&]() { error = Simplification::GreedyInsertion(points, kept, indices, settings); }, 1);
+            const size_t triangles = indices.size() / 3;
+            char extra[128];
+            std::snprintf(extra, sizeof(extra), "%zu triangles, %.0fx fewer, error %.3f", triangles, 2.0 * count / std::max<size_t>(triangles, 1), error);
+            Benchmark::PrintRow("simplify", "tolerance " + std::to_string(tolerance).substr(0, 4), count, seconds, extra);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,136 @@
+#include "Benchmark.h"
+#include "Delaunay.h"
+#include "Parallel.h"
+#include "PointIO.h"
+#include <filesystem>
+
+namespace
+{
+
+// Same density as UniformTerrain at 1M points, so the sets only differ in how the points are spread
+float SideFor(size_t count)
+{
+    return 1000.0f * std::sqrt(count / 1e6f);
+}
+
+std::vector<QVector2D> Uniform(size_t count)
+{
+    const float size = SideFor(count);
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> coordinate(0.0f, size);
+    std::vector<QVector2D> points(count);
+    for (QVector2D& point : points)
+    {
+        const float x = coordinate(random);
+        point = QVector2D(x, coordinate(random));
+    }
+    return points;
+}
+
+// Dense blobs on sparse ground, like trees and buildings in a scan: a tenth of the points spread out and the rest in clusters
+// The density varies by orders of magnitude, which is what hurts a sweep or a bucketed triangulator
+std::vector<QVector2D> Clustered(size_t count)
+{
+    const float size = SideFor(count);
+    std::mt19937 random(2);
+    std::uniform_real_distribution<float> coordinate(0.0f, size);
+    const size_t clusterCount = std::max<size_t>(1, count / 5000);
+    std::vector<QVector2D> centers(clusterCount);
+    for (QVector2D& center : centers)
+    {
+        const float x = coordinate(random);
+        center = QVector2D(x, coordinate(random));
+    }
+    std::normal_distribution<float> offset(0.0f, size / 200.0f);
+    std::uniform_int_distribution<size_t> cluster(0, clusterCount - 1);
+    std::vector<QVector2D> points(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (i % 10 == 0) {
+            const float x = coordinate(random);
+            points[i] = QVector2D(x, coordinate(random));
+            continue;
+        }
+        const QVector2D& center = centers[cluster(random)];
+        const float x = std::clamp(center.x() + offset(random), 0.0f, size);
+        points[i] = QVector2D(x, std::clamp(center.y() + offset(random), 0.0f, size));
+    }
+    return points;
+}
+
+// A raster like a DEM or a gridded decimation, every square has four points on one circle so the exact predicates do all the work
+// Shuffled, a grid read from a file doesn't come in a helpful order either
+std::vector<QVector2D> Grid(size_t count)
+{
+    const size_t side = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(count))));
+    std::vector<QVector2D> points;
+    points.reserve(count);
+    for (size_t i = 0; i < count; ++i) points.emplace_back(static_cast<float>(i % side), static_cast<float>(i / side));
+    std::shuffle(points.begin(), points.end(), std::mt19937(3));
+    return points;
+}
+
+// The real set, with the XZ positions moved to start at zero so UTM coordinates keep their decimals as floats
+std::vector<QVector2D> ReadReal(std::string& ioFilename)
+{
+    // Same place as assetPath in Utilities.h, the benchmarks run from the build directory as well
+    if (ioFilename.empty()) ioFilename = "../../Assets/lasdata.txt";
+    std::vector<Vertex> vertices;
+    AABB bounds;
+    if (!PointIO::ReadPoints(ioFilename, vertices, bounds)) return {};
+
+    std::vector<QVector2D> points(vertices.size());
+    for (size_t i = 0; i < vertices.size(); ++i) points[i] = QVector2D(vertices[i].x - bounds.mMin.x(), vertices[i].z - bounds.mMin.z());
+    return points;
+}
+
+// Every stride-th point, so a smaller count still covers the whole survey at a lower density
+std::vector<QVector2D> Thin(const std::vector<QVector2D>& points, size_t count)
+{
+    std::vector<QVector2D> thinned(count);
+    const double stride = static_cast<double>(points.size()) / count;
+    for (size_t i = 0; i < count; ++i) thinned[i] = points[static_cast<size_t>(i * stride)];
+    return thinned;
+}
+
+void Run(const std::string& set, const std::vector<QVector2D>& points, const std::string& extra = std::string())
+{
+    const size_t count = points.size();
+    const int repeats = count <= 100000 ? 3 : 1;
+    std::vector<uint32_t> indices;
+
+    // Both triangulators start from an empty vector each run, so the allocations include growing the output
+    const Benchmark::Measurement serial = Benchmark::Measure([&]() { indices = {}; Delaunay::Triangulate(points, indices); }, repeats);
+    Benchmark::PrintRow("triangulation", set + " serial", count, serial, std::to_string(indices.size() / 3) + " triangles" + extra);
+    const Benchmark::Measurement tiled = Benchmark::Measure([&]() { indices = {}; Delaunay::TriangulateTiled(points, indices); }, repeats);
+    Benchmark::PrintRow("triangulation", set + " tiled", count, tiled, std::to_string(indices.size() / 3) + " triangles, "
+                        + std::to_string(Parallel::ThreadCount()) + " threads" + extra);
+}
+
+}
+
+// Delaunay::Triangulate() and TriangulateTiled() over the kinds of input PointCloud gets, with memory next to the speed
+// Peak memory includes the input points, which are already resident when a run starts
+int RunTriangulationBenchmark()
+{
+    const std::vector<size_t> counts = { 1000, 10000, 100000, 1000000, 10000000 };
+    for (size_t count : counts)
+    {
+        Run("uniform", Uniform(count));
+        Run("clustered", Clustered(count));
+        Run("grid", Grid(count));
+    }
+
+    std::string filename = Benchmark::PointsFile();
+    const std::vector<QVector2D> real = ReadReal(filename);
+    if (real.empty())
+    {
+        std::printf("ERROR: no points in %s, pass a LAS or ASCII file with --points\n", filename.c_str());
+        return 1;
+    }
+    const std::string source = ", " + std::filesystem::path(filename).filename().string();
+    for (size_t count : counts)
+        if (count < real.size()) Run("real", Thin(real, count), source);
+    Run("real", real, source);
+    return 0;
+}
@@ -0,0 +1,302 @@
+#include "Bvh.h"
+#include "Parallel.h"
+#include "Triangle.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <functional>
+
+namespace
+{
+
+// Candidate planes per split are the borders between this many equal bins of the centroids along the widest axis
+constexpr int BinCount = 16;
+
+// Half the surface area, the SAH only compares areas so the factor doesn't matter
+float Area(const AABB& bounds)
+{
+    const QVector3D size = bounds.size();
+    return size.x() * size.y() + size.y() * size.z() + size.z() * size.x();
+}
+
+// update() asks for a build() past this many added triangles, or a 256th of those in the tree when that is more
+constexpr size_t MinLooseLimit = 1024;
+
+}
+
+Bvh::Bvh(std::vector<Triangle> &contentSource, int maxContent) : mMaxContent(maxContent), mContentSource(contentSource)
+{}
+
+void Bvh::build(const std::vector<int> &iSkip)
+{
+    mNodes.clear();
+    mIndices.clear();
+    mParents.clear();
+    mLoose.clear();
+    mLooseBounds.clear();
+    mLeafOf.assign(mContentSource.size(), NotIndexed);
+
+    // Skipped indices are taken out up front, the primitives below hold the index they stand for anyway
+    std::vector<int> live;
+    if (!iSkip.empty())
+    {
+        std::vector<bool> skipped(mContentSource.size(), false);
+        for (int i : iSkip) skipped[i] = true;
+        for (int i = 0; i < static_cast<int>(mContentSource.size()); ++i)
+            if (!skipped[i]) live.push_back(i);
+    }
+    const size_t count = iSkip.empty() ? mContentSource.size() : live.size();
+    if (count == 0) return;
+
+    // Bounds once per triangle, packed with the index and sorted into place along with it, so every pass below reads straight
+    // through memory instead of jumping around the triangles
+    struct Primitive
+    {
+        AABB bounds;
+        int index;
+        float centroid(int axis) const { return 0.5f * (bounds.mMin[axis] + bounds.mMax[axis]); }
+    };
+    std::vector<Primitive> primitives(count);
+    Parallel::For(0, count, [&](size_t i)
+    {
+        const int index = live.empty() ? static_cast<int>(i) : live[i];
+        primitives[i] = Primitive{ TriangleHelpers::TriangleBounds(mContentSource[index]), index };
+    }, 4096);
+
+    // Depth first with a stack of ranges instead of recursion, a lopsided split can't run out of stack that way
+    // The first child is pushed last so it is built next, straight after its parent, and the second child records its slot there
+    struct Task
+    {
+        uint32_t begin;
+        uint32_t end;
+        uint32_t secondOf;  // The parent when this is a second child, UINT32_MAX otherwise
+    };
+    std::vector<Task> tasks{ Task{ 0, static_cast<uint32_t>(count), UINT32_MAX } };
+    struct Bin
+    {
+        AABB bounds;
+        uint32_t count{0};
+    };
+    while (!tasks.empty())
+    {
+        const Task task = tasks.back();
+        tasks.pop_back();
+        const uint32_t node = static_cast<uint32_t>(mNodes.size());
+        if (task.secondOf != UINT32_MAX) mNodes[task.secondOf].first = node;
+
+        AABB box = primitives[task.begin].bounds;
+        QVector3D low = box.center(), high = low;
+        for (uint32_t i = task.begin + 1; i < task.end; ++i)
+        {
+            const AABB& bounds = primitives[i].bounds;
+            box = box.merged(bounds);
+            const QVector3D center = bounds.center();
+            low = QVector3D(std::min(low.x(), center.x()), std::min(low.y(), center.y()), std::min(low.z(), center.z()));
+            high = QVector3D(std::max(high.x(), center.x()), std::max(high.y(), center.y()), std::max(high.z(), center.z()));
+        }
+        const uint32_t size = task.end - task.begin;
+        mNodes.push_back(Node{ box, task.begin, size, 0 });
+        if (size <= static_cast<uint32_t>(mMaxContent)) continue;
+
+        // All centroids in one spot (stacked or repeated triangles), no plane can split them
+        const QVector3D extent = high - low;
+        const int axis = extent.x() >= extent.y() && extent.x() >= extent.z() ? 0 : (extent.y() >= extent.z() ? 1 : 2);
+        if (extent[axis] <= 0.0f) continue;
+
+        const float scale = BinCount / extent[axis];
+        auto binOf = [&, start = low[axis]](const Primitive& primitive)
+        {
+            return std::min(static_cast<int>((primitive.centroid(axis) - start) * scale), BinCount - 1);
+        };
+        std::array<Bin, BinCount> bins;
+        for (uint32_t i = task.begin; i < task.end; ++i)
+        {
+            Bin& bin = bins[binOf(primitives[i])];
+            bin.bounds = bin.count++ ? bin.bounds.merged(primitives[i].bounds) : primitives[i].bounds;
+        }
+
+        // Area times count on each side of every plane, from the right first and then from the left while picking the cheapest
+        std::array<float, BinCount - 1> rightCost;
+        AABB side;
+        uint32_t sideCount = 0;
+        for (int b = BinCount - 1; b > 0; --b)
+        {
+            if (bins[b].count) side = sideCount ? side.merged(bins[b].bounds) : bins[b].bounds;
+            sideCount += bins[b].count;
+            rightCost[b - 1] = sideCount ? sideCount * Area(side) : 0.0f;
+        }
+        int split = -1;
+        float best = 0.0f;
+        sideCount = 0;
+        for (int b = 0; b < BinCount - 1; ++b)
+        {
+            if (bins[b].count) side = sideCount ? side.merged(bins[b].bounds) : bins[b].bounds;
+            sideCount += bins[b].count;
+            if (sideCount == 0 || sideCount == size) continue;
+            const float cost = sideCount * Area(side) + rightCost[b];
+            if (split < 0 || cost < best) {
+                split = b;
+                best = cost;
+            }
+        }
+
+        // Splitting costs a visit to each child plus their triangles weighted by the chance of getting there, against all of them here
+        const float area = Area(box);
+        if (split < 0 || (area > 0.0f && 1.0f + best / area >= size)) continue;
+
+        const uint32_t middle = static_cast<uint32_t>(std::partition(primitives.begin() + task.begin, primitives.begin() + task.end,
+                                                                     [&](const Primitive& primitive) { return binOf(primitive) <= split; }) - primitives.begin());
+        mNodes[node].count = 0;
+        tasks.push_back(Task{ middle, task.end, node });
+        tasks.push_back(Task{ task.begin, middle, UINT32_MAX });
+    }
+    mIndices.resize(count);
+    for (size_t i = 0; i < count; ++i) mIndices[i] = primitives[i].index;
+    for (uint32_t n = 0; n < mNodes.size(); ++n)
+        for (uint32_t i = mNodes[n].first; i < mNodes[n].first + mNodes[n].count; ++i) mLeafOf[mIndices[i]] = n;
+
+    // Parents come before their children: the first child skips to the second, the second skips where its parent does
+    mNodes[0].skip = static_cast<uint32_t>(mNodes.size());
+    mParents.resize(mNodes.size());
+    mParents[0] = NotIndexed;
+    for (uint32_t i = 0; i < mNodes.size(); ++i)
+    {
+        const Node& node = mNodes[i];
+        if (node.count) continue;
+        mNodes[i + 1].skip = node.first;
+        mNodes[node.first].skip = node.skip;
+        mParents[i + 1] = mParents[node.first] = i;
+    }
+}
+
+bool Bvh::update(const std::vector<int> &iChanged, const std::vector<int> &iAdded, const std::vector<int> &iRemoved)
+{
+    if (mLoose.size() + iAdded.size() > std::max(MinLooseLimit, mIndices.size() / 256)) return false;
+
+    // The nodes from a touched leaf up are refit once each, marking stops where an earlier leaf's path already went
+    std::vector<bool> marked(mNodes.size(), false);
+    std::vector<uint32_t> refit;
+    auto mark = [&](uint32_t leaf)
+    {
+        for (uint32_t n = leaf; n != NotIndexed && !marked[n]; n = mParents[n]) {
+            marked[n] = true;
+            refit.push_back(n);
+        }
+    };
+    auto leafOf = [&](int index) { return index >= 0 && static_cast<size_t>(index) < mLeafOf.size() ? mLeafOf[index] : NotIndexed; };
+    for (int index : iRemoved)
+    {
+        const uint32_t leaf = leafOf(index);
+        if (leaf == NotIndexed) continue;
+        if (leaf & Loose)
+        {
+            // The last one on the list takes the place of the removed one
+            const uint32_t position = leaf & ~Loose;
+            mLoose[position] = mLoose.back();
+            mLooseBounds[position] = mLooseBounds.back();
+            mLeafOf[mLoose[position]] = Loose | position;
+            mLoose.pop_back();
+            mLooseBounds.pop_back();
+        }
+        else
+        {
+            // Same in the leaf's range of mIndices. An emptied leaf looks like an inner node to collect(), which steps to the next
+            // node either way, and that is where a leaf skips to
+            Node& node = mNodes[leaf];
+            int* const first = &mIndices[node.first];
+            *std::find(first, first + node.count, index) = first[node.count - 1];
+            --node.count;
+            mark(leaf);
+        }
+        mLeafOf[index] = NotIndexed;
+    }
+    for (int index : iAdded)
+    {
+        if (static_cast<size_t>(index) >= mLeafOf.size()) mLeafOf.resize(index + 1, NotIndexed);
+        if (mLeafOf[index] != NotIndexed) continue; // Already in, iChanged takes care of it
+        mLeafOf[index] = Loose | static_cast<uint32_t>(mLoose.size());
+        mLoose.push_back(index);
+        mLooseBounds.push_back(TriangleHelpers::TriangleBounds(mContentSource[index]));
+    }
+    for (int index : iChanged)
+    {
+        const uint32_t leaf = leafOf(index);
+        if (leaf == NotIndexed) continue;
+        if (leaf & Loose) mLooseBounds[leaf & ~Loose] = TriangleHelpers::TriangleBounds(mContentSource[index]);
+        else mark(leaf);
+    }
+
+    // Children come after their parent in mNodes, so going backwards refits a node after everything below it
+    std::sort(refit.begin(), refit.end(), std::greater<uint32_t>());
+    for (uint32_t n : refit)
+    {
+        Node& node = mNodes[n];
+        if (node.skip == n + 1)
+        {
+            // A leaf, the one node whose subtree ends right after it. They hold a few triangles, so their bounds are made again
+            if (node.count == 0) continue;
+            node.bounds = TriangleHelpers::TriangleBounds(mContentSource[mIndices[node.first]]);
+            for (uint32_t i = node.first + 1; i < node.first + node.count; ++i)
+                node.bounds = node.bounds.merged(TriangleHelpers::TriangleBounds(mContentSource[mIndices[i]]));
+        }
+        else node.bounds = mNodes[n + 1].bounds.merged(mNodes[node.first].bounds);
+    }
+    return true;
+}
+
+template <typename Overlaps>
+void Bvh::collect(const Overlaps& overlaps, std::vector<int>& oIndices) const
+{
+    const uint32_t size = static_cast<uint32_t>(mNodes.size());
+    for (uint32_t i = 0; i < size;)
+    {
+        const Node& node = mNodes[i];
+        if (!overlaps(node.bounds)) i = node.skip;
+        else if (node.count) {
+            oIndices.insert(oIndices.end(), mIndices.begin() + node.first, mIndices.begin() + node.first + node.count);
+            i = node.skip;
+        }
+        else ++i;
+    }
+    for (size_t i = 0; i < mLoose.size(); ++i)
+        if (overlaps(mLooseBounds[i])) oIndices.push_back(mLoose[i]);
+}
+
+void Bvh::query(const AABB &iBounds, std::vector<int> &oIndices) const
+{
+    collect([&](const AABB& bounds) { return bounds.intersectsAABB(iBounds); }, oIndices);
+}
+
+void Bvh::query(const QVector3D &iPoint, std::vector<int> &oIndices) const
+{
+    collect([&](const AABB& bounds) { return bounds.containsPoint(iPoint); }, oIndices);
+}
+
+void Bvh::query(const Sphere &iSphere, std::vector<int> &oIndices) const
+{
+    collect([&](const AABB& bounds) { return bounds.intersectsSphere(iSphere); }, oIndices);
+}
+
+void Bvh::query(const QVector3D &iOrigin, const QVector3D &iDirection, float iMaxDistance, std::vector<int> &oIndices) const
+{
+    // Slab test, clipping [0, iMaxDistance] by the two planes on each axis. Axes the segment runs parallel to only need the origin inside
+    std::array<float, 3> inverse;
+    for (int a = 0; a < 3; ++a) inverse[a] = iDirection[a] != 0.0f ? 1.0f / iDirection[a] : 0.0f;
+    collect([&](const AABB& bounds)
+    {
+        float enter = 0.0f, leave = iMaxDistance;
+        for (int a = 0; a < 3; ++a)
+        {
+            if (iDirection[a] == 0.0f) {
+                if (iOrigin[a] < bounds.mMin[a] || iOrigin[a] > bounds.mMax[a]) return false;
+                continue;
+            }
+            float t0 = (bounds.mMin[a] - iOrigin[a]) * inverse[a], t1 = (bounds.mMax[a] - iOrigin[a]) * inverse[a];
+            if (t0 > t1) std::swap(t0, t1);
+            enter = std::max(enter, t0);
+            leave = std::min(leave, t1);
+            if (enter > leave) return false;
+        }
+        return true;
+    }, oIndices);
+}
@@ -0,0 +1,64 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include "AABB.h"
+#include <cstdint>
+#include <vector>
+class Triangle;
+
+// Bounding volume hierarchy over the triangles in contentSource, the other collision index next to Octree
+// Every split is the cheapest of a few candidate planes by the surface area heuristic (SAH), so dense patches of a scan get
+// deep, small nodes and sparse ground stays shallow, where the octree cuts everything at the same fixed places
+// The nodes are stored depth first and each knows the node after its subtree, so a query is one loop forward through the array
+// with no stack: into the next node on a hit, past the subtree on a miss
+class Bvh
+{
+public:
+    explicit Bvh(std::vector<Triangle> &contentSource, int maxContent = 4);
+
+    int mMaxContent;    // Ranges this small are never split, bigger ones only when the SAH says it pays
+
+    // Throws away the hierarchy and makes it again from every triangle in the content source, call it when they change
+    // Indices in iSkip are left out, like triangles that were removed without moving the ones after them
+    void build(const std::vector<int>& iSkip = {});
+
+    // Patches the hierarchy for a few edited triangles instead of building it again, like Octree::update(). The nodes keep their
+    // triangles, so the SAH splits get worse the more the triangles move, a build() now and then puts that right
+    bool update(const std::vector<int>& iChanged, const std::vector<int>& iAdded, const std::vector<int>& iRemoved);
+
+    const AABB& bounds() const { return mNodes.empty() ? mEmpty : mNodes[0].bounds; }
+    size_t nodeCount() const { return mNodes.size(); }
+
+    // Same as the Octree queries: the triangles in the leaves whose bounds are touched, each at most once
+    void query(const AABB& iBounds, std::vector<int>& oIndices) const;
+    void query(const QVector3D& iPoint, std::vector<int>& oIndices) const;
+    void query(const Sphere& iSphere, std::vector<int>& oIndices) const;
+    // Triangles in the leaves the segment from iOrigin to iOrigin + iDirection * iMaxDistance passes through
+    void query(const QVector3D& iOrigin, const QVector3D& iDirection, float iMaxDistance, std::vector<int>& oIndices) const;
+
+private:
+    struct Node
+    {
+        AABB bounds;
+        uint32_t first{0};      // First index in mIndices for a leaf, the second child for an inner node (the first is the next node)
+        uint32_t count{0};      // Triangles in a leaf, 0 for an inner node and a leaf update() took everything out of
+        uint32_t skip{0};       // The node after this subtree, where a query goes when it misses
+    };
+
+    template <typename Overlaps>
+    void collect(const Overlaps& overlaps, std::vector<int>& oIndices) const;
+
+    static constexpr uint32_t Loose = 0x80000000u;      // Flag in mLeafOf
+    static constexpr uint32_t NotIndexed = UINT32_MAX;
+
+    std::vector<Triangle>& mContentSource;
+    std::vector<Node> mNodes;
+    std::vector<int> mIndices;          // Into mContentSource, leaf by leaf
+    std::vector<uint32_t> mParents;     // NotIndexed for the root
+    std::vector<uint32_t> mLeafOf;      // Node of each index in mContentSource, Loose | position in mLoose, or NotIndexed
+    std::vector<int> mLoose;            // Added by update() since the last build()
+    std::vector<AABB> mLooseBounds;
+    AABB mEmpty;
+};
+
+#endif // BVH_H
@@ -0,0 +1,104 @@
+#include "ChangeDetection.h"
+#include "KdTree.h"
+#include "Parallel.h"
+#include "PointAttributes.h"
+#include "PointIO.h"
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+
+// Spreads the low 16 bits out to the even bits, for Z-order (Morton) keys
+uint32_t Interleave(uint32_t x)
+{
+    x &= 0xffff;
+    x = (x | (x << 8)) & 0x00ff00ff;
+    x = (x | (x << 4)) & 0x0f0f0f0f;
+    x = (x | (x << 2)) & 0x33333333;
+    x = (x | (x << 1)) & 0x55555555;
+    return x;
+}
+
+}
+
+void ChangeDetection::CloudToCloud(const std::vector<Vertex> &compared, const KdTree &reference, std::vector<float> &oDistances)
+{
+    oDistances.resize(compared.size());
+    if (compared.empty()) return;
+
+    // Scans come in scan line or file order, so the queries go along a Z-order curve instead: the next one mostly ends in the
+    // leaf the last one did and the upper levels of the tree stay in cache. Each chunk handed out is then one patch of ground
+    QVector2D min(std::numeric_limits<float>::max(), std::numeric_limits<float>::max()), max = -min;
+    for (const Vertex& point : compared) {
+        min = QVector2D(std::min(min.x(), point.x), std::min(min.y(), point.z));
+        max = QVector2D(std::max(max.x(), point.x), std::max(max.y(), point.z));
+    }
+    const QVector2D scale(65535.0f / std::max(max.x() - min.x(), 1e-30f), 65535.0f / std::max(max.y() - min.y(), 1e-30f));
+    std::vector<std::pair<uint32_t, uint32_t>> keys(compared.size());
+    Parallel::For(0, compared.size(), [&](size_t i)
+    {
+        const QVector2D cell = (compared[i].poXZ() - min) * scale;
+        keys[i] = { Interleave(static_cast<uint32_t>(cell.x())) | Interleave(static_cast<uint32_t>(cell.y())) << 1, static_cast<uint32_t>(i) };
+    }, 4096);
+    std::sort(keys.begin(), keys.end());
+
+    // The KdTree queries are read only and allocate nothing, so the chunks just go to whichever thread is free
+    Parallel::For(0, keys.size(), [&](size_t k)
+    {
+        const uint32_t i = keys[k].second;
+        float distanceSquared = 0.0f;
+        oDistances[i] = reference.closest(compared[i].pos(), &distanceSquared) < 0 ? 0.0f : std::sqrt(distanceSquared);
+    }, 1024);
+}
+
+bool ChangeDetection::CloudToFile(const std::vector<Vertex> &compared, const std::array<double, 3> &origin, const std::string &referenceFile, quint64 classMask, std::vector<float> &oDistances)
+{
+    std::vector<Vertex> reference;
+    PointAttributes attributes;
+    AABB bounds;
+    std::array<double, 3> referenceOrigin{};
+    if (!PointIO::ReadPoints(referenceFile, reference, bounds, &referenceOrigin, classMask ? &attributes : nullptr)) return false;
+    if (classMask) PointFilter::ByClass(reference, attributes, classMask, bounds);
+    if (reference.empty()) {
+        qDebug() << "ERROR: No reference points left in" << referenceFile.c_str();
+        return false;
+    }
+
+    // Each LAS file is read relative to its own header minimum, the difference is added in double before it goes back to float
+    const QVector3D shift(static_cast<float>(referenceOrigin[0] - origin[0]), static_cast<float>(referenceOrigin[1] - origin[1]), static_cast<float>(referenceOrigin[2] - origin[2]));
+    if (!shift.isNull())
+    {
+        Parallel::ForBlocks(0, reference.size(), [&](size_t begin, size_t end, unsigned)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                reference[i].x += shift.x();
+                reference[i].y += shift.y();
+                reference[i].z += shift.z();
+            }
+        });
+    }
+
+    const KdTree tree(reference);
+    CloudToCloud(compared, tree, oDistances);
+    return true;
+}
+
+void ChangeDetection::ColorByDistance(std::vector<Vertex> &ioPoints, const std::vector<float> &distances, float maxDistance)
+{
+    const float inverseRange = maxDistance > 0.0f ? 1.0f / maxDistance : 0.0f;
+    Parallel::ForBlocks(0, std::min(ioPoints.size(), distances.size()), [&](size_t begin, size_t end, unsigned)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            const float t = std::clamp(distances[i] * inverseRange, 0.0f, 1.0f);
+            Vertex& v = ioPoints[i];
+            v.r = std::max(0.0f, 2.0f * t - 1.0f);
+            v.g = 1.0f - std::abs(2.0f * t - 1.0f);
+            v.b = std::max(0.0f, 1.0f - 2.0f * t);
+        }
+    });
+}
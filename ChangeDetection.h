@@ -0,0 +1,29 @@
+#ifndef CHANGEDETECTION_H
+#define CHANGEDETECTION_H
+
+#include <QtGlobal>
+#include <array>
+#include <string>
+#include <vector>
+#include "Vertex.h"
+class KdTree;
+
+// Differences between repeat surveys of the same area, as cloud to cloud (C2C) distances
+namespace ChangeDetection
+{
+
+// Distance from every point of compared to the nearest point in the tree over the reference points
+// Runs in parallel, in Z-order of the compared points so neighbouring queries share the cached part of the tree
+void CloudToCloud(const std::vector<Vertex>& compared, const KdTree& reference, std::vector<float>& oDistances);
+
+// Reads referenceFile with PointIO and runs CloudToCloud against it
+// compared has to be in source units relative to origin, as PointIO::ReadPoints left them, the reference is moved onto the same origin
+// classMask drops reference points like PointFilter::ByClass, 0 keeps everything
+bool CloudToFile(const std::vector<Vertex>& compared, const std::array<double, 3>& origin, const std::string& referenceFile, quint64 classMask, std::vector<float>& oDistances);
+
+// Writes a blue (no change) to green to red (maxDistance or more) ramp into Vertex::r, g and b
+void ColorByDistance(std::vector<Vertex>& ioPoints, const std::vector<float>& distances, float maxDistance);
+
+}
+
+#endif // CHANGEDETECTION_H
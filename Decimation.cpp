@@ -0,0 +1,120 @@
+#include "Decimation.h"
+#include "Parallel.h"
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+namespace
+{
+
+// Same result as numpy.percentile with its default linear interpolation
+float Percentile(std::vector<float>& values, float percentile)
+{
+    const float rank = std::clamp(percentile, 0.0f, 100.0f) / 100.0f * (values.size() - 1);
+    const size_t lower = static_cast<size_t>(rank);
+    std::nth_element(values.begin(), values.begin() + lower, values.end());
+    const float lowerValue = values[lower];
+    if (lower + 1 >= values.size()) return lowerValue;
+
+    // nth_element leaves everything above the lower rank behind it, so the next value is just the smallest of those
+    const float upperValue = *std::min_element(values.begin() + lower + 1, values.end());
+    return lowerValue + (upperValue - lowerValue) * (rank - lower);
+}
+
+// Like numpy.median, the two middle values are averaged for even counts
+float Median(std::vector<float>& values)
+{
+    const size_t middle = values.size() / 2;
+    std::nth_element(values.begin(), values.begin() + middle, values.end());
+    if (values.size() % 2 == 1) return values[middle];
+
+    const float below = *std::max_element(values.begin(), values.begin() + middle);
+    return (below + values[middle]) * 0.5f;
+}
+
+void ClipOutliers(std::vector<Vertex>& ioPoints, const Decimation::Settings& settings)
+{
+    if (settings.lowerPercentile <= 0.0f && settings.upperPercentile >= 100.0f) return;
+
+    std::vector<float> values;
+    values.reserve(ioPoints.size());
+    for (const Vertex& v : ioPoints) values.push_back(v.pos()[settings.clipAxis]);
+
+    const float lowest = settings.lowerPercentile > 0.0f ? Percentile(values, settings.lowerPercentile) : -std::numeric_limits<float>::infinity();
+    const float highest = settings.upperPercentile < 100.0f ? Percentile(values, settings.upperPercentile) : std::numeric_limits<float>::infinity();
+
+    ioPoints.erase(std::remove_if(ioPoints.begin(), ioPoints.end(), [&](const Vertex& v)
+    {
+        const float value = v.pos()[settings.clipAxis];
+        return value < lowest || value > highest;
+    }), ioPoints.end());
+}
+
+}
+
+void Decimation::GridMedian(std::vector<Vertex> &ioPoints, AABB &ioBounds, const Settings &settings)
+{
+    ClipOutliers(ioPoints, settings);
+    if (ioPoints.empty()) return;
+
+    float minX = std::numeric_limits<float>::infinity(), minZ = minX;
+    float maxX = -minX;
+    for (const Vertex& v : ioPoints)
+    {
+        minX = std::min(v.x, minX);
+        minZ = std::min(v.z, minZ);
+        maxX = std::max(v.x, maxX);
+    }
+    const uint64_t columns = static_cast<uint64_t>(std::floor((maxX - minX) / settings.cellSize)) + 1;
+
+    // Sort the points by cell id, so every cell becomes one contiguous run instead of a mask over the whole array
+    std::vector<std::pair<uint64_t, uint32_t>> cellOf(ioPoints.size());
+    Parallel::ForBlocks(0, ioPoints.size(), [&](size_t begin, size_t end, unsigned)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            const uint64_t column = static_cast<uint64_t>(std::floor((ioPoints[i].x - minX) / settings.cellSize));
+            const uint64_t row = static_cast<uint64_t>(std::floor((ioPoints[i].z - minZ) / settings.cellSize));
+            cellOf[i] = { column + row * columns, static_cast<uint32_t>(i) };
+        }
+    });
+    std::sort(cellOf.begin(), cellOf.end());
+
+    std::vector<size_t> runStarts;
+    for (size_t i = 0; i < cellOf.size(); ++i)
+    {
+        if (i == 0 || cellOf[i].first != cellOf[i - 1].first) runStarts.push_back(i);
+    }
+    runStarts.push_back(cellOf.size());
+
+    const size_t cellCount = runStarts.size() - 1;
+    std::vector<Vertex> decimated(cellCount);
+
+    // Each cell is independent, cells are handed out in chunks since their sizes vary a lot
+    Parallel::For(0, cellCount, [&](size_t cell)
+    {
+        thread_local std::vector<float> values;
+        float median[3];
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            values.clear();
+            for (size_t i = runStarts[cell]; i < runStarts[cell + 1]; ++i) values.push_back(ioPoints[cellOf[i].second].pos()[axis]);
+            median[axis] = Median(values);
+        }
+        decimated[cell] = Vertex(median[0], median[1], median[2], 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+    }, 64);
+
+    qDebug() << "Decimated " << ioPoints.size() << " points into " << cellCount << " cells.";
+    ioPoints.swap(decimated);
+
+    QVector3D min = ioPoints.front().pos(), max = min;
+    for (const Vertex& v : ioPoints)
+    {
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            min[axis] = std::min(v.pos()[axis], min[axis]);
+            max[axis] = std::max(v.pos()[axis], max[axis]);
+        }
+    }
+    ioBounds = AABB(min, max);
+}
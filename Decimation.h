@@ -0,0 +1,26 @@
+#ifndef DECIMATION_H
+#define DECIMATION_H
+
+#include <vector>
+#include "AABB.h"
+#include "Vertex.h"
+
+// The decimation step from Tangentials/importlas.py, done on the loaded points instead of in Python
+namespace Decimation
+{
+
+struct Settings
+{
+    float cellSize{5.0f};           // Width of each grid cell, in the units of the source file (metres for our LAS data)
+    float lowerPercentile{2.0f};    // Points below this percentile along clipAxis are thrown away, 0 keeps everything
+    float upperPercentile{98.0f};   // Points above this percentile along clipAxis are thrown away, 100 keeps everything
+    int clipAxis{2};                // importlas.py clips on LAS y, which ends up in Vertex::z
+};
+
+// Removes outliers, then replaces the points with one point per occupied cell of a grid in the XZ plane
+// Each new point is the per-axis median of the points in its cell, and ioBounds is updated to match the result
+void GridMedian(std::vector<Vertex>& ioPoints, AABB& ioBounds, const Settings& settings = Settings());
+
+}
+
+#endif // DECIMATION_H
@@ -0,0 +1,587 @@
+#include "Delaunay.h"
+#include "Parallel.h"
+#include "Predicates.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+namespace
+{
+
+// Slack on the bounds of a circumcircle, the points in them are tested exactly so it can be generous
+constexpr float SearchSlack = 1e-3f;
+
+// Average points per cell of the grid TriangulateTiled() sorts the points into
+constexpr int PointsPerCell = 8;
+
+// Index triple rotated so the smallest index comes first, keeps the winding so equal triangles compare equal
+std::array<uint32_t, 3> Canonical(uint32_t a, uint32_t b, uint32_t c)
+{
+    if (b < a && b < c) return { b, c, a };
+    if (c < a && c < b) return { c, a, b };
+    return { a, b, c };
+}
+
+// Where d is relative to the circumcircle of a, b, c: 1 inside, 0 on it (cocircular) and -1 outside, whichever way a, b, c wind
+int InCircle(const std::vector<QVector2D>& points, uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+{
+    const double inside = Predicates::InCircle(points[a], points[b], points[c], points[d]);
+    const double orientation = Predicates::Orient2d(points[a], points[b], points[c]);
+    const double signedInside = orientation < 0.0 ? -inside : inside;
+    return signedInside > 0.0 ? 1 : (signedInside < 0.0 ? -1 : 0);
+}
+
+// Port of the sweep-hull in delaunator (https://github.com/mapbox/delaunator): points are added in order of distance from a seed
+// triangle, each one is connected to the hull edges it can see, and the new triangles are flipped until they are Delaunay
+// The hull is a linked list with an angular hash for finding a visible edge, so every point costs O(1) on average after the sort
+class Sweep
+{
+public:
+    Sweep(const std::vector<QVector2D>& points, std::vector<uint32_t>& oTriangles, std::vector<int>& oHalfedges)
+        : mPoints(points), mTriangles(oTriangles), mHalfedges(oHalfedges) {}
+
+    void run();
+
+private:
+    double x(uint32_t i) const { return mPoints[i].x(); }
+    double y(uint32_t i) const { return mPoints[i].y(); }
+
+    // True when p, q, r turn counterclockwise, exactly, so nearly collinear hull points can't make the hull cross itself
+    bool orient(uint32_t p, uint32_t q, uint32_t r) const { return Predicates::Orient2d(mPoints[p], mPoints[q], mPoints[r]) > 0.0; }
+
+    size_t hashKey(double px, double py) const
+    {
+        const double dx = px - mCenterX, dy = py - mCenterY;
+        const double p = dx / (std::abs(dx) + std::abs(dy));
+        const double angle = (dy > 0.0 ? 3.0 - p : 1.0 + p) / 4.0; // Monotonic in the angle, without atan2
+        return static_cast<size_t>(std::floor(angle * mHash.size())) % mHash.size();
+    }
+
+    void link(size_t a, int b);
+    size_t addTriangle(uint32_t i0, uint32_t i1, uint32_t i2, int a, int b, int c);
+    size_t legalize(size_t a);
+
+    const std::vector<QVector2D>& mPoints;
+    std::vector<uint32_t>& mTriangles;
+    std::vector<int>& mHalfedges;
+
+    double mCenterX{0.0}, mCenterY{0.0};
+    uint32_t mHullStart{0};
+    std::vector<uint32_t> mHullPrev, mHullNext;
+    std::vector<int> mHullTri;          // Halfedge of the triangle on the inside of the hull edge starting at each point
+    std::vector<uint32_t> mHash;
+    std::vector<size_t> mEdgeStack;
+};
+
+constexpr uint32_t NoPoint = std::numeric_limits<uint32_t>::max();
+
+void Sweep::link(size_t a, int b)
+{
+    if (a == mHalfedges.size()) mHalfedges.push_back(b);
+    else mHalfedges[a] = b;
+    if (b < 0) return;
+    if (static_cast<size_t>(b) == mHalfedges.size()) mHalfedges.push_back(static_cast<int>(a));
+    else mHalfedges[b] = static_cast<int>(a);
+}
+
+size_t Sweep::addTriangle(uint32_t i0, uint32_t i1, uint32_t i2, int a, int b, int c)
+{
+    const size_t t = mTriangles.size();
+    mTriangles.push_back(i0);
+    mTriangles.push_back(i1);
+    mTriangles.push_back(i2);
+    link(t, a);
+    link(t + 1, b);
+    link(t + 2, c);
+    return t;
+}
+
+// Flips edge a and the edges behind it until they are locally Delaunay, with a stack instead of recursion
+size_t Sweep::legalize(size_t a)
+{
+    size_t depth = 0;
+    size_t ar = 0;
+    mEdgeStack.clear();
+
+    while (true)
+    {
+        const int b = mHalfedges[a];
+        const size_t a0 = a - a % 3;
+        ar = a0 + (a + 2) % 3;
+
+        if (b < 0) {
+            if (depth == 0) break;
+            a = mEdgeStack[--depth];
+            continue;
+        }
+
+        const size_t b0 = b - b % 3;
+        const size_t al = a0 + (a + 1) % 3;
+        const size_t bl = b0 + (b + 2) % 3;
+        const uint32_t p0 = mTriangles[ar], pr = mTriangles[a], pl = mTriangles[al], p1 = mTriangles[bl];
+
+        // Is p1 inside the circumcircle of p0, pr, pl, exactly, so cocircular grid points never flip back and forth
+        const bool illegal = Predicates::InCircle(mPoints[p0], mPoints[pr], mPoints[pl], mPoints[p1]) < 0.0;
+
+        if (!illegal) {
+            if (depth == 0) break;
+            a = mEdgeStack[--depth];
+            continue;
+        }
+
+        mTriangles[a] = p1;
+        mTriangles[b] = p0;
+        const int hbl = mHalfedges[bl];
+        // The flipped edge was on the hull, so the hull has to point at its new halfedge
+        if (hbl < 0)
+        {
+            uint32_t e = mHullStart;
+            do {
+                if (mHullTri[e] == static_cast<int>(bl)) {
+                    mHullTri[e] = static_cast<int>(a);
+                    break;
+                }
+                e = mHullPrev[e];
+            } while (e != mHullStart);
+        }
+        link(a, hbl);
+        link(b, mHalfedges[ar]);
+        link(ar, static_cast<int>(bl));
+
+        const size_t br = b0 + (b + 1) % 3;
+        if (depth < mEdgeStack.size()) mEdgeStack[depth] = br;
+        else mEdgeStack.push_back(br);
+        ++depth;
+    }
+    return ar;
+}
+
+void Sweep::run()
+{
+    const uint32_t n = static_cast<uint32_t>(mPoints.size());
+    double minX = std::numeric_limits<double>::infinity(), minY = minX, maxX = -minX, maxY = -minX;
+    for (const QVector2D& point : mPoints)
+    {
+        minX = std::min<double>(minX, point.x());
+        minY = std::min<double>(minY, point.y());
+        maxX = std::max<double>(maxX, point.x());
+        maxY = std::max<double>(maxY, point.y());
+    }
+    const double midX = (minX + maxX) / 2, midY = (minY + maxY) / 2;
+    auto distance = [](double ax, double ay, double bx, double by) { return (ax - bx) * (ax - bx) + (ay - by) * (ay - by); };
+
+    // Seed triangle: the point nearest the middle, its nearest neighbour, and the point making the smallest circumcircle with them
+    uint32_t i0 = NoPoint, i1 = NoPoint, i2 = NoPoint;
+    double best = std::numeric_limits<double>::infinity();
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        const double d = distance(midX, midY, x(i), y(i));
+        if (d < best) { i0 = i; best = d; }
+    }
+    best = std::numeric_limits<double>::infinity();
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        const double d = distance(x(i0), y(i0), x(i), y(i));
+        if (i != i0 && d > 0.0 && d < best) { i1 = i; best = d; }
+    }
+    if (i1 == NoPoint) return;
+    best = std::numeric_limits<double>::infinity();
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        if (i == i0 || i == i1) continue;
+        if (Predicates::Orient2d(mPoints[i0], mPoints[i1], mPoints[i]) == 0.0) continue;   // Collinear, Circumcenter() falls back to the average then
+        const QVector2D center = Delaunay::Circumcenter(mPoints[i0], mPoints[i1], mPoints[i]);
+        const double r = distance(center.x(), center.y(), x(i0), y(i0));
+        if (r < best) { i2 = i; best = r; }
+    }
+    if (i2 == NoPoint) return;  // Every point on one line, there are no triangles
+    if (orient(i0, i1, i2)) std::swap(i1, i2);
+
+    // Exact circumcenter of the seed in double, everything is sorted by the distance to it
+    {
+        const double dx = x(i1) - x(i0), dy = y(i1) - y(i0), ex = x(i2) - x(i0), ey = y(i2) - y(i0);
+        const double bl = dx * dx + dy * dy, cl = ex * ex + ey * ey, d = 0.5 / (dx * ey - dy * ex);
+        mCenterX = x(i0) + (ey * bl - dy * cl) * d;
+        mCenterY = y(i0) + (dx * cl - ex * bl) * d;
+    }
+    std::vector<double> distances(n);
+    std::vector<uint32_t> ids(n);
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        distances[i] = distance(x(i), y(i), mCenterX, mCenterY);
+        ids[i] = i;
+    }
+    std::sort(ids.begin(), ids.end(), [&](uint32_t a, uint32_t b) { return distances[a] < distances[b] || (distances[a] == distances[b] && a < b); });
+
+    mHash.assign(static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(n)))), NoPoint);
+    mHullPrev.assign(n, 0);
+    mHullNext.assign(n, 0);
+    mHullTri.assign(n, -1);
+    mHullStart = i0;
+    mHullNext[i0] = mHullPrev[i2] = i1;
+    mHullNext[i1] = mHullPrev[i0] = i2;
+    mHullNext[i2] = mHullPrev[i1] = i0;
+    mHullTri[i0] = 0;
+    mHullTri[i1] = 1;
+    mHullTri[i2] = 2;
+    mHash[hashKey(x(i0), y(i0))] = i0;
+    mHash[hashKey(x(i1), y(i1))] = i1;
+    mHash[hashKey(x(i2), y(i2))] = i2;
+
+    const size_t firstTriangle = mTriangles.size();
+    const size_t maxTriangles = n < 3 ? 1 : 2 * size_t(n) - 5;
+    mTriangles.reserve(firstTriangle + maxTriangles * 3);
+    mHalfedges.reserve(maxTriangles * 3);
+    addTriangle(i0, i1, i2, -1, -1, -1);
+
+    double previousX = std::numeric_limits<double>::quiet_NaN(), previousY = previousX;
+    for (uint32_t i : ids)
+    {
+        const double px = x(i), py = y(i);
+        // Duplicates sort next to each other, only the first one is used
+        if (px == previousX && py == previousY) continue;
+        previousX = px;
+        previousY = py;
+        if (i == i0 || i == i1 || i == i2) continue;
+        if ((px == x(i0) && py == y(i0)) || (px == x(i1) && py == y(i1)) || (px == x(i2) && py == y(i2))) continue;
+
+        // A hull edge the point can see, starting from the hull point nearest in angle
+        uint32_t start = 0;
+        const size_t key = hashKey(px, py);
+        for (size_t j = 0; j < mHash.size(); ++j)
+        {
+            start = mHash[(key + j) % mHash.size()];
+            if (start != NoPoint && start != mHullNext[start]) break;
+        }
+        start = mHullPrev[start];
+        uint32_t e = start, q;
+        while (q = mHullNext[e], !orient(i, e, q))
+        {
+            e = q;
+            if (e == start) {
+                e = NoPoint;
+                break;
+            }
+        }
+        if (e == NoPoint) continue; // Not outside any edge, a near duplicate of a hull point
+
+        // Fan out from the visible edge, first forwards along the hull
+        size_t t = addTriangle(e, i, mHullNext[e], -1, -1, mHullTri[e]);
+        mHullTri[i] = static_cast<int>(legalize(t + 2));
+        mHullTri[e] = static_cast<int>(t);
+
+        uint32_t next = mHullNext[e];
+        while (q = mHullNext[next], orient(i, next, q))
+        {
+            t = addTriangle(next, i, q, mHullTri[i], -1, mHullTri[next]);
+            mHullTri[i] = static_cast<int>(legalize(t + 2));
+            mHullNext[next] = next; // Marks next as no longer on the hull
+            next = q;
+        }
+
+        // Then backwards, if the first visible edge was where the search started
+        if (e == start)
+        {
+            while (q = mHullPrev[e], orient(i, q, e))
+            {
+                t = addTriangle(q, i, e, -1, mHullTri[e], mHullTri[q]);
+                legalize(t + 2);
+                mHullTri[q] = static_cast<int>(t);
+                mHullNext[e] = e;
+                e = q;
+            }
+        }
+
+        mHullStart = mHullPrev[i] = e;
+        mHullNext[e] = mHullPrev[next] = i;
+        mHullNext[i] = next;
+        mHash[hashKey(px, py)] = i;
+        mHash[hashKey(x(e), y(e))] = e;
+    }
+}
+
+}
+
+void Delaunay::Triangulate(const std::vector<QVector2D> &points, std::vector<uint32_t> &oIndices, std::vector<int>* oHalfedges)
+{
+    if (points.size() < 3) return;
+
+    // The halfedges index the new triangles from 0, so the sweep writes into its own list when oIndices already holds some
+    std::vector<uint32_t> triangles;
+    std::vector<int> halfedges;
+    Sweep(points, oIndices.empty() ? oIndices : triangles, halfedges).run();
+    if (!triangles.empty()) oIndices.insert(oIndices.end(), triangles.begin(), triangles.end());
+    if (oHalfedges) oHalfedges->swap(halfedges);
+}
+
+void Delaunay::TriangulateTiled(const std::vector<QVector2D> &points, std::vector<uint32_t> &oIndices, const TileSettings &settings)
+{
+    const size_t count = points.size();
+    const size_t pointsPerTile = static_cast<size_t>(std::max(settings.pointsPerTile, 3));
+    if (count <= pointsPerTile || Parallel::ThreadCount() == 1) {
+        Triangulate(points, oIndices);
+        return;
+    }
+
+    QVector2D min = points.front(), max = min;
+    for (const QVector2D& point : points)
+    {
+        min = QVector2D(std::min(min.x(), point.x()), std::min(min.y(), point.y()));
+        max = QVector2D(std::max(max.x(), point.x()), std::max(max.y(), point.y()));
+    }
+    const QVector2D span(std::max(max.x() - min.x(), 1e-3f), std::max(max.y() - min.y(), 1e-3f));
+
+    // A fine grid of cells with a handful of points each, used both to gather the points of a tile and to find the points near a circle
+    // Tiles are square blocks of cells sized for pointsPerTile at the average density
+    const float cellSize = std::sqrt(span.x() * span.y() * PointsPerCell / count);
+    const int cellsX = std::max(1, static_cast<int>(std::ceil(span.x() / cellSize)));
+    const int cellsY = std::max(1, static_cast<int>(std::ceil(span.y() / cellSize)));
+    const int cellsPerTile = std::max(1, static_cast<int>(std::lround(std::sqrt(static_cast<double>(pointsPerTile) / PointsPerCell))));
+    const int tilesX = (cellsX + cellsPerTile - 1) / cellsPerTile;
+    const int tilesY = (cellsY + cellsPerTile - 1) / cellsPerTile;
+    const int tileCount = tilesX * tilesY;
+    const float tileSize = cellsPerTile * cellSize;
+    const float margin = std::clamp(settings.overlap, 0.0f, 1.0f) * tileSize;
+    auto cellColumn = [&](float x) { return std::clamp(static_cast<int>((x - min.x()) / cellSize), 0, cellsX - 1); };
+    auto cellRow = [&](float y) { return std::clamp(static_cast<int>((y - min.y()) / cellSize), 0, cellsY - 1); };
+
+    // Counting sort by row and then by cell within each row, keeping each cell in index order
+    // Each block counts its own rows so the scatter needs no atomics, the rows are then sorted by column in parallel
+    const unsigned blocks = Parallel::ThreadCount();
+    std::vector<uint32_t> cellOf(count);
+    std::vector<std::vector<size_t>> rowCounts(blocks);
+    Parallel::ForBlocks(0, count, [&](size_t begin, size_t end, unsigned block)
+    {
+        std::vector<size_t>& counts = rowCounts[block];
+        counts.assign(cellsY, 0);
+        for (size_t i = begin; i < end; ++i)
+        {
+            const int row = cellRow(points[i].y());
+            cellOf[i] = static_cast<uint32_t>(row * cellsX + cellColumn(points[i].x()));
+            ++counts[row];
+        }
+    }, blocks);
+    std::vector<size_t> rowStart(cellsY + 1, 0);
+    for (int y = 0; y < cellsY; ++y)
+    {
+        size_t position = rowStart[y];
+        for (std::vector<size_t>& counts : rowCounts)
+        {
+            if (counts.empty()) continue; // Blocks past the point count never ran
+            const size_t rowCount = counts[y];
+            counts[y] = position;
+            position += rowCount;
+        }
+        rowStart[y + 1] = position;
+    }
+    std::vector<uint32_t> byRow(count);
+    Parallel::ForBlocks(0, count, [&](size_t begin, size_t end, unsigned block)
+    {
+        std::vector<size_t>& next = rowCounts[block];
+        for (size_t i = begin; i < end; ++i) byRow[next[cellOf[i] / cellsX]++] = static_cast<uint32_t>(i);
+    }, blocks);
+    rowCounts = {};
+
+    std::vector<size_t> cellStart(static_cast<size_t>(cellsX) * cellsY + 1, 0);
+    std::vector<uint32_t> cellPoints(count);
+    cellStart.back() = count;
+    Parallel::For(0, cellsY, [&](size_t y)
+    {
+        size_t* start = cellStart.data() + y * cellsX;
+        for (size_t i = rowStart[y]; i < rowStart[y + 1]; ++i) ++start[cellOf[byRow[i]] % cellsX];
+        size_t position = rowStart[y];
+        for (int x = 0; x < cellsX; ++x) {
+            const size_t cellCount = start[x];
+            start[x] = position;
+            position += cellCount;
+        }
+        thread_local std::vector<size_t> next;
+        next.assign(start, start + cellsX);
+        for (size_t i = rowStart[y]; i < rowStart[y + 1]; ++i) cellPoints[next[cellOf[byRow[i]] % cellsX]++] = byRow[i];
+    }, 16);
+    byRow = {};
+
+    // The tile a point belongs to (its home tile)
+    auto home = [&](uint32_t i) { return static_cast<int>((cellOf[i] / cellsX) / cellsPerTile * tilesX + (cellOf[i] % cellsX) / cellsPerTile); };
+
+    // Where the points are relative to the circumcircle of a, b, c: 1 when one is inside, 0 when one is on the circle and -1 when it is empty
+    // Rows are visited from the middle of the circle outwards, so a circle with points inside usually stops at the first cell it looks at
+    auto circleTest = [&](uint32_t a, uint32_t b, uint32_t c)
+    {
+        const QVector2D center = Circumcenter(points[a], points[b], points[c]);
+        const float radius = points[a].distanceToPoint(center) * (1.0f + SearchSlack);
+        const int y0 = cellRow(center.y() - radius), y1 = cellRow(center.y() + radius), middle = cellRow(center.y());
+        int result = -1;
+        for (int step = 0; middle - step >= y0 || middle + step <= y1; ++step)
+        {
+            for (int y : { middle - step, middle + step })
+            {
+                if (y < y0 || y > y1 || (step == 0 && y != middle) || (step > 0 && y == middle)) continue;
+                // Width of the circle within this row of cells
+                const float nearY = std::clamp(center.y(), min.y() + y * cellSize, min.y() + (y + 1) * cellSize) - center.y();
+                if (nearY * nearY > radius * radius) continue;
+                const float halfWidth = std::sqrt(radius * radius - nearY * nearY);
+                const size_t rowBegin = cellStart[static_cast<size_t>(y) * cellsX + cellColumn(center.x() - halfWidth)];
+                const size_t rowEnd = cellStart[static_cast<size_t>(y) * cellsX + cellColumn(center.x() + halfWidth) + 1];
+                for (size_t i = rowBegin; i < rowEnd; ++i)
+                {
+                    const uint32_t d = cellPoints[i];
+                    if (d == a || d == b || d == c) continue;
+                    result = std::max(result, InCircle(points, a, b, c, d));
+                    if (result > 0) return result;
+                }
+            }
+        }
+        return result;
+    };
+
+    // A triangle is proven when no other point is on or inside its circumcircle, then it is in every Delaunay triangulation of the points
+    // Each tile hands out the proven triangles that touch one of its own points, and marks its points whose whole fan is proven as done
+    std::vector<std::vector<std::array<uint32_t, 3>>> proven(tileCount);
+    std::vector<char> done(count, 0);
+    Parallel::For(0, tileCount, [&](size_t t)
+    {
+        const int tx = static_cast<int>(t) % tilesX, ty = static_cast<int>(t) / tilesX;
+        const QVector2D low(min.x() + tx * tileSize - margin, min.y() + ty * tileSize - margin);
+        const QVector2D high(min.x() + (tx + 1) * tileSize + margin, min.y() + (ty + 1) * tileSize + margin);
+
+        // Points of this tile and its overlap, in index order so every tile sees shared points in the same order
+        std::vector<uint32_t> local;
+        const int x0 = cellColumn(low.x()), x1 = cellColumn(high.x());
+        for (int y = cellRow(low.y()); y <= cellRow(high.y()); ++y)
+            for (size_t i = cellStart[static_cast<size_t>(y) * cellsX + x0]; i < cellStart[static_cast<size_t>(y) * cellsX + x1 + 1]; ++i)
+            {
+                const QVector2D& point = points[cellPoints[i]];
+                if (point.x() >= low.x() && point.x() <= high.x() && point.y() >= low.y() && point.y() <= high.y()) local.push_back(cellPoints[i]);
+            }
+        if (local.empty()) return;
+        std::sort(local.begin(), local.end());
+
+        std::vector<QVector2D> localPoints(local.size());
+        for (size_t i = 0; i < local.size(); ++i) localPoints[i] = points[local[i]];
+        std::vector<uint32_t> localIndices;
+        std::vector<int> localHalfedges;
+        Triangulate(localPoints, localIndices, &localHalfedges);
+
+        // A point is done when its whole fan is proven and closed, which it is unless the point is on the hull of the local triangulation
+        // Flags per local point: 1 seen, 2 on the local hull, 4 next to a triangle that isn't proven
+        std::vector<uint8_t> fan(local.size(), 0);
+        for (size_t i = 0; i < localIndices.size(); i += 3)
+        {
+            const uint32_t v[3] = { local[localIndices[i]], local[localIndices[i + 1]], local[localIndices[i + 2]] };
+            if (home(v[0]) != static_cast<int>(t) && home(v[1]) != static_cast<int>(t) && home(v[2]) != static_cast<int>(t)) continue;
+
+            // The local triangulation is Delaunay, so when the circumcircle stays inside the tile and its overlap (where the tile has every point)
+            // nothing is inside it. Points on it would make the triangle one choice out of several, and a cocircular point always shows up
+            // as the far corner of a neighbour, so those three are all that need checking
+            const QVector2D center = Circumcenter(points[v[0]], points[v[1]], points[v[2]]);
+            const float reach = points[v[0]].distanceToPoint(center) * (1.0f + SearchSlack);
+            bool isProven = center.x() - reach >= low.x() && center.x() + reach <= high.x() && center.y() - reach >= low.y() && center.y() + reach <= high.y();
+            for (int k = 0; k < 3; ++k)
+            {
+                const int twin = localHalfedges[i + k];
+                if (twin < 0) {
+                    fan[localIndices[i + k]] |= 2;
+                    fan[localIndices[i + (k + 1) % 3]] |= 2;
+                }
+                else if (isProven) {
+                    const uint32_t far = local[localIndices[twin - twin % 3 + (twin % 3 + 2) % 3]];
+                    isProven = InCircle(points, v[0], v[1], v[2], far) < 0;
+                }
+            }
+            if (isProven) proven[t].push_back({ v[0], v[1], v[2] });
+            for (int k = 0; k < 3; ++k) fan[localIndices[i + k]] |= isProven ? 1 : 5;
+        }
+        for (size_t i = 0; i < local.size(); ++i)
+        {
+            const uint32_t point = local[i];
+            if (home(point) != static_cast<int>(t)) continue;   // Only the home tile writes a point's flag
+            if (fan[i] == 1) done[point] = 1;
+            // The sweep skips duplicates and keeps the one with the lowest index, the same one everywhere. A skipped one has to stay out of
+            // the second pass too, or it gets triangulated against the neighbours of its twin into triangles on top of the twin's
+            else if (fan[i] == 0) {
+                const size_t cell = cellOf[point];
+                for (size_t j = cellStart[cell]; j < cellStart[cell + 1]; ++j)
+                    if (cellPoints[j] < point && points[cellPoints[j]] == points[point]) {
+                        done[point] = 2;
+                        break;
+                    }
+            }
+        }
+    }, 1);
+
+    // Everything not surrounded by proven triangles is triangulated again in one piece, except the duplicates
+    std::vector<uint32_t> rest;
+    for (size_t i = 0; i < count; ++i)
+        if (!done[i]) rest.push_back(static_cast<uint32_t>(i));
+
+    // Proven triangles only show up twice when they span tiles, and the second pass can only repeat triangles whose corners are all in it
+    // Those are moved to the back of each tile's list and go through a sort to drop the copies, the rest are written straight out in parallel
+    std::vector<size_t> direct(tileCount + 1, 0);
+    Parallel::For(0, tileCount, [&](size_t t)
+    {
+        const auto shared = std::stable_partition(proven[t].begin(), proven[t].end(), [&](const std::array<uint32_t, 3>& tri)
+        {
+            const bool spansTiles = home(tri[0]) != static_cast<int>(t) || home(tri[1]) != static_cast<int>(t) || home(tri[2]) != static_cast<int>(t);
+            return !spansTiles && (done[tri[0]] || done[tri[1]] || done[tri[2]]);
+        });
+        direct[t + 1] = shared - proven[t].begin();
+    }, 1);
+    for (int t = 0; t < tileCount; ++t) direct[t + 1] += direct[t];
+    const size_t firstIndex = oIndices.size();
+    oIndices.resize(firstIndex + 3 * direct.back());
+    Parallel::For(0, tileCount, [&](size_t t)
+    {
+        uint32_t* out = oIndices.data() + firstIndex + 3 * direct[t];
+        for (size_t i = 0; i < direct[t + 1] - direct[t]; ++i, out += 3) std::copy(proven[t][i].begin(), proven[t][i].end(), out);
+    }, 1);
+    std::vector<std::array<uint32_t, 3>> shared;
+    for (int t = 0; t < tileCount; ++t)
+    {
+        for (size_t i = direct[t + 1] - direct[t]; i < proven[t].size(); ++i) shared.push_back(Canonical(proven[t][i][0], proven[t][i][1], proven[t][i][2]));
+        proven[t] = {};
+    }
+
+    if (rest.size() >= 3)
+    {
+        std::vector<QVector2D> restPoints(rest.size());
+        for (size_t i = 0; i < rest.size(); ++i) restPoints[i] = points[rest[i]];
+        std::vector<uint32_t> restIndices;
+        Triangulate(restPoints, restIndices);
+
+        // A triangle of the subset can reach over proven ones, those have points of the full set inside their circumcircle
+        std::vector<std::vector<std::array<uint32_t, 3>>> kept(blocks);
+        Parallel::ForBlocks(0, restIndices.size() / 3, [&](size_t begin, size_t end, unsigned block)
+        {
+            for (size_t i = 3 * begin; i < 3 * end; i += 3)
+            {
+                const uint32_t a = rest[restIndices[i]], b = rest[restIndices[i + 1]], c = rest[restIndices[i + 2]];
+                if (circleTest(a, b, c) <= 0)
+                    kept[block].push_back(Canonical(a, b, c));
+            }
+        }, blocks);
+        for (const std::vector<std::array<uint32_t, 3>>& triangles : kept) shared.insert(shared.end(), triangles.begin(), triangles.end());
+    }
+
+    std::sort(shared.begin(), shared.end());
+    shared.erase(std::unique(shared.begin(), shared.end()), shared.end());
+    for (const std::array<uint32_t, 3>& tri : shared) oIndices.insert(oIndices.end(), tri.begin(), tri.end());
+}
+
+// Based on https://github.com/delfrrr/delaunator-cpp
+QVector2D Delaunay::Circumcenter(const QVector2D &A, const QVector2D &B, const QVector2D &C)
+{
+    const QVector2D D{B - A};
+    const QVector2D E{C - A};
+
+    const double b1 = QVector2D::dotProduct(D, D);
+    const double c1 = QVector2D::dotProduct(E, E);
+    const double d = 2 * (D.x() * E.y() - D.y() * E.x()); // QVector2D has no crossProduct function
+
+    if (std::abs(d) < 1e-9) return (A + B + C) / 3; // Points are collinear, return the average position
+
+    const QVector2D num(E.y() * b1 - D.y() * c1, D.x() * c1 - E.x() * b1);
+    return A + num / d;
+}
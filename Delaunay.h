@@ -0,0 +1,35 @@
+#ifndef DELAUNAY_H
+#define DELAUNAY_H
+
+#include <QVector2D>
+#include <vector>
+
+// 2D Delaunay triangulation of terrain points in the XZ plane, split out of PointCloud so it can run on its own
+namespace Delaunay
+{
+
+QVector2D Circumcenter(const QVector2D& A, const QVector2D& B, const QVector2D& C);
+
+// Sweep-hull triangulation in O(n log n) on the calling thread, appends three indices per triangle to oIndices
+// Triangles wind so their face normals point up (+Y) once x and y of the points are used as world X and Z
+// oHalfedges gets the twin of every halfedge, halfedge 3t + k runs from corner k to corner k + 1 of the t-th new triangle, -1 on the convex hull
+// Duplicate points are skipped, and collinear input gives no triangles
+void Triangulate(const std::vector<QVector2D>& points, std::vector<uint32_t>& oIndices, std::vector<int>* oHalfedges = nullptr);
+
+struct TileSettings
+{
+    int pointsPerTile{16384};   // Tile size is picked so a tile holds about this many points, more means fewer seams and less overlap to triangulate twice
+    float overlap{0.1f};        // Each tile also triangulates this fraction of a tile size around itself, the seams go into the second pass when it is too small
+};
+
+// Same result as Triangulate() for points in general position, but the points are split into overlapping square tiles triangulated in parallel
+// A tile only keeps the triangles it can prove are in the global triangulation: the circumcircle has to lie inside the tile and its overlap,
+// and no neighbouring corner may be on it. The points that aren't surrounded by proven triangles (tile seams with too little overlap, the convex hull,
+// cocircular points) are triangulated again in one piece, and from that only the triangles with an empty circumcircle are kept
+// Everything but that second sweep runs on the worker pool, working memory per tile is bounded by the points in the tile and its overlap
+// Falls back to Triangulate() on a single thread, where the overlap only adds work
+void TriangulateTiled(const std::vector<QVector2D>& points, std::vector<uint32_t>& oIndices, const TileSettings& settings = TileSettings());
+
+}
+
+#endif // DELAUNAY_H
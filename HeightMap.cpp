@@ -1,6 +1,7 @@
 #include "HeightMap.h"
 #include "Vertex.h"
 #include "stb_image.h"
+#include <cmath>
 
 HeightMap::HeightMap()
 { }
@@ -96,3 +97,59 @@ void HeightMap::makeTerrain(unsigned char* textureData, int widthIn, int heightI
     //Function not made yet:
     //calculateHeighMapNormals();
 }
+
+void HeightMap::makeTerrain(const HeightGrid& inputGrid)
+{
+    if (inputGrid.width < 2 || inputGrid.depth < 2) return;
+
+    // A grid made with fillHoles off still has NaN nodes, they would become NaN vertices and normals, so they are filled here
+    size_t holes = 0;
+    for (float h : inputGrid.heights) holes += std::isnan(h);
+    if (holes == inputGrid.heights.size()) {
+        qDebug() << "ERROR: The height grid has no heights to make a terrain from";
+        return;
+    }
+    HeightGrid filledGrid;
+    if (holes > 0) {
+        filledGrid = inputGrid;
+        Rasterize::FillHoles(filledGrid);
+    }
+    const HeightGrid& grid = holes > 0 ? filledGrid : inputGrid;
+    mWidth = grid.width;
+    mHeight = grid.depth;
+    drawType = 2;
+
+    mVertices.clear();
+    mIndices.clear();
+    mVertices.reserve(static_cast<size_t>(grid.width) * grid.depth);
+    for (int d{0}; d < grid.depth; ++d)
+    {
+        for (int w{0}; w < grid.width; ++w)
+        {
+            // Normal from the height differences to the neighbours, one sided at the edges
+            const int left = std::max(w - 1, 0), right = std::min(w + 1, grid.width - 1);
+            const int back = std::max(d - 1, 0), front = std::min(d + 1, grid.depth - 1);
+            const float slopeX = (grid.height(right, d) - grid.height(left, d)) / ((right - left) * grid.cellSize);
+            const float slopeZ = (grid.height(w, front) - grid.height(w, back)) / ((front - back) * grid.cellSize);
+            const QVector3D normal = QVector3D(-slopeX, 1.0f, -slopeZ).normalized();
+
+            mVertices.emplace_back(Vertex{grid.origin.x() + w * grid.cellSize, grid.height(w, d), grid.origin.y() + d * grid.cellSize,
+                normal.x(), normal.y(), normal.z(),           w / (grid.width - 1.f), d / (grid.depth - 1.f)});
+        }
+    }
+
+    // Same quads as above, but z grows with d here so the diagonal and the winding are mirrored to keep the faces pointing up
+    for (int d{0}; d < grid.depth - 1; ++d)
+    {
+        for (int w{0}; w < grid.width - 1; ++w)
+        {
+            const uint32_t corner = w + d * grid.width;
+            mIndices.emplace_back(corner);
+            mIndices.emplace_back(corner + grid.width);
+            mIndices.emplace_back(corner + grid.width + 1);
+            mIndices.emplace_back(corner);
+            mIndices.emplace_back(corner + grid.width + 1);
+            mIndices.emplace_back(corner + 1);
+        }
+    }
+}
@@ -2,6 +2,7 @@
 #define HEIGHTMAP_H
 
 #include "VisualObject.h"
+#include "Rasterize.h"
 #include <string>
 
 class HeightMap : public VisualObject
@@ -13,6 +14,10 @@ public:
 
     void makeTerrain(unsigned char* textureData, int width, int height);
 
+    // Terrain straight from a rasterized point cloud, in the grid's own world coordinates and with normals, drawn with phong
+    // Holes (NaN heights) are filled like Rasterize::FillHoles() does, a grid without any height makes nothing
+    void makeTerrain(const HeightGrid& grid);
+
 private:
 	int mWidth{ 0 };
 	int mHeight{ 0 };
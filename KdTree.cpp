@@ -0,0 +1,280 @@
+#include "KdTree.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <array>
+#include <numeric>
+
+namespace
+{
+
+// Deep enough for any tree that fits in memory, the stack never holds more than one entry per level
+constexpr int MaxStack = 64;
+
+struct StackEntry
+{
+    size_t node;
+    size_t begin;
+    size_t end;
+    float distanceSquared;  // Lower bound for any point below this node
+};
+
+// Inserts into a list sorted nearest first that holds at most k entries, returns the new size
+int InsertSorted(std::pair<float, int>* best, int count, int k, float distanceSquared, int index)
+{
+    if (count == k && distanceSquared >= best[k - 1].first) return count;
+    int i = count < k ? count++ : k - 1;
+    while (i > 0 && best[i - 1].first > distanceSquared) {
+        best[i] = best[i - 1];
+        --i;
+    }
+    best[i] = { distanceSquared, index };
+    return count;
+}
+
+}
+
+KdTree::KdTree(const std::vector<Vertex> &points, int leafSize)
+{
+    build(points, leafSize);
+}
+
+void KdTree::build(const std::vector<Vertex> &points, int leafSize)
+{
+    mLeafSize = std::max(1, leafSize);
+    mNodes.clear();
+    mPositions.clear();
+    mIndices.clear();
+    if (points.empty()) return;
+
+    // Ranges halve on every level, so the depth of the deepest leaf is known up front and the heap can be sized once
+    int depth = 0;
+    for (size_t count = points.size(); count > static_cast<size_t>(mLeafSize); count = (count + 1) / 2) ++depth;
+    mNodes.assign((size_t(2) << depth) - 1, Node());
+
+    std::vector<int> order(points.size());
+    std::iota(order.begin(), order.end(), 0);
+
+    // Split the top levels here until there are a few subtrees per thread, then build those in parallel
+    struct Range { size_t node, begin, end; };
+    std::vector<Range> frontier{ { 0, 0, points.size() } };
+    const size_t wanted = 4 * Parallel::ThreadCount();
+    while (frontier.size() < wanted)
+    {
+        std::vector<Range> next;
+        for (const Range& range : frontier)
+        {
+            if (range.end - range.begin <= static_cast<size_t>(mLeafSize)) {
+                next.push_back(range); // Already a leaf, buildNode() below just leaves it as one
+                continue;
+            }
+            buildNode(range.node, range.begin, range.end, order, points);
+            const size_t mid = range.begin + (range.end - range.begin) / 2;
+            next.push_back({ 2 * range.node + 1, range.begin, mid });
+            next.push_back({ 2 * range.node + 2, mid, range.end });
+        }
+        if (next.size() == frontier.size()) break; // Nothing left to split
+        frontier.swap(next);
+    }
+
+    // Each subtree only touches its own slice of order and its own nodes
+    Parallel::For(0, frontier.size(), [&](size_t f)
+    {
+        std::vector<Range> stack{ frontier[f] };
+        while (!stack.empty())
+        {
+            const Range range = stack.back();
+            stack.pop_back();
+            if (range.end - range.begin <= static_cast<size_t>(mLeafSize)) continue;
+
+            buildNode(range.node, range.begin, range.end, order, points);
+            const size_t mid = range.begin + (range.end - range.begin) / 2;
+            stack.push_back({ 2 * range.node + 1, range.begin, mid });
+            stack.push_back({ 2 * range.node + 2, mid, range.end });
+        }
+    }, 1);
+
+    // Copy the positions into tree order so the leaves are scanned sequentially
+    mPositions.resize(points.size() * 3);
+    Parallel::ForBlocks(0, order.size(), [&](size_t begin, size_t end, unsigned)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            const Vertex& v = points[order[i]];
+            mPositions[3 * i + 0] = v.x;
+            mPositions[3 * i + 1] = v.y;
+            mPositions[3 * i + 2] = v.z;
+        }
+    });
+    mIndices.swap(order);
+}
+
+// Splits [begin, end) at the middle along its widest axis
+void KdTree::buildNode(size_t node, size_t begin, size_t end, std::vector<int> &order, const std::vector<Vertex> &points)
+{
+    QVector3D min = points[order[begin]].pos(), max = min;
+    for (size_t i = begin + 1; i < end; ++i)
+    {
+        const QVector3D position = points[order[i]].pos();
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            min[axis] = std::min(position[axis], min[axis]);
+            max[axis] = std::max(position[axis], max[axis]);
+        }
+    }
+    const QVector3D extent = max - min;
+    const int axis = extent.x() >= extent.y() && extent.x() >= extent.z() ? 0 : (extent.y() >= extent.z() ? 1 : 2);
+
+    // Everything left of mid is <= the split and everything right of it is >=, which is all the search relies on
+    const size_t mid = begin + (end - begin) / 2;
+    std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end,
+                     [&](int a, int b) { return points[a].pos()[axis] < points[b].pos()[axis]; });
+
+    mNodes[node].axis = axis;
+    mNodes[node].split = points[order[mid]].pos()[axis];
+}
+
+void KdTree::nearest(const QVector3D &point, int k, std::vector<int> &oIndices, std::vector<float> *oDistancesSquared) const
+{
+    k = std::min<int>(k, static_cast<int>(size()));
+    std::vector<std::pair<float, int>> best(std::max(k, 0));
+    const int count = nearest(point, k, best.data());
+
+    oIndices.resize(count);
+    if (oDistancesSquared) oDistancesSquared->resize(count);
+    for (int i = 0; i < count; ++i)
+    {
+        oIndices[i] = best[i].second;
+        if (oDistancesSquared) (*oDistancesSquared)[i] = best[i].first;
+    }
+}
+
+int KdTree::nearest(const QVector3D &point, int k, std::pair<float, int> *oBest) const
+{
+    k = std::min<int>(k, static_cast<int>(size()));
+    if (k <= 0) return 0;
+    int count = 0;
+
+    std::array<StackEntry, MaxStack> stack;
+    int top = 0;
+    stack[top++] = { 0, 0, size(), 0.0f };
+    const float query[3] = { point.x(), point.y(), point.z() };
+
+    while (top > 0)
+    {
+        StackEntry entry = stack[--top];
+        if (count == k && entry.distanceSquared >= oBest[k - 1].first) continue;
+
+        // Walk down to a leaf, always taking the side the query is on and leaving the other side for later
+        while (mNodes[entry.node].axis >= 0)
+        {
+            const Node& node = mNodes[entry.node];
+            const size_t mid = entry.begin + (entry.end - entry.begin) / 2;
+            const float diff = query[node.axis] - node.split;
+            const StackEntry left{ 2 * entry.node + 1, entry.begin, mid, entry.distanceSquared };
+            const StackEntry right{ 2 * entry.node + 2, mid, entry.end, entry.distanceSquared };
+            StackEntry far = diff < 0.0f ? right : left;
+            far.distanceSquared = std::max(entry.distanceSquared, diff * diff);
+            stack[top++] = far;
+            entry = diff < 0.0f ? left : right;
+        }
+
+        for (size_t i = entry.begin; i < entry.end; ++i)
+        {
+            const float dx = mPositions[3 * i] - query[0];
+            const float dy = mPositions[3 * i + 1] - query[1];
+            const float dz = mPositions[3 * i + 2] - query[2];
+            count = InsertSorted(oBest, count, k, dx * dx + dy * dy + dz * dz, static_cast<int>(i));
+        }
+    }
+
+    // Tree order to source order
+    for (int i = 0; i < count; ++i) oBest[i].second = mIndices[oBest[i].second];
+    return count;
+}
+
+void KdTree::radius(const QVector3D &point, float radius, std::vector<int> &oIndices) const
+{
+    oIndices.clear();
+    if (empty()) return;
+
+    const float radiusSquared = radius * radius;
+    std::array<StackEntry, MaxStack> stack;
+    int top = 0;
+    stack[top++] = { 0, 0, size(), 0.0f };
+    const float query[3] = { point.x(), point.y(), point.z() };
+
+    while (top > 0)
+    {
+        StackEntry entry = stack[--top];
+        if (entry.distanceSquared > radiusSquared) continue;
+
+        while (mNodes[entry.node].axis >= 0)
+        {
+            const Node& node = mNodes[entry.node];
+            const size_t mid = entry.begin + (entry.end - entry.begin) / 2;
+            const float diff = query[node.axis] - node.split;
+            const StackEntry left{ 2 * entry.node + 1, entry.begin, mid, entry.distanceSquared };
+            const StackEntry right{ 2 * entry.node + 2, mid, entry.end, entry.distanceSquared };
+            StackEntry far = diff < 0.0f ? right : left;
+            far.distanceSquared = std::max(entry.distanceSquared, diff * diff);
+            if (far.distanceSquared <= radiusSquared) stack[top++] = far;
+            entry = diff < 0.0f ? left : right;
+        }
+
+        for (size_t i = entry.begin; i < entry.end; ++i)
+        {
+            const float dx = mPositions[3 * i] - query[0];
+            const float dy = mPositions[3 * i + 1] - query[1];
+            const float dz = mPositions[3 * i + 2] - query[2];
+            if (dx * dx + dy * dy + dz * dz <= radiusSquared) oIndices.push_back(mIndices[i]);
+        }
+    }
+}
+
+int KdTree::closest(const QVector3D &point, float *oDistanceSquared) const
+{
+    std::pair<float, int> best;
+    if (nearest(point, 1, &best) == 0) return -1;
+    if (oDistanceSquared) *oDistanceSquared = best.first;
+    return best.second;
+}
+
+void KdTree::nearestBatch(const std::vector<QVector3D> &queries, int k, std::vector<int> &oIndices) const
+{
+    oIndices.assign(queries.size() * std::max(k, 0), -1);
+    if (k <= 0) return;
+
+    Parallel::ForBlocks(0, queries.size(), [&](size_t begin, size_t end, unsigned)
+    {
+        std::vector<std::pair<float, int>> best(k);
+        for (size_t q = begin; q < end; ++q)
+        {
+            const int count = nearest(queries[q], k, best.data());
+            for (int i = 0; i < count; ++i) oIndices[q * k + i] = best[i].second;
+        }
+    });
+}
+
+void KdTree::radiusBatch(const std::vector<QVector3D> &queries, float radius, std::vector<int> &oIndices, std::vector<size_t> &oOffsets) const
+{
+    // Every block collects its results on the side, then they are joined in query order
+    const unsigned blocks = static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(Parallel::ThreadCount(), queries.size())));
+    std::vector<std::vector<int>> blockIndices(blocks);
+    oOffsets.assign(queries.size() + 1, 0);
+
+    Parallel::ForBlocks(0, queries.size(), [&](size_t begin, size_t end, unsigned block)
+    {
+        std::vector<int> neighbours;
+        for (size_t q = begin; q < end; ++q)
+        {
+            this->radius(queries[q], radius, neighbours);
+            blockIndices[block].insert(blockIndices[block].end(), neighbours.begin(), neighbours.end());
+            oOffsets[q + 1] = neighbours.size();
+        }
+    }, blocks);
+
+    for (size_t q = 0; q < queries.size(); ++q) oOffsets[q + 1] += oOffsets[q];
+    oIndices.clear();
+    oIndices.reserve(oOffsets.back());
+    for (const std::vector<int>& indices : blockIndices) oIndices.insert(oIndices.end(), indices.begin(), indices.end());
+}
@@ -0,0 +1,53 @@
+#ifndef KDTREE_H
+#define KDTREE_H
+
+#include <QVector3D>
+#include <vector>
+#include "Vertex.h"
+
+// Static KD-tree over point positions, for nearest neighbour and radius queries on raw points
+// The tree is implicit: every node splits its range of points at the middle, so the children of node n are 2n+1 and 2n+2
+// and only the split plane has to be stored. The positions are copied into tree order, so a leaf is one contiguous block of floats
+class KdTree
+{
+public:
+    KdTree() = default;
+    explicit KdTree(const std::vector<Vertex>& points, int leafSize = 16);
+
+    // Builds over the positions of points, the top levels are split on one thread and the subtrees below them in parallel
+    void build(const std::vector<Vertex>& points, int leafSize = 16);
+
+    size_t size() const { return mIndices.size(); }
+    bool empty() const { return mIndices.empty(); }
+
+    // Indices are into the points the tree was built from
+    // The k nearest points, nearest first. Fewer are returned if the tree holds fewer than k points
+    void nearest(const QVector3D& point, int k, std::vector<int>& oIndices, std::vector<float>* oDistancesSquared = nullptr) const;
+    // Every point within radius of point, in no particular order
+    void radius(const QVector3D& point, float radius, std::vector<int>& oIndices) const;
+    // The single nearest point, -1 if the tree is empty. Allocates nothing, so it is safe to call in tight parallel loops
+    int closest(const QVector3D& point, float* oDistanceSquared = nullptr) const;
+
+    // Runs nearest() for every query in parallel. oIndices gets k entries per query, padded with -1 when there are fewer than k points
+    void nearestBatch(const std::vector<QVector3D>& queries, int k, std::vector<int>& oIndices) const;
+    // Runs radius() for every query in parallel, the neighbours of query i are oIndices[oOffsets[i]] to oIndices[oOffsets[i + 1]]
+    void radiusBatch(const std::vector<QVector3D>& queries, float radius, std::vector<int>& oIndices, std::vector<size_t>& oOffsets) const;
+
+private:
+    struct Node
+    {
+        float split{0.0f};
+        int axis{-1};       // -1 for leaves
+    };
+
+    void buildNode(size_t node, size_t begin, size_t end, std::vector<int>& order, const std::vector<Vertex>& points);
+    // Fills oBest (room for k entries) nearest first with distance squared and source index, returns how many were found
+    int nearest(const QVector3D& point, int k, std::pair<float, int>* oBest) const;
+
+    std::vector<Node> mNodes;       // Heap order
+    std::vector<float> mPositions;  // x, y, z per point in tree order
+    std::vector<int> mIndices;      // Tree order to the index in the source points
+    int mLeafSize{16};
+};
+
+#endif // KDTREE_H
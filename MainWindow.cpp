@@ -13,6 +13,9 @@
 #include "VulkanWindow.h"
 #include "Renderer.h"
 #include "TriangleSurface.h"
+#include "PointTiles.h"
+#include "PointIO.h"
+#include "HeightMap.h"
 
 MainWindow::MainWindow(VulkanWindow *vw, QPlainTextEdit *logWidget)
     : mVulkanWindow(vw)
@@ -92,11 +95,15 @@ QMenuBar *MainWindow::createMenu()
     menuBar = new QMenuBar(this);
     fileMenu = new QMenu(tr("&File"), this);
     openFileAction = fileMenu->addAction(tr("&Open file..."));
+    buildTilesAction = fileMenu->addAction(tr("&Build point tiles..."));
+    openHeightGridAction = fileMenu->addAction(tr("Open point cloud as &height grid..."));
     exitAction = fileMenu->addAction(tr("E&xit"));
     menuBar->addMenu(fileMenu);
     menuBar->setVisible(true);
     //
     connect(openFileAction, &QAction::triggered, this, &MainWindow::openFile);
+    connect(buildTilesAction, &QAction::triggered, this, &MainWindow::buildTiles);
+    connect(openHeightGridAction, &QAction::triggered, this, &MainWindow::openHeightGrid);
     connect(exitAction, &QAction::triggered, qApp, &QCoreApplication::quit);
 
     return menuBar;
@@ -106,15 +113,80 @@ void MainWindow::openFile() // slot
     auto filnavn = QFileDialog::getOpenFileName(this);
     if (!filnavn.isEmpty())
     {
-        std::vector<Triangle> temp;
-        TriangleSurface* surf = new TriangleSurface(filnavn.toStdString(), temp);
+        //Reads the file on the loader threads and adds it to the scene when it is uploaded, so the window keeps running meanwhile
         auto rw = dynamic_cast<Renderer*>(mVulkanWindow->getRenderWindow());
-        rw->getObjects().push_back(surf);
-        rw->releaseResources();
-        rw->initResources();
+        const std::string filename = filnavn.toStdString();
+        rw->loadObject([filename]() -> VisualObject*
+        {
+            std::vector<Triangle> temp;
+            return new TriangleSurface(filename, temp);
+        });
     }
 }
 
+//Splits one or more point files (.las or .txt) into a tile file the Renderer can stream from
+void MainWindow::buildTiles() // slot
+{
+    const QStringList sources = QFileDialog::getOpenFileNames(this, tr("Point files"), QString(), tr("Point files (*.las *.txt)"));
+    if (sources.isEmpty())
+        return;
+    const QString tileFile = QFileDialog::getSaveFileName(this, tr("Tile file"), "terrain.tiles", tr("Tile files (*.tiles)"));
+    if (tileFile.isEmpty())
+        return;
+
+    std::vector<std::string> files;
+    for (const QString& source : sources)
+        files.push_back(source.toStdString());
+
+    //Can take minutes for large scans, so it runs on the loader threads and reports to the log
+    auto rw = dynamic_cast<Renderer*>(mVulkanWindow->getRenderWindow());
+    rw->assetLoader().submit([files, tileFile]()
+    {
+        if (PointTiles::Build(files, tileFile.toStdString()))
+            qDebug() << "Wrote" << tileFile << "- copy it to the assets folder as terrain.tiles to stream it";
+        else
+            qDebug() << "ERROR: Could not build" << tileFile;
+    });
+}
+
+//Rasterizes a point file (.las or .txt) into a regular height grid and shows it as a HeightMap terrain, much quicker than triangulating
+void MainWindow::openHeightGrid() // slot
+{
+    const QString source = QFileDialog::getOpenFileName(this, tr("Point file"), QString(), tr("Point files (*.las *.txt)"));
+    if (source.isEmpty())
+        return;
+    bool ok;
+    const double cellSize = QInputDialog::getDouble(this, tr("Height grid"), tr("Cell size (metres):"), 1.0, 0.01, 1000.0, 2, &ok);
+    if (!ok)
+        return;
+
+    auto rw = dynamic_cast<Renderer*>(mVulkanWindow->getRenderWindow());
+    const std::string filename = source.toStdString();
+    rw->loadObject([filename, cellSize]() -> VisualObject*
+    {
+        std::vector<Vertex> points;
+        AABB bounds;
+        if (!PointIO::ReadPoints(filename, points, bounds))
+            return nullptr;
+        Rasterize::Settings settings;
+        settings.cellSize = static_cast<float>(cellSize);
+        HeightGrid grid;
+        if (!Rasterize::Grid(points, grid, settings))
+            return nullptr;
+
+        //Like the streamed tiles: the middle of the points at the world origin and one world unit for 10 metres
+        const QVector3D center = bounds.center();
+        grid.origin -= QVector2D(center.x(), center.z());
+        for (float& height : grid.heights)
+            height -= center.y();
+        HeightMap* terrain = new HeightMap();
+        terrain->makeTerrain(grid);
+        terrain->scale(0.1f);
+        terrain->setColor({0.7, 0.7, 0.7});
+        return terrain;
+    });
+}
+
 void MainWindow::selectName()
 {
     bool ok;
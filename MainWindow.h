@@ -34,11 +34,15 @@ private:
     QMenuBar* menuBar{ nullptr };
     QMenu* fileMenu{ nullptr };
     QAction* openFileAction{ nullptr };
+    QAction* buildTilesAction{ nullptr };
+    QAction* openHeightGridAction{ nullptr };
     QAction* exitAction{ nullptr };
     std::string mSelectedName;
 
 private slots:
     void openFile();
+    void buildTiles();
+    void openHeightGrid();
     void selectName();
 };
 
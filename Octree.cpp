@@ -1,101 +1,326 @@
 #include "Octree.h"
+#include "Parallel.h"
 #include "Triangle.h"
+#include <algorithm>
+#include <array>
+#include <functional>
 
-Octree::Octree(std::vector<Triangle> &contentSource, const AABB &bounds, int depth, int maxDepth, int maxContent) : mContentSource(contentSource), mBounds(bounds), mDepth(depth), mMaxDepth(maxDepth), mMaxContent(maxContent)
+namespace
+{
+
+// Spreads the low 10 bits out to every third bit, for Z-order (Morton) keys
+uint32_t Spread(uint32_t x)
+{
+    x &= 0x3ff;
+    x = (x | (x << 16)) & 0x030000ff;
+    x = (x | (x << 8)) & 0x0300f00f;
+    x = (x | (x << 4)) & 0x030c30c3;
+    x = (x | (x << 2)) & 0x09249249;
+    return x;
+}
+
+// The subtrees from this level down are built in parallel, up to 512 of them
+constexpr int ParallelLevel = 3;
+
+// update() asks for a build() past this many added triangles, or a 256th of those in the tree when that is more
+constexpr size_t MinLooseLimit = 1024;
+
+}
+
+Octree::Octree(std::vector<Triangle> &contentSource, const AABB &bounds, int maxDepth, int maxContent) : mMaxDepth(maxDepth), mMaxContent(maxContent), mContentSource(contentSource), mBounds(bounds)
 {}
 
-void Octree::subdivide()
+void Octree::build(const std::vector<int> &iSkip)
 {
-    // Anthropic - Claude
-    QVector3D center = mBounds.center();
-    QVector3D halfSize = mBounds.size() * 0.5f;
-
-    for (int i = 0; i < 8; ++i) {
-        QVector3D offset(
-            // Bitwise AND operator - https://www.geeksforgeeks.org/c/bitwise-operators-in-c-cpp/
-            (i & 1) ? halfSize.x() * 0.5f : -halfSize.x() * 0.5f,
-            (i & 2) ? halfSize.y() * 0.5f : -halfSize.y() * 0.5f,
-            (i & 4) ? halfSize.z() * 0.5f : -halfSize.z() * 0.5f
-        );
-
-        QVector3D childMin = center + offset - halfSize * 0.5f;
-        QVector3D childMax = center + offset + halfSize * 0.5f;
-
-        mChildren[i] = std::make_unique<Octree>(mContentSource, AABB(childMin, childMax), mDepth + 1, mMaxDepth, mMaxContent);
+    mNodes.clear();
+    mIndices.clear();
+    mParents.clear();
+    mLoose.clear();
+    mLooseBounds.clear();
+    mLeafOf.assign(mContentSource.size(), NotIndexed);
+
+    // Skipped indices are taken out up front, the passes below go through source() to the triangle
+    std::vector<int> live;
+    if (!iSkip.empty())
+    {
+        std::vector<bool> skipped(mContentSource.size(), false);
+        for (int i : iSkip) skipped[i] = true;
+        for (int i = 0; i < static_cast<int>(mContentSource.size()); ++i)
+            if (!skipped[i]) live.push_back(i);
     }
-    // End of Claude generated section
+    auto source = [&](size_t i) { return live.empty() ? static_cast<int>(i) : live[i]; };
+    const size_t count = iSkip.empty() ? mContentSource.size() : live.size();
+    if (count == 0) return;
 
-    // Attempt distributing content to children
-    for (int index : mContent)
+    // The bounds of the triangles once for the root here and once more for their leaf, they aren't kept in between
+    const unsigned blocks = static_cast<unsigned>(std::min<size_t>(Parallel::ThreadCount(), count));
+    std::vector<AABB> blockBounds(blocks);
+    Parallel::ForBlocks(0, count, [&](size_t begin, size_t end, unsigned block)
     {
-        for (int i = 0; i < 8; ++i)
+        AABB total = TriangleHelpers::TriangleBounds(mContentSource[source(begin)]);
+        for (size_t i = begin + 1; i < end; ++i) total = total.merged(TriangleHelpers::TriangleBounds(mContentSource[source(i)]));
+        blockBounds[block] = total;
+    }, blocks);
+    AABB cell = mBounds.size().isNull() ? blockBounds[0] : mBounds;
+    for (const AABB& total : blockBounds) cell = cell.merged(total);
+
+    // Morton code of the centroid on the finest level, sorted so every node is one range of the keys and its children split it in eight
+    const int levels = std::clamp(mMaxDepth, 0, 10);
+    const uint32_t cells = 1u << levels;
+    const QVector3D size = cell.size();
+    auto coordinate = [&](float value, float min, float extent)
+    {
+        return extent > 0.0f ? std::min(static_cast<uint32_t>(std::max(0.0f, (value - min) / extent * cells)), cells - 1) : 0u;
+    };
+    std::vector<uint64_t> keys(count);
+    Parallel::ForBlocks(0, count, [&](size_t begin, size_t end, unsigned)
+    {
+        for (size_t i = begin; i < end; ++i)
         {
-            mChildren.at(i)->insert(index);
+            const Triangle& triangle = mContentSource[source(i)];
+            const QVector3D centroid = (triangle.v0 + triangle.v1 + triangle.v2) / 3.0f;
+            const uint32_t code = Spread(coordinate(centroid.x(), cell.mMin.x(), size.x())) | Spread(coordinate(centroid.y(), cell.mMin.y(), size.y())) << 1
+                                  | Spread(coordinate(centroid.z(), cell.mMin.z(), size.z())) << 2;
+            keys[i] = static_cast<uint64_t>(code) << 32 | static_cast<uint32_t>(source(i));
         }
+    }, blocks);
+
+    // LSD radix sort on the code, ten bits a pass. Each block counts its own digits so the scatter needs no atomics, and the
+    // scatter is stable, so equal codes stay in index order
+    std::vector<uint64_t> scratch(count);
+    std::vector<std::vector<size_t>> digitCounts(blocks);
+    for (int bit = 0; bit < 3 * levels; bit += 10)
+    {
+        const int shift = 32 + bit;
+        Parallel::ForBlocks(0, count, [&](size_t begin, size_t end, unsigned block)
+        {
+            std::vector<size_t>& counts = digitCounts[block];
+            counts.assign(1024, 0);
+            for (size_t i = begin; i < end; ++i) ++counts[(keys[i] >> shift) & 1023];
+        }, blocks);
+        size_t position = 0;
+        for (size_t digit = 0; digit < 1024; ++digit)
+        {
+            for (std::vector<size_t>& counts : digitCounts)
+            {
+                const size_t digitCount = counts[digit];
+                counts[digit] = position;
+                position += digitCount;
+            }
+        }
+        Parallel::ForBlocks(0, count, [&](size_t begin, size_t end, unsigned block)
+        {
+            std::vector<size_t>& next = digitCounts[block];
+            for (size_t i = begin; i < end; ++i) scratch[next[(keys[i] >> shift) & 1023]++] = keys[i];
+        }, blocks);
+        keys.swap(scratch);
     }
-    mContent.clear();
-}
+    scratch = {};
 
-void Octree::insert(int index)
-{
-    AABB triangleBounds = TriangleHelpers::TriangleBounds(mContentSource.at(index));
-    if (!mBounds.intersectsAABB(triangleBounds)) return; // If the triangle doesn't intersect with the cell just return
+    mIndices.resize(count);
+    Parallel::ForBlocks(0, count, [&](size_t begin, size_t end, unsigned)
+    {
+        for (size_t i = begin; i < end; ++i) mIndices[i] = static_cast<int>(static_cast<uint32_t>(keys[i]));
+    }, blocks);
 
-    // Triangle is likely to intersect with this cell so try adding it we'll ignore edge cases for now
-    if (isLeaf())
+    // The nodes only need the keys, each leaf is the range of mIndices its keys are in
+    // The children of a node are added together at the end of nodes, so they come after their parent and next to each other
+    // With tasks, a node on ParallelLevel that would split is left for later and goes on the list instead
+    struct BuildTask
     {
-        if (mContent.size() < mMaxContent || mDepth >= mMaxDepth)
-        {
-            mContent.push_back(index);
+        uint32_t node;
+        AABB octant;
+        size_t begin;
+        size_t end;
+    };
+    std::vector<BuildTask> tasks;
+    auto split = [&](auto& self, std::vector<Node>& nodes, uint32_t node, const AABB& octant, size_t begin, size_t end, int level, bool toTasks) -> void
+    {
+        nodes[node].bounds = octant;
+        nodes[node].first = static_cast<uint32_t>(begin);
+        nodes[node].count = static_cast<uint32_t>(end - begin);
+        if (end - begin <= static_cast<size_t>(mMaxContent) || level == levels) return;
+        if (toTasks && level == ParallelLevel) {
+            tasks.push_back(BuildTask{ node, octant, begin, end });
             return;
         }
-        if (!mChildren[0]) subdivide();
+
+        const int shift = 32 + 3 * (levels - level - 1);
+        std::array<size_t, 9> ranges;
+        ranges[0] = begin;
+        uint32_t children = 0;
+        for (int i = 0; i < 8; ++i)
+        {
+            ranges[i + 1] = std::partition_point(keys.begin() + ranges[i], keys.begin() + end, [&](uint64_t key) { return static_cast<int>((key >> shift) & 7) <= i; }) - keys.begin();
+            if (ranges[i + 1] > ranges[i]) ++children;
+        }
+        const uint32_t first = static_cast<uint32_t>(nodes.size());
+        nodes.resize(first + children);
+        nodes[node].first = first;
+        nodes[node].count = children;
+        nodes[node].leaf = false;
+
+        const QVector3D center = octant.center();
+        uint32_t child = first;
+        for (int i = 0; i < 8; ++i)
+        {
+            if (ranges[i + 1] == ranges[i]) continue; // Empty octants get no node
+            const AABB childOctant(QVector3D((i & 1) ? center.x() : octant.mMin.x(), (i & 2) ? center.y() : octant.mMin.y(), (i & 4) ? center.z() : octant.mMin.z()),
+                                   QVector3D((i & 1) ? octant.mMax.x() : center.x(), (i & 2) ? octant.mMax.y() : center.y(), (i & 4) ? octant.mMax.z() : center.z()));
+            self(self, nodes, child++, childOctant, ranges[i], ranges[i + 1], level + 1, toTasks);
+        }
+    };
+    mNodes.resize(1);
+    split(split, mNodes, 0, cell, 0, count, 0, true);
+
+    // Every subtree goes into an array of its own, its root at 0, and they are joined after the top levels one by one
+    // The root takes the place of the task's node, the rest go on the end with their child offsets moved along
+    std::vector<std::vector<Node>> subtrees(tasks.size());
+    Parallel::For(0, tasks.size(), [&](size_t t)
+    {
+        const BuildTask& task = tasks[t];
+        subtrees[t].resize(1);
+        split(split, subtrees[t], 0, task.octant, task.begin, task.end, ParallelLevel, false);
+    }, 1);
+    for (size_t t = 0; t < tasks.size(); ++t)
+    {
+        const uint32_t base = static_cast<uint32_t>(mNodes.size()) - 1;
+        for (Node& node : subtrees[t])
+            if (!node.leaf) node.first += base;
+        mNodes[tasks[t].node] = subtrees[t][0];
+        mNodes.insert(mNodes.end(), subtrees[t].begin() + 1, subtrees[t].end());
+        subtrees[t] = {};
     }
-    for (int i = 0; i < 8; ++i)
+
+    // Leaves grow to cover their triangles, then every parent to cover its children, which are always further along
+    mParents.resize(mNodes.size());
+    mParents[0] = NotIndexed;
+    Parallel::For(0, mNodes.size(), [&](size_t n)
+    {
+        Node& node = mNodes[n];
+        if (!node.leaf) {
+            for (uint32_t c = node.first; c < node.first + node.count; ++c) mParents[c] = static_cast<uint32_t>(n);
+            return;
+        }
+        for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+            node.bounds = node.bounds.merged(TriangleHelpers::TriangleBounds(mContentSource[mIndices[i]]));
+            mLeafOf[mIndices[i]] = static_cast<uint32_t>(n);
+        }
+    }, 64);
+    for (size_t n = mNodes.size(); n-- > 0;)
     {
-        mChildren[i]->insert(index);
+        Node& node = mNodes[n];
+        if (node.leaf) continue;
+        for (uint32_t c = node.first; c < node.first + node.count; ++c) node.bounds = node.bounds.merged(mNodes[c].bounds);
     }
 }
 
-void Octree::query(const AABB &iBounds, std::vector<int> &oIndices) const
+bool Octree::update(const std::vector<int> &iChanged, const std::vector<int> &iAdded, const std::vector<int> &iRemoved)
 {
-    if (!mBounds.intersectsAABB(iBounds)) return;
+    if (mLoose.size() + iAdded.size() > std::max(MinLooseLimit, mIndices.size() / 256)) return false;
 
-    // https://cplusplus.com/reference/vector/vector/insert/
-    if (isLeaf()) oIndices.insert(oIndices.end(), mContent.begin(), mContent.end());
-    else
+    // The nodes from a touched leaf up are refit once each, marking stops where an earlier leaf's path already went
+    std::vector<bool> marked(mNodes.size(), false);
+    std::vector<uint32_t> refit;
+    auto mark = [&](uint32_t leaf)
     {
-        for (int i = 0; i < 8; ++i)
+        for (uint32_t n = leaf; n != NotIndexed && !marked[n]; n = mParents[n]) {
+            marked[n] = true;
+            refit.push_back(n);
+        }
+    };
+    auto leafOf = [&](int index) { return index >= 0 && static_cast<size_t>(index) < mLeafOf.size() ? mLeafOf[index] : NotIndexed; };
+    for (int index : iRemoved)
+    {
+        const uint32_t leaf = leafOf(index);
+        if (leaf == NotIndexed) continue;
+        if (leaf & Loose)
         {
-            if (mChildren[i]->mBounds.intersectsAABB(iBounds)) mChildren[i]->query(iBounds, oIndices);
+            // The last one on the list takes the place of the removed one
+            const uint32_t position = leaf & ~Loose;
+            mLoose[position] = mLoose.back();
+            mLooseBounds[position] = mLooseBounds.back();
+            mLeafOf[mLoose[position]] = Loose | position;
+            mLoose.pop_back();
+            mLooseBounds.pop_back();
         }
+        else
+        {
+            // Same in the leaf's range of mIndices, which gets one shorter. The bounds stay, the queries just find less in there
+            Node& node = mNodes[leaf];
+            int* const first = &mIndices[node.first];
+            *std::find(first, first + node.count, index) = first[node.count - 1];
+            --node.count;
+        }
+        mLeafOf[index] = NotIndexed;
+    }
+    for (int index : iAdded)
+    {
+        if (static_cast<size_t>(index) >= mLeafOf.size()) mLeafOf.resize(index + 1, NotIndexed);
+        if (mLeafOf[index] != NotIndexed) continue; // Already in, iChanged takes care of it
+        mLeafOf[index] = Loose | static_cast<uint32_t>(mLoose.size());
+        mLoose.push_back(index);
+        mLooseBounds.push_back(TriangleHelpers::TriangleBounds(mContentSource[index]));
+    }
+    for (int index : iChanged)
+    {
+        const uint32_t leaf = leafOf(index);
+        if (leaf == NotIndexed) continue;
+        if (leaf & Loose) mLooseBounds[leaf & ~Loose] = TriangleHelpers::TriangleBounds(mContentSource[index]);
+        else {
+            // Leaves at the depth limit can hold thousands, so the bounds only grow to take the triangle in, build() shrinks them again
+            mNodes[leaf].bounds = mNodes[leaf].bounds.merged(TriangleHelpers::TriangleBounds(mContentSource[index]));
+            mark(leaf);
+        }
+    }
+
+    // Children come after their parent in mNodes, so going backwards refits a node after everything below it
+    std::sort(refit.begin(), refit.end(), std::greater<uint32_t>());
+    for (uint32_t n : refit)
+    {
+        Node& node = mNodes[n];
+        if (node.leaf) continue;
+        node.bounds = mNodes[node.first].bounds;
+        for (uint32_t c = node.first + 1; c < node.first + node.count; ++c) node.bounds = node.bounds.merged(mNodes[c].bounds);
     }
+    return true;
 }
 
-void Octree::query(const QVector3D &iPoint, std::vector<int> &oIndices) const
+template <typename Overlaps>
+void Octree::collect(const Overlaps& overlaps, std::vector<int>& oIndices) const
 {
-    if (!mBounds.containsPoint(iPoint)) return;
-
-    if (isLeaf()) oIndices.insert(oIndices.end(), mContent.begin(), mContent.end());
-    else
+    if (!mNodes.empty() && overlaps(mNodes[0].bounds))
     {
-        for (int i = 0; i < 8; ++i)
+        // Depth first, with at most eight children waiting on each of the (at most 11) levels
+        std::array<uint32_t, 88> stack;
+        size_t size = 0;
+        stack[size++] = 0;
+        while (size > 0)
         {
-            if (mChildren[i]->mBounds.containsPoint(iPoint)) mChildren[i]->query(iPoint, oIndices);
+            const Node& node = mNodes[stack[--size]];
+            if (node.leaf) {
+                oIndices.insert(oIndices.end(), mIndices.begin() + node.first, mIndices.begin() + node.first + node.count);
+                continue;
+            }
+            for (uint32_t c = node.first; c < node.first + node.count; ++c)
+                if (overlaps(mNodes[c].bounds)) stack[size++] = c;
         }
     }
+    for (size_t i = 0; i < mLoose.size(); ++i)
+        if (overlaps(mLooseBounds[i])) oIndices.push_back(mLoose[i]);
 }
 
-void Octree::query(const Sphere &iSphere, std::vector<int> &oIndices) const
+void Octree::query(const AABB &iBounds, std::vector<int> &oIndices) const
 {
-    if (!mBounds.intersectsSphere(iSphere)) return;
+    collect([&](const AABB& bounds) { return bounds.intersectsAABB(iBounds); }, oIndices);
+}
 
-    if (isLeaf()) oIndices.insert(oIndices.end(), mContent.begin(), mContent.end());
-    else
-    {
-        for (int i = 0; i < 8; ++i)
-        {
-            if (mChildren[i]->mBounds.intersectsSphere(iSphere)) mChildren[i]->query(iSphere, oIndices);
-        }
-    }
+void Octree::query(const QVector3D &iPoint, std::vector<int> &oIndices) const
+{
+    collect([&](const AABB& bounds) { return bounds.containsPoint(iPoint); }, oIndices);
+}
+
+void Octree::query(const Sphere &iSphere, std::vector<int> &oIndices) const
+{
+    collect([&](const AABB& bounds) { return bounds.intersectsSphere(iSphere); }, oIndices);
 }
@@ -2,28 +2,62 @@
 #define OCTREE_H
 
 #include "AABB.h"
-#include <array>
+#include <cstdint>
+#include <vector>
 class Triangle;
 
+// Linear octree over the triangles in contentSource: the nodes sit in one array with the children of a node next to each other,
+// and each leaf is a range of one packed index array, so a query walks two arrays instead of chasing pointers around the heap
+// Each triangle is in the one leaf holding its centroid, and every node's bounds cover its octant and all it holds, so the
+// bounds can be larger than the octant. Queries return the leaves whose bounds they touch, no triangle is returned twice
 class Octree
 {
 public:
-    Octree(std::vector<Triangle> &contentSource, const AABB& bounds = AABB(), int depth = 0, int maxDepth = 6, int maxContent = 8);
+    Octree(std::vector<Triangle> &contentSource, const AABB& bounds = AABB(), int maxDepth = 6, int maxContent = 8);
 
-    AABB mBounds;
-    int mDepth;
     int mMaxDepth;
     int mMaxContent;
-    std::vector<int> mContent;
-    std::array<std::unique_ptr<Octree>, 8> mChildren;
-    std::vector<Triangle>& mContentSource;
 
-    bool isLeaf() const { return !mChildren[0]; }
-    void subdivide();
-    void insert(int index);
+    // Throws away the tree and makes it again from every triangle in the content source, call it when they change
+    // The root grows to take in every triangle. Leaves split past mMaxContent down to mMaxDepth (at most 10)
+    // Indices in iSkip are left out, like triangles that were removed without moving the ones after them
+    void build(const std::vector<int>& iSkip = {});
+
+    // Patches the tree for a few edited triangles instead of building it again. A changed triangle stays in its leaf, and the bounds
+    // from there up are refit. A removed one leaves its leaf, and an added one goes on a list that every query checks as well
+    // False without touching anything when that list would get long enough to slow the queries down, build() then
+    bool update(const std::vector<int>& iChanged, const std::vector<int>& iAdded, const std::vector<int>& iRemoved);
+
+    const AABB& bounds() const { return mNodes.empty() ? mBounds : mNodes[0].bounds; }
+    size_t nodeCount() const { return mNodes.size(); }
+
     void query(const AABB& iBounds, std::vector<int>& oIndices) const;
     void query(const QVector3D& iPoint, std::vector<int>& oIndices) const;
     void query(const Sphere& iSphere, std::vector<int>& oIndices) const;
+
+private:
+    struct Node
+    {
+        AABB bounds;
+        uint32_t first{0};      // First child in mNodes, or the first index in mIndices for a leaf
+        uint32_t count{0};      // Children, only the ones that hold something, or indices for a leaf
+        bool leaf{true};
+    };
+
+    template <typename Overlaps>
+    void collect(const Overlaps& overlaps, std::vector<int>& oIndices) const;
+
+    static constexpr uint32_t Loose = 0x80000000u;      // Flag in mLeafOf
+    static constexpr uint32_t NotIndexed = UINT32_MAX;
+
+    std::vector<Triangle>& mContentSource;
+    AABB mBounds;
+    std::vector<Node> mNodes;           // mNodes[0] is the root
+    std::vector<int> mIndices;          // Into mContentSource, leaf by leaf
+    std::vector<uint32_t> mParents;     // NotIndexed for the root
+    std::vector<uint32_t> mLeafOf;      // Node of each index in mContentSource, Loose | position in mLoose, or NotIndexed
+    std::vector<int> mLoose;            // Added by update() since the last build()
+    std::vector<AABB> mLooseBounds;
 };
 
 #endif // OCTREE_H
@@ -0,0 +1,63 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Minimal helpers for spreading loops over std::threads, the project doesn't link QtConcurrent or a TBB backend
+namespace Parallel
+{
+
+inline unsigned ThreadCount() { return std::max(1u, std::thread::hardware_concurrency()); }
+
+// Splits [begin, end) into one contiguous block per thread and calls function(blockBegin, blockEnd, blockIndex) for each
+// Use this when every thread needs its own output buffer that is merged afterwards
+template <typename Function>
+void ForBlocks(size_t begin, size_t end, Function function, unsigned blocks = ThreadCount())
+{
+    const size_t count = end > begin ? end - begin : 0;
+    blocks = static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(blocks, count)));
+    if (blocks == 1) {
+        function(begin, end, 0u);
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    workers.reserve(blocks - 1);
+    const size_t blockSize = count / blocks;
+    for (unsigned b = 1; b < blocks; ++b)
+    {
+        const size_t blockBegin = begin + b * blockSize;
+        const size_t blockEnd = (b + 1 == blocks) ? end : blockBegin + blockSize;
+        workers.emplace_back(function, blockBegin, blockEnd, b);
+    }
+    function(begin, begin + blockSize, 0u); // The calling thread takes the first block instead of idling
+    for (std::thread& worker : workers) worker.join();
+}
+
+// Calls function(i) for every i in [begin, end), handing out chunks of grainSize on demand so uneven work still balances
+template <typename Function>
+void For(size_t begin, size_t end, Function function, size_t grainSize = 256)
+{
+    std::atomic<size_t> next{begin};
+    auto worker = [&]()
+    {
+        for (size_t chunk = next.fetch_add(grainSize); chunk < end; chunk = next.fetch_add(grainSize))
+        {
+            const size_t chunkEnd = std::min(end, chunk + grainSize);
+            for (size_t i = chunk; i < chunkEnd; ++i) function(i);
+        }
+    };
+
+    const unsigned threads = static_cast<unsigned>(std::min<size_t>(ThreadCount(), (end - std::min(begin, end) + grainSize - 1) / grainSize));
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; ++t) workers.emplace_back(worker);
+    worker();
+    for (std::thread& w : workers) w.join();
+}
+
+}
+
+#endif // PARALLEL_H
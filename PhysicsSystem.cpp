@@ -1,10 +1,78 @@
 #include "PhysicsSystem.h"
+#include "Bvh.h"
 #include "Octree.h"
 #include "Sphere.h"
 #include "Triangle.h"
+#include <algorithm>
 
 PhysicsSystem::PhysicsSystem() {}
 
+// Here where Bvh is complete
+PhysicsSystem::~PhysicsSystem() = default;
+
+void PhysicsSystem::rebuildIndex()
+{
+    if (mCollisionIndex == CollisionIndex::Bvh && mBvh) mBvh->build(mFreeTriangles);
+    else if (mWorldSpace) mWorldSpace->build(mFreeTriangles);
+    mChangedTriangles.clear();
+    mAddedTriangles.clear();
+    mRemovedTriangles.clear();
+    mOtherIndexStale = true;
+}
+
+void PhysicsSystem::setCollisionIndex(CollisionIndex index)
+{
+    if (index == mCollisionIndex) return;
+    updateIndex();
+    mCollisionIndex = index;
+    // The one switched away from is up to date either way, so after this both are
+    if (mOtherIndexStale) rebuildIndex();
+    mOtherIndexStale = false;
+}
+
+int PhysicsSystem::addTriangle(const Triangle &triangle)
+{
+    int index = static_cast<int>(mTriangles.size());
+    if (mFreeTriangles.empty()) mTriangles.push_back(triangle);
+    else {
+        index = mFreeTriangles.back();
+        mFreeTriangles.pop_back();
+        mTriangles[index] = triangle;
+    }
+    mAddedTriangles.push_back(index);
+    return index;
+}
+
+void PhysicsSystem::changeTriangle(int index, const Triangle &triangle)
+{
+    mTriangles[index] = triangle;
+    mChangedTriangles.push_back(index);
+}
+
+void PhysicsSystem::removeTriangle(int index)
+{
+    // One added since the last update isn't in the index yet, it only has to come off the list
+    const auto added = std::find(mAddedTriangles.begin(), mAddedTriangles.end(), index);
+    if (added != mAddedTriangles.end()) mAddedTriangles.erase(added);
+    else mRemovedTriangles.push_back(index);
+    mFreeTriangles.push_back(index);
+}
+
+void PhysicsSystem::updateIndex()
+{
+    if (mChangedTriangles.empty() && mAddedTriangles.empty() && mRemovedTriangles.empty()) return;
+    const bool patched = mCollisionIndex == CollisionIndex::Bvh && mBvh ? mBvh->update(mChangedTriangles, mAddedTriangles, mRemovedTriangles)
+                                                                        : mWorldSpace && mWorldSpace->update(mChangedTriangles, mAddedTriangles, mRemovedTriangles);
+    if (!patched) {
+        rebuildIndex();
+        return;
+    }
+    mChangedTriangles.clear();
+    mAddedTriangles.clear();
+    mRemovedTriangles.clear();
+    mOtherIndexStale = true;
+}
+
 void PhysicsSystem::Update(float deltaTime)
 {
     for (Sphere& s : mSpheres)
@@ -15,12 +83,13 @@ void PhysicsSystem::Update(float deltaTime)
 
         QVector3D targetPosition = s.mPosition + s.mVelocity * deltaTime;
 
-        // For each Sphere use the Octree to find all triangles it can colide with
+        // For each Sphere use the Octree or the Bvh to find all triangles it can colide with
         std::vector<int> trisInReach;
 
         Sphere searchSphere = s;
         searchSphere.mRadius += s.mVelocity.length() * deltaTime; // This creates a sphere that covers all places the original sphere could occupy
-        mWorldSpace->query(searchSphere, trisInReach);
+        if (mCollisionIndex == CollisionIndex::Bvh && mBvh) mBvh->query(searchSphere, trisInReach);
+        else mWorldSpace->query(searchSphere, trisInReach);
 
         // Find the first collision along the current path
         SweepOperations::Collision earliest;
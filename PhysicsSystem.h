@@ -2,7 +2,9 @@
 #define PHYSICSSYSTEM_H
 
 #include <QVector3D>
+#include <memory>
 #include "vector"
+class Bvh;
 class Octree;
 class Triangle;
 class Sphere;
@@ -12,16 +14,41 @@ class PhysicsSystem
 {
 public:
     PhysicsSystem();
+    ~PhysicsSystem();
 
     QVector3D mGravity{0.0, -9.81, 0.0};
     std::vector<Sphere> mSpheres;
     std::vector<Triangle> mTriangles;
     Octree* mWorldSpace;
+    std::unique_ptr<Bvh> mBvh;
 
-    VisualObject* mSphereModel;
+    // Which of the two indices over mTriangles Update() asks for the triangles near a sphere
+    enum class CollisionIndex { Octree, Bvh };
+
+    VisualObject* mSphereModel{nullptr};
 
 
     void Update(float deltaTime);
+
+    // Call when mTriangles changes. Only the index in use is built, the other one waits until it is switched to
+    void rebuildIndex();
+    void setCollisionIndex(CollisionIndex index);
+    CollisionIndex collisionIndex() const { return mCollisionIndex; }
+
+    // Edits to mTriangles that leave every other index where it is, so the index in use can be patched instead of built again
+    // A new triangle takes the index of a removed one or goes on the end. updateIndex() hands the edits so far to the index
+    int addTriangle(const Triangle& triangle);
+    void changeTriangle(int index, const Triangle& triangle);
+    void removeTriangle(int index);
+    void updateIndex();
+
+private:
+    CollisionIndex mCollisionIndex{CollisionIndex::Octree};
+    bool mOtherIndexStale{true};
+    std::vector<int> mFreeTriangles;    // Removed from mTriangles, the indices leave them out until addTriangle() fills them again
+    std::vector<int> mChangedTriangles; // Edits since the index was last built or updated
+    std::vector<int> mAddedTriangles;
+    std::vector<int> mRemovedTriangles;
 };
 
 namespace SweepOperations
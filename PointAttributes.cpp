@@ -0,0 +1,73 @@
+#include "PointAttributes.h"
+#include <QDebug>
+#include <algorithm>
+#include <limits>
+
+void PointAttributes::resize(size_t count)
+{
+    intensity.resize(count);
+    returnNumber.resize(count);
+    numberOfReturns.resize(count);
+    classification.resize(count);
+}
+
+void PointAttributes::clear()
+{
+    intensity.clear();
+    returnNumber.clear();
+    numberOfReturns.clear();
+    classification.clear();
+}
+
+void PointAttributes::select(const std::vector<uint32_t> &order)
+{
+    auto pick = [&](auto& column)
+    {
+        std::remove_reference_t<decltype(column)> picked(order.size());
+        for (size_t i = 0; i < order.size(); ++i) picked[i] = column[order[i]];
+        column.swap(picked);
+    };
+    pick(intensity);
+    pick(returnNumber);
+    pick(numberOfReturns);
+    pick(classification);
+}
+
+size_t PointFilter::ByClass(std::vector<Vertex> &ioPoints, PointAttributes &ioAttributes, quint64 classMask, AABB &ioBounds)
+{
+    if (ioAttributes.size() != ioPoints.size()) {
+        if (!ioPoints.empty()) qDebug() << "No point classes to filter on, keeping all " << ioPoints.size() << " points.";
+        return 0;
+    }
+
+    // Compact every column in one pass, the classification column is the only one read
+    QVector3D min(std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity());
+    QVector3D max = -min;
+    size_t kept = 0;
+    for (size_t i = 0; i < ioPoints.size(); ++i)
+    {
+        if (!(classMask & PointClass::Bit(ioAttributes.classification[i]))) continue;
+
+        const QVector3D position = ioPoints[i].pos();
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            min[axis] = std::min(position[axis], min[axis]);
+            max[axis] = std::max(position[axis], max[axis]);
+        }
+
+        ioPoints[kept] = ioPoints[i];
+        ioAttributes.intensity[kept] = ioAttributes.intensity[i];
+        ioAttributes.returnNumber[kept] = ioAttributes.returnNumber[i];
+        ioAttributes.numberOfReturns[kept] = ioAttributes.numberOfReturns[i];
+        ioAttributes.classification[kept] = ioAttributes.classification[i];
+        ++kept;
+    }
+
+    const size_t removed = ioPoints.size() - kept;
+    ioPoints.resize(kept);
+    ioAttributes.resize(kept);
+    if (kept > 0) ioBounds = AABB(min, max);
+
+    qDebug() << "Class filter kept " << kept << " points and removed " << removed << ".";
+    return removed;
+}
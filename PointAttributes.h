@@ -0,0 +1,52 @@
+#ifndef POINTATTRIBUTES_H
+#define POINTATTRIBUTES_H
+
+#include <vector>
+#include "AABB.h"
+#include "Vertex.h"
+
+// ASPRS standard point classes used in LAS files
+namespace PointClass
+{
+constexpr int NeverClassified = 0;
+constexpr int Unclassified = 1;
+constexpr int Ground = 2;
+constexpr int LowVegetation = 3;
+constexpr int MediumVegetation = 4;
+constexpr int HighVegetation = 5;
+constexpr int Building = 6;
+constexpr int LowPoint = 7;
+constexpr int Water = 9;
+
+// Filters take a 64 bit mask with one bit per class, classes 64 and up are user defined and can't be selected
+constexpr quint64 Bit(int pointClass) { return pointClass < 64 ? 1ull << pointClass : 0; }
+constexpr quint64 GroundOnly = Bit(Ground);
+}
+
+// The per point LAS fields that don't fit in a Vertex, stored one column per field (structure of arrays)
+// Entry i of every column belongs to the i-th point, all columns are empty for sources without attributes (ASCII files)
+struct PointAttributes
+{
+    std::vector<quint16> intensity;
+    std::vector<quint8> returnNumber;       // 1 based
+    std::vector<quint8> numberOfReturns;
+    std::vector<quint8> classification;     // See PointClass
+
+    size_t size() const { return classification.size(); }
+    bool empty() const { return classification.empty(); }
+    void resize(size_t count);
+    void clear();
+    // Keeps entry order[i] as entry i, for when the points are picked out or reordered (see Simplification)
+    void select(const std::vector<uint32_t>& order);
+};
+
+namespace PointFilter
+{
+
+// Removes the points whose class isn't set in classMask, keeping ioPoints and ioAttributes in step and shrinking ioBounds to what is left
+// Points without attributes can't be filtered and are left alone, returns the number of points removed
+size_t ByClass(std::vector<Vertex>& ioPoints, PointAttributes& ioAttributes, quint64 classMask, AABB& ioBounds);
+
+}
+
+#endif // POINTATTRIBUTES_H
@@ -1,187 +1,141 @@
 #include "PointCloud.h"
+#include "ChangeDetection.h"
+#include "Delaunay.h"
+#include "Parallel.h"
+#include "PointIO.h"
+#include "PointNormals.h"
+#include "Simplification.h"
+#include "TerrainCache.h"
 #include "Triangle.h"
-#include <fstream>
-#include <iostream>
-#include <sstream>
-#include <limits>
+#include <algorithm>
+#include <cstring>
 
 
-PointCloud::PointCloud(const std::string &filename, const QVector3D &min, const QVector3D &max, std::vector<Triangle>& oTriangles)
+namespace
 {
-    drawType = 2;
-    // Open file
-    std::ifstream fileIn;
-    fileIn.open(filename, std::ifstream::in);
-    if (!fileIn) {
-        qDebug() << "ERROR: Could not open file for reading: " << filename.c_str();
-        return;
-    }
 
-    //Text variables
-    std::string oneLine{};
-    std::string oneWord{};
+// Everything in the options that changes the output has to be part of the cache key
+quint64 HashOptions(const PointCloudOptions& options)
+{
+    auto floatBits = [](float value) { quint32 bits; std::memcpy(&bits, &value, sizeof(bits)); return bits; };
 
-    std::vector<QVector3D> tempPoints;
+    quint64 hash = TerrainCache::HashCombine(options.classFilter, options.decimate);
+    hash = TerrainCache::HashCombine(hash, options.triangulate ? 0 : options.normalNeighbours);
+    if (!options.compareTo.empty()) hash = TerrainCache::HashCombine(hash, floatBits(options.changeRange)); // The reference file itself goes into the source hash
+    if (options.decimate)
+    {
+        hash = TerrainCache::HashCombine(hash, floatBits(options.decimation.cellSize));
+        hash = TerrainCache::HashCombine(hash, floatBits(options.decimation.lowerPercentile));
+        hash = TerrainCache::HashCombine(hash, floatBits(options.decimation.upperPercentile));
+        hash = TerrainCache::HashCombine(hash, options.decimation.clipAxis);
+    }
+    if (options.simplify)
+    {
+        hash = TerrainCache::HashCombine(hash, floatBits(options.simplification.tolerance));
+        hash = TerrainCache::HashCombine(hash, options.simplification.maxVertices);
+    }
+    return hash;
+}
 
-    float minX, minY, minZ;
-    minX = minY = minZ = std::numeric_limits<float>::infinity();
-    float maxX, maxY, maxZ;
-    maxX = maxY = maxZ = -std::numeric_limits<float>::infinity();
+}
 
+PointCloud::PointCloud(const std::string &filename, const QVector3D &min, const QVector3D &max, std::vector<Triangle>& oTriangles, const PointCloudOptions& options)
+{
+    const bool compare = !options.compareTo.empty();
+    drawType = compare ? (options.triangulate ? 0 : 4) : (options.triangulate ? 2 : 3);
+
+    // A matching cache holds the finished vertices, indices and collision triangles, so there is nothing left to compute
+    const std::string cacheFile = filename + ".cache";
+    TerrainCache::Key cacheKey{ 0, HashOptions(options), min, max };
+    const bool useCache = options.useCache && !(options.simplify && !options.simplification.lodTolerances.empty());
+    if (useCache)
     {
-        std::string arraySize{};
-        std::getline(fileIn, arraySize);
-
-        qDebug() << "Reading a pointcloud with " << arraySize << " points.";
+        cacheKey.sourceHash = TerrainCache::HashFile(filename);
+        if (compare) cacheKey.sourceHash = TerrainCache::HashCombine(cacheKey.sourceHash, TerrainCache::HashFile(options.compareTo));
+        if (TerrainCache::Load(cacheFile, cacheKey, mVertices, mIndices, oTriangles, mAttributes)) return;
     }
-    // For Each line read the coordinates and store as a vector3D
-    while (std::getline(fileIn, oneLine)) {
-        std::stringstream sStream;
-        //Pushing line into stream
-        sStream << oneLine;
-        //Streaming one word out of line
-        oneWord = ""; //resetting the value or else the last value might survive!
-        //sStream >> oneWord;
-
-        QVector3D tempVertex;
-        sStream >> oneWord;
-        tempVertex.setX(std::stof(oneWord));
-        sStream >> oneWord;
-        tempVertex.setY(std::stof(oneWord));
-        sStream >> oneWord;
-        tempVertex.setZ(std::stof(oneWord));
-
-        // Update extremes
-        minX = std::min(tempVertex.x(), minX);
-        minY = std::min(tempVertex.y(), minY);
-        minZ = std::min(tempVertex.z(), minZ);
-        maxX = std::max(tempVertex.x(), maxX);
-        maxY = std::max(tempVertex.y(), maxY);
-        maxZ = std::max(tempVertex.z(), maxZ);
-
-        tempPoints.push_back(tempVertex);
-        continue;
+    const size_t firstTriangle = oTriangles.size();
+
+    AABB sourceBounds;
+    std::array<double, 3> origin{};
+    if (!PointIO::ReadPoints(filename, mVertices, sourceBounds, &origin, &mAttributes)) return;
+
+    // Dropping vegetation and buildings first shrinks the triangulation input, and the terrain follows the ground instead of the tree tops
+    if (options.classFilter) PointFilter::ByClass(mVertices, mAttributes, options.classFilter, sourceBounds);
+    if (mVertices.empty()) return;
+
+    if (options.decimate)
+    {
+        Decimation::GridMedian(mVertices, sourceBounds, options.decimation);
+        mAttributes.clear(); // The medians are new points, no single source point's attributes belong to them
     }
 
+    // Distances in source units, before the points are scaled into the target box
+    std::vector<float> distances;
+    if (compare && !ChangeDetection::CloudToFile(mVertices, origin, options.compareTo, options.classFilter, distances))
+        qDebug() << "ERROR: Could not compare" << filename.c_str() << "to" << options.compareTo.c_str();
+
     QVector3D targetSpan = max - min;
     // Determine the expanse of each dimension
-    QVector3D spanMin(minX, minY, minZ);
-    QVector3D spanMax(maxX, maxY, maxZ);
-    QVector3D currentSpan = spanMax - spanMin;
+    QVector3D spanMin = sourceBounds.mMin;
+    QVector3D currentSpan = sourceBounds.size();
 
     QVector3D factor = targetSpan / currentSpan;
 
-    for (const QVector3D& p : tempPoints) {
-        QVector3D relP = p - spanMin;
+    // Normalise in place, the points were read straight into mVertices so there is no second copy to fill
+    for (Vertex& v : mVertices) {
+        QVector3D relP = v.pos() - spanMin;
 
-        Vertex adjustedP(relP * factor, QVector3D(0, 0, 0), QVector2D(factor.x(), factor.z()));
-        mVertices.push_back(adjustedP);
+        v = Vertex(relP * factor, QVector3D(0, 0, 0), QVector2D(factor.x(), factor.z()));
     }
-    // Create a super triangle that encompasses all points
-    const QVector2D superA(min.x(), min.z());
-    const QVector2D superB(min.x(), min.z() + 2 * targetSpan.z());
-    const QVector2D superC(min.x() + 2 * targetSpan.x(), min.z());
-    Delaunay::Triangle superTri(-2, -1, -3); // I need to iterate over this as well, but I'd like to keep its indices distinct so it'll be easier to remove the "scaffolding" later
-    superTri.circumCenter = Delaunay::Circumcenter(superA, superB, superB);
-    superTri.circumRadius = superA.distanceToPoint(superTri.circumCenter);
-    auto superIndex = [&](int index) -> QVector2D
-    {
-        switch (index) {
-        case -1:
-            return superA;
-        case -2:
-            return superB;
-        case -3:
-            return superC;
-        default:
-            if (index >= 0) return mVertices[index].poXZ();
-            throw std::out_of_range("");
-        }
-    };
 
-    std::vector<Delaunay::Triangle> tempTris{superTri};
-
-    // Add the point
-    for (int i = 0; i < mVertices.size(); ++i)
+    // Normals straight from the neighbourhood of each point, a fraction of the Delaunay cost for big scans
+    if (!options.triangulate)
     {
-        QVector2D point(mVertices[i].poXZ());
-        std::vector<Delaunay::Triangle> invalidatedTris;
-        std::vector<Delaunay::Edge> polygonEdges;
-
-        // If the point lies within the circumcircle of a triangle remove the triangle
-        for (const Delaunay::Triangle& tri : tempTris)
-        {
-            if (point.distanceToPoint(tri.circumCenter) <= tri.circumRadius)
-                invalidatedTris.push_back(tri);
-        }
-        // Find the edges of the abscense left by the triangles removed
-        for (const Delaunay::Triangle& tri : invalidatedTris)
-        {
-            std::vector<Delaunay::Edge> triEdges = {
-                Delaunay::Edge(tri.v0, tri.v1),
-                Delaunay::Edge(tri.v1, tri.v2),
-                Delaunay::Edge(tri.v2, tri.v0)
-            };
-            // We can ignore all edges between removed triangles
-            for (const Delaunay::Edge& edge : triEdges)
-            {
-                bool isShared{ false };
-                for (const Delaunay::Triangle& otherTri : invalidatedTris)
-                {
-                    if (&tri == &otherTri) continue;
-                    if ((otherTri.v0 == edge.v1 && otherTri.v1 == edge.v0) ||
-                        (otherTri.v1 == edge.v1 && otherTri.v2 == edge.v0) ||
-                        (otherTri.v2 == edge.v1 && otherTri.v0 == edge.v0))
-                    {
-                        isShared = true;
-                        break;
-                    }
-                }
-
-                if (!isShared)
-                    polygonEdges.push_back(edge);
-            }
-        }
+        if (compare) ChangeDetection::ColorByDistance(mVertices, distances, options.changeRange);
+        else PointNormals::Estimate(mVertices, options.normalNeighbours);
+        if (useCache)
+            TerrainCache::Save(cacheFile, cacheKey, mVertices, mIndices, nullptr, 0, mAttributes);
+        return;
+    }
 
-        // Remove all invalidated Triangles
-        for (auto tri = tempTris.begin(); tri != tempTris.end();)
-        {
-            bool isInvalid{ false };
-            for (const Delaunay::Triangle& badTri : invalidatedTris)
-            {
-                if (*tri == badTri)
-                {
-                    isInvalid = true;
-                    break;
-                }
-            }
-
-            if (isInvalid)
-                tri = tempTris.erase(tri);
-            else
-                ++tri;
+    if (options.simplify)
+    {
+        // The points are in the target box already, so the tolerances are scaled along with the heights
+        Simplification::Settings settings = options.simplification;
+        settings.tolerance *= factor.y();
+        for (float& tolerance : settings.lodTolerances) tolerance *= factor.y();
+        std::vector<uint32_t> kept;
+        Simplification::GreedyInsertion(mVertices, kept, mIndices, settings, &mLevels);
+        for (Simplification::Level& level : mLevels) {
+            level.tolerance /= factor.y();
+            level.maxError /= factor.y();
         }
 
-        // Create new triangles from the exposed edges
-        for (const Delaunay::Edge& edge : polygonEdges)
+        // Only the TIN vertices are kept, in insertion order so the LOD levels are a prefix of them
+        std::vector<Vertex> vertices(kept.size());
+        for (size_t i = 0; i < kept.size(); ++i) vertices[i] = mVertices[kept[i]];
+        mVertices.swap(vertices);
+        if (!mAttributes.empty()) mAttributes.select(kept);
+        if (!distances.empty())
         {
-            Delaunay::Triangle newTri(edge.v0, edge.v1, i);
-            newTri.circumCenter = Delaunay::Circumcenter(superIndex(newTri.v0), superIndex(newTri.v1), superIndex(newTri.v2));
-            newTri.circumRadius = superIndex(newTri.v0).distanceToPoint(newTri.circumCenter);
-            tempTris.push_back(newTri);
+            std::vector<float> keptDistances(kept.size());
+            for (size_t i = 0; i < kept.size(); ++i) keptDistances[i] = distances[kept[i]];
+            distances.swap(keptDistances);
         }
     }
-
-    // Store the indices of all remaining triangles, ignore those who are connected to the superTriangle
-    for (const Delaunay::Triangle& tri : tempTris)
+    else
     {
-        if (tri.v0 < 0 || tri.v1 < 0 || tri.v2 < 0) continue;
-
-        mIndices.push_back(tri.v0);
-        mIndices.push_back(tri.v1);
-        mIndices.push_back(tri.v2);
+        // Both give the same triangles (up to the choice between cocircular points), duplicates included, so the mode isn't part of the cache key
+        std::vector<QVector2D> positions(mVertices.size());
+        for (size_t i = 0; i < mVertices.size(); ++i) positions[i] = mVertices[i].poXZ();
+        if (options.parallelTriangulation) Delaunay::TriangulateTiled(positions, mIndices, options.tiles);
+        else Delaunay::Triangulate(positions, mIndices);
+    }
 
-        Vertex &vertex0 = mVertices[tri.v0], &vertex1 = mVertices[tri.v1], &vertex2 = mVertices[tri.v2];
+    for (size_t i = 0; i < mIndices.size(); i += 3)
+    {
+        Vertex &vertex0 = mVertices[mIndices[i]], &vertex1 = mVertices[mIndices[i + 1]], &vertex2 = mVertices[mIndices[i + 2]];
 
         Triangle newTri(vertex0.pos(), vertex1.pos(), vertex2.pos());
         oTriangles.push_back(newTri);
@@ -206,20 +160,120 @@ PointCloud::PointCloud(const std::string &filename, const QVector3D &min, const
         v.g = normal.y();
         v.b = normal.z();
     }
+    // The mesh is drawn with vertex colors then, the normals only went into the collision triangles
+    if (compare) ChangeDetection::ColorByDistance(mVertices, distances, options.changeRange);
+
+    if (useCache)
+        TerrainCache::Save(cacheFile, cacheKey, mVertices, mIndices, oTriangles.data() + firstTriangle, oTriangles.size() - firstTriangle, mAttributes);
+}
+
+bool PointCloud::prepareTriangulation()
+{
+    if (drawType != 0 && drawType != 2) return false;
+    if (mTriangulation.empty() && !mIndices.empty())
+    {
+        std::vector<QVector2D> positions(mVertices.size());
+        for (size_t i = 0; i < mVertices.size(); ++i) positions[i] = mVertices[i].poXZ();
+        mTriangulation.build(positions, mIndices);
+    }
+    return true;
+}
+
+bool PointCloud::sample(const QVector2D &position, uint32_t &ioHint, SurfaceSample &oSample) const
+{
+    const int triangle = mTriangulation.locate(position, ioHint);
+    oSample.triangle = std::max(triangle, -1);
+    if (triangle < 0) return false;
+
+    const uint32_t* corners = &mTriangulation.indices()[3 * oSample.triangle];
+    const QVector3D a = mVertices[corners[0]].pos(), b = mVertices[corners[1]].pos(), c = mVertices[corners[2]].pos();
+    const QVector3D ab = b - a, ac = c - a;
+    oSample.normal = QVector3D::crossProduct(ab, ac).normalized();
+
+    // Barycentric weights of b and c in the XZ plane
+    const float area = ab.x() * ac.z() - ab.z() * ac.x();
+    const float px = position.x() - a.x(), pz = position.y() - a.z();
+    const float u = (px * ac.z() - pz * ac.x()) / area, v = (ab.x() * pz - ab.z() * px) / area;
+    oSample.height = a.y() + u * ab.y() + v * ac.y();
+    return true;
+}
+
+bool PointCloud::surfaceAt(float x, float z, SurfaceSample &oSample)
+{
+    oSample = SurfaceSample();
+    return prepareTriangulation() && sample(QVector2D(x, z), mLastTriangle, oSample);
 }
 
-// Based on https://github.com/delfrrr/delaunator-cpp
-QVector2D Delaunay::Circumcenter(const QVector2D &A, const QVector2D &B, const QVector2D &C)
+void PointCloud::surfaceAt(const std::vector<QVector2D> &positions, std::vector<SurfaceSample> &oSamples)
 {
-    const QVector2D D{B - A};
-    const QVector2D E{C - A};
+    oSamples.assign(positions.size(), SurfaceSample());
+    if (!prepareTriangulation()) return;
+    Parallel::ForBlocks(0, positions.size(), [&](size_t begin, size_t end, unsigned)
+    {
+        uint32_t hint = mLastTriangle;
+        for (size_t i = begin; i < end; ++i) sample(positions[i], hint, oSamples[i]);
+    });
+}
 
-    const double b1 = QVector2D::dotProduct(D, D);
-    const double c1 = QVector2D::dotProduct(E, E);
-    const double d = 2 * (D.x() * E.y() - D.y() * E.x()); // QVector2D has no crossProduct function
+int PointCloud::insertPoint(const QVector3D &position)
+{
+    if (!prepareTriangulation()) return -1;
+    const int vertex = mTriangulation.insert(QVector2D(position.x(), position.z()));
+    if (vertex < 0) return -1;
+
+    // The uv holds the scale factor of the cloud, the normal is worked out in takeEdits()
+    const QVector2D uv = mVertices.empty() ? QVector2D(1.0f, 1.0f) : QVector2D(mVertices.front().u, mVertices.front().v);
+    mVertices.push_back(Vertex(position, QVector3D(0, 0, 0), uv));
+    if (!mAttributes.empty()) mAttributes.resize(mVertices.size());
+
+    // Without a distance to the earlier survey, a new point takes the color of a neighbour
+    std::vector<uint32_t> around;
+    mTriangulation.trianglesAround(vertex, around);
+    if (drawType == 0 && !around.empty())
+    {
+        const uint32_t* corners = &mTriangulation.indices()[3 * around.front()];
+        const Vertex& neighbour = mVertices[corners[0] != uint32_t(vertex) ? corners[0] : corners[1]];
+        mVertices.back().r = neighbour.r;
+        mVertices.back().g = neighbour.g;
+        mVertices.back().b = neighbour.b;
+    }
+    mEditedVertices.push_back(vertex);
+    return vertex;
+}
 
-    if (std::abs(d) < 1e-9) return (A + B + C) / 3; // Points are collinear, return the average position
+bool PointCloud::removePoint(uint32_t vertex)
+{
+    if (!prepareTriangulation()) return false;
+    return mTriangulation.remove(vertex);
+}
 
-    const QVector2D num(E.y() * b1 - D.y() * c1, D.x() * c1 - E.x() * b1);
-    return A + num / d;
+void PointCloud::takeEdits(std::vector<uint32_t> &oTriangles, std::vector<uint32_t> &oVertices)
+{
+    mTriangulation.takeChanges(oTriangles);
+    const std::vector<uint32_t>& indices = mTriangulation.indices();
+    mIndices.resize(indices.size());
+    for (uint32_t t : oTriangles)
+        std::copy_n(&indices[3 * t], 3, &mIndices[3 * t]);
+
+    // Every corner of a changed triangle may have a different set of triangles around it now
+    oVertices.swap(mEditedVertices);
+    mEditedVertices.clear();
+    for (uint32_t t : oTriangles) oVertices.insert(oVertices.end(), &indices[3 * t], &indices[3 * t + 3]);
+    std::sort(oVertices.begin(), oVertices.end());
+    oVertices.erase(std::unique(oVertices.begin(), oVertices.end()), oVertices.end());
+    if (drawType != 2) return;
+
+    // Same sum of triangle normals as the constructor, just for the vertices that need it
+    std::vector<uint32_t> around;
+    for (uint32_t i : oVertices)
+    {
+        mTriangulation.trianglesAround(i, around);
+        QVector3D normal;
+        for (uint32_t t : around)
+            normal += Triangle(mVertices[mIndices[3 * t]].pos(), mVertices[mIndices[3 * t + 1]].pos(), mVertices[mIndices[3 * t + 2]].pos()).normal;
+        normal.normalize();
+        mVertices[i].r = normal.x();
+        mVertices[i].g = normal.y();
+        mVertices[i].b = normal.z();
+    }
 }
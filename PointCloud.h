@@ -2,40 +2,75 @@
 #define POINTCLOUD_H
 
 #include "VisualObject.h"
+#include "Decimation.h"
+#include "Delaunay.h"
+#include "PointAttributes.h"
+#include "Simplification.h"
+#include "Triangulation.h"
 class Triangle;
-class PointCloud : public VisualObject
+
+// Optional processing steps PointCloud runs between reading the file and triangulating it
+struct PointCloudOptions
 {
-public:
-    PointCloud(const std::string& filename, const QVector3D& min, const QVector3D& max, std::vector<Triangle>& oTriangles);
+    quint64 classFilter{0};             // Only points of these classes are triangulated (see PointClass, e.g. PointClass::GroundOnly), 0 keeps everything
+    bool decimate{false};               // Run the grid median decimation, for raw LAS files that haven't been through importlas.py
+    Decimation::Settings decimation;
+    bool useCache{true};                // Load from and save to <filename>.cache, see TerrainCache
+    bool triangulate{true};             // false skips Delaunay, normals come from PointNormals and the cloud is drawn as shaded points without collision triangles
+    bool parallelTriangulation{true};   // Triangulate in overlapping tiles on the worker pool (Delaunay::TriangulateTiled), false runs one sweep on the calling thread
+    Delaunay::TileSettings tiles;
+    bool simplify{false};               // Triangulate only the points needed to keep the surface within simplification.tolerance (see Simplification)
+    Simplification::Settings simplification;    // Tolerances in source units (metres), the LOD levels aren't cached so setting any skips the cache
+    int normalNeighbours{16};           // Neighbourhood size for PointNormals when triangulate is off
+    std::string compareTo;              // Earlier survey of the same area, every point is colored by its distance to it (see ChangeDetection) instead of shaded
+    float changeRange{1.0f};            // Distance in source units (metres) that gets the full red, the object color has to be black for the vertex colors to show
 };
 
-namespace Delaunay
+// The terrain surface at one position, see PointCloud::surfaceAt()
+struct SurfaceSample
 {
+    float height{0.0f};
+    QVector3D normal{0.0f, 1.0f, 0.0f};  // Of the triangle, not interpolated between the vertex normals
+    int triangle{-1};                   // Index / 3 into getIndices(), which is also its slot among the cloud's collision triangles
+};
 
-QVector2D Circumcenter(const QVector2D& A, const QVector2D& B, const QVector2D& C);
-// For CircumRadius I might just take the distance between A and Circumcenter
-// Should probably be moved to it's own file but it can live here for now
-struct Triangle
+class PointCloud : public VisualObject
 {
-    int v0, v1, v2;
-    QVector2D circumCenter;
-    float circumRadius{0};
+public:
+    PointCloud(const std::string& filename, const QVector3D& min, const QVector3D& max, std::vector<Triangle>& oTriangles, const PointCloudOptions& options = PointCloudOptions());
 
-    Triangle(const int& a, const int& b, const int& c) : v0(a), v1(b), v2(c) {}
+    // In step with mVertices, empty for ASCII sources and after decimation
+    const PointAttributes& attributes() const { return mAttributes; }
+    // The coarser TINs asked for with PointCloudOptions::simplification.lodTolerances, coarsest first. They share the vertices of the
+    // full mesh (level i uses the first vertexCount), errors and tolerances are in source units
+    const std::vector<Simplification::Level>& levels() const { return mLevels; }
 
-    bool operator==(const Triangle& other) const {
-        return (v0 == other.v0 && v1 == other.v1 && v2 == other.v2) ||
-               (v0 == other.v1 && v1 == other.v2 && v2 == other.v0) ||
-               (v0 == other.v2 && v1 == other.v0 && v2 == other.v1);
-    }
-};
-struct Edge
-{
-    int v0, v1;
-    Edge(int a, int b) : v0(a), v1(b) {}
+    // Height, normal and triangle of the surface at (x, z) in the coordinates of getVertices(), false outside the mesh
+    // Walks the triangulation from the triangle the last query ended in, so a camera or a sphere moving over the terrain takes
+    // a few steps per query instead of an octree search. Only for triangulated clouds, like the edits below
+    bool surfaceAt(float x, float z, SurfaceSample& oSample);
+    // Many positions at once, spread over the threads with a walk each, positions next to each other in the list are quickest
+    // Positions outside the mesh get triangle -1
+    void surfaceAt(const std::vector<QVector2D>& positions, std::vector<SurfaceSample>& oSamples);
+
+    // Survey updates and live scan increments, without triangulating everything again. Only for triangulated clouds (drawType 0 and 2)
+    // position is in the coordinates of getVertices(), the new vertex index is returned (-1 if it isn't triangulated or a duplicate)
+    // Removed vertices stay in getVertices() without any triangle, so no index changes. Hand the edits to Renderer::applyEdits()
+    int insertPoint(const QVector3D& position);
+    bool removePoint(uint32_t vertex);
+    // Patches getIndices() and the vertex normals, then gives the triangles (index / 3) and vertices that changed since the last call
+    void takeEdits(std::vector<uint32_t>& oTriangles, std::vector<uint32_t>& oVertices);
+
+private:
+    // The triangulation is only made once the cloud is queried or edited, most are never touched and it is as big as the mesh
+    bool prepareTriangulation();
+    bool sample(const QVector2D& position, uint32_t& ioHint, SurfaceSample& oSample) const;
 
-    bool operator==(const Edge& other) const { return (v0 == other.v0 && v1 == other.v1) || (v0 == other.v1 && v1 == other.v0); }
+    PointAttributes mAttributes;
+    std::vector<Simplification::Level> mLevels;
+    Triangulation mTriangulation;
+    uint32_t mLastTriangle{0};          // Where the next surfaceAt() walk starts
+    std::vector<uint32_t> mEditedVertices;
 };
 
-}
 #endif // POINTCLOUD_H
@@ -0,0 +1,334 @@
+#include "PointIO.h"
+#include <QFile>
+#include <QDebug>
+#include "Parallel.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+
+inline bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+// Skips spaces and tabs, but stops at the end of the line so a short line can't steal values from the next one
+inline const char* SkipSpaces(const char* p, const char* end)
+{
+    while (p < end && IsSpace(*p)) ++p;
+    return p;
+}
+
+inline const char* NextLine(const char* p, const char* end)
+{
+    while (p < end && *p != '\n') ++p;
+    return p < end ? p + 1 : end;
+}
+
+// Files smaller than this are parsed on the calling thread, starting threads would cost more than it saves
+constexpr std::ptrdiff_t MinimumBlockBytes = 1 << 20;
+
+// Parses every "x y z" line in [p, end), which must start at the beginning of a line
+void ParseRange(const char* p, const char* end, std::vector<Vertex>& oVertices, AABB& oBounds)
+{
+    QVector3D min(std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity());
+    QVector3D max = -min;
+
+    while (p < end)
+    {
+        float xyz[3];
+        int i = 0;
+        for (; i < 3; ++i)
+        {
+            p = SkipSpaces(p, end);
+            std::from_chars_result result = std::from_chars(p, end, xyz[i]);
+            if (result.ec != std::errc()) break;
+            p = result.ptr;
+        }
+        p = NextLine(p, end); // Anything after the third value is ignored
+
+        if (i < 3) continue; // Blank or malformed line
+
+        // Update extremes
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            min[axis] = std::min(xyz[axis], min[axis]);
+            max[axis] = std::max(xyz[axis], max[axis]);
+        }
+
+        oVertices.emplace_back(xyz[0], xyz[1], xyz[2], 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+    }
+
+    oBounds = AABB(min, max);
+}
+
+}
+
+bool PointIO::ReadAscii(const std::string &filename, std::vector<Vertex> &oVertices, AABB &oBounds)
+{
+    QFile file(QString::fromStdString(filename));
+    if (!file.open(QIODevice::ReadOnly)) {
+        qDebug() << "ERROR: Could not open file for reading: " << filename.c_str();
+        return false;
+    }
+
+    // Map the whole file instead of streaming it, the parser then works directly on the file pages without copying lines out
+    const qint64 fileSize = file.size();
+    if (fileSize <= 0) return false;
+    uchar* mapped = file.map(0, fileSize);
+    if (!mapped) {
+        qDebug() << "ERROR: Could not map file: " << filename.c_str();
+        return false;
+    }
+
+    const char* p = reinterpret_cast<const char*>(mapped);
+    const char* end = p + fileSize;
+
+    // The first line holds the number of points, used to size the per thread buffers
+    size_t pointCount{0};
+    p = SkipSpaces(p, end);
+    std::from_chars(p, end, pointCount);
+    p = NextLine(p, end);
+
+    qDebug() << "Reading a pointcloud with " << pointCount << " points.";
+
+    // Cut the rest of the file into one byte range per thread, each moved forward to start right after a line break
+    const unsigned blocks = (end - p) < MinimumBlockBytes ? 1u : Parallel::ThreadCount();
+    std::vector<const char*> cuts(blocks + 1, end);
+    cuts[0] = p;
+    for (unsigned b = 1; b < blocks; ++b)
+        cuts[b] = std::max(cuts[b - 1], NextLine(p + (end - p) * b / blocks - 1, end));
+
+    std::vector<std::vector<Vertex>> blockVertices(blocks);
+    std::vector<AABB> blockBounds(blocks);
+    Parallel::ForBlocks(0, blocks, [&](size_t begin, size_t, unsigned)
+    {
+        std::vector<Vertex>& vertices = blockVertices[begin];
+        vertices.reserve(pointCount / blocks + 1);
+        ParseRange(cuts[begin], cuts[begin + 1], vertices, blockBounds[begin]);
+    }, blocks);
+
+    // Reduce the bounds, then append the blocks in file order, each block copying into its own slice of oVertices
+    QVector3D min = blockBounds[0].mMin, max = blockBounds[0].mMax;
+    std::vector<size_t> blockOffsets(blocks + 1, oVertices.size());
+    for (unsigned b = 0; b < blocks; ++b)
+    {
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            min[axis] = std::min(blockBounds[b].mMin[axis], min[axis]);
+            max[axis] = std::max(blockBounds[b].mMax[axis], max[axis]);
+        }
+        blockOffsets[b + 1] = blockOffsets[b] + blockVertices[b].size();
+    }
+
+    oVertices.resize(blockOffsets[blocks]);
+    Parallel::ForBlocks(0, blocks, [&](size_t begin, size_t, unsigned)
+    {
+        std::copy(blockVertices[begin].begin(), blockVertices[begin].end(), oVertices.begin() + blockOffsets[begin]);
+        std::vector<Vertex>().swap(blockVertices[begin]);
+    }, blocks);
+
+    file.unmap(mapped);
+
+    oBounds = AABB(min, max);
+    return true;
+}
+
+namespace
+{
+
+// Byte offsets into the LAS public header block, see the ASPRS LAS 1.4 R15 specification
+namespace LasHeader
+{
+constexpr int VersionMajor = 24;
+constexpr int VersionMinor = 25;
+constexpr int HeaderSize = 94;
+constexpr int PointDataOffset = 96;
+constexpr int PointFormat = 104;
+constexpr int PointRecordLength = 105;
+constexpr int LegacyPointCount = 107;
+constexpr int Scale = 131;
+constexpr int Offset = 155;
+constexpr int MinX = 187;
+constexpr int MinY = 203;
+constexpr int MinZ = 219;
+constexpr int PointCount = 247; // LAS 1.4 only, 64 bit
+constexpr int MinimumSize = 227;
+}
+
+template <typename T>
+T ReadValue(const uchar* data, int offset)
+{
+    T value;
+    std::memcpy(&value, data + offset, sizeof(T));
+    return value;
+}
+
+// Smallest legal record length for each supported point format
+int MinimumRecordLength(int format)
+{
+    switch (format) {
+    case 0: return 20;
+    case 1: return 28;
+    case 2: return 26;
+    case 3: return 34;
+    case 6: return 30;
+    default: return -1;
+    }
+}
+
+}
+
+bool PointIO::ReadLas(const std::string &filename, std::vector<Vertex> &oVertices, AABB &oBounds, std::array<double, 3>* oOrigin, PointAttributes* oAttributes)
+{
+    QFile file(QString::fromStdString(filename));
+    if (!file.open(QIODevice::ReadOnly)) {
+        qDebug() << "ERROR: Could not open file for reading: " << filename.c_str();
+        return false;
+    }
+
+    const qint64 fileSize = file.size();
+    if (fileSize < LasHeader::MinimumSize) {
+        qDebug() << "ERROR: File is too small to be a LAS file: " << filename.c_str();
+        return false;
+    }
+    uchar* data = file.map(0, fileSize);
+    if (!data) {
+        qDebug() << "ERROR: Could not map file: " << filename.c_str();
+        return false;
+    }
+
+    const int versionMajor = data[LasHeader::VersionMajor];
+    const int versionMinor = data[LasHeader::VersionMinor];
+    // Bit 7 of the format is set by LASzip, compressed files still have to go through importlas.py
+    const int format = data[LasHeader::PointFormat];
+    const int recordLength = ReadValue<quint16>(data, LasHeader::PointRecordLength);
+    const quint32 pointOffset = ReadValue<quint32>(data, LasHeader::PointDataOffset);
+
+    if (std::memcmp(data, "LASF", 4) != 0 || versionMajor != 1 || versionMinor < 2 || versionMinor > 4) {
+        qDebug() << "ERROR: Not a LAS 1.2 - 1.4 file: " << filename.c_str();
+        file.unmap(data);
+        return false;
+    }
+    if (MinimumRecordLength(format) < 0 || recordLength < MinimumRecordLength(format)) {
+        qDebug() << "ERROR: Unsupported LAS point format " << format << " in " << filename.c_str();
+        file.unmap(data);
+        return false;
+    }
+    // A truncated or corrupt header can point past the end, the count below would wrap around and the records run off the mapping
+    if (pointOffset < LasHeader::MinimumSize || pointOffset > fileSize) {
+        qDebug() << "ERROR: LAS point data offset " << pointOffset << " is outside the file: " << filename.c_str();
+        file.unmap(data);
+        return false;
+    }
+
+    quint64 pointCount = ReadValue<quint32>(data, LasHeader::LegacyPointCount);
+    if (versionMinor >= 4 && ReadValue<quint16>(data, LasHeader::HeaderSize) > LasHeader::PointCount)
+        pointCount = ReadValue<quint64>(data, LasHeader::PointCount);
+    // Never trust the count further than the file actually reaches
+    pointCount = std::min<quint64>(pointCount, (fileSize - pointOffset) / recordLength);
+
+    qDebug() << "Reading a LAS" << versionMajor << "." << versionMinor << "pointcloud with " << pointCount << " points.";
+
+    const double scale[3] = { ReadValue<double>(data, LasHeader::Scale), ReadValue<double>(data, LasHeader::Scale + 8), ReadValue<double>(data, LasHeader::Scale + 16) };
+    const double origin[3] = { ReadValue<double>(data, LasHeader::MinX), ReadValue<double>(data, LasHeader::MinY), ReadValue<double>(data, LasHeader::MinZ) };
+    if (oOrigin) *oOrigin = { origin[0], origin[2], origin[1] };
+    // Fold the header offset and our local origin into one term, so each coordinate is a single multiply-add
+    const double shift[3] = {
+        ReadValue<double>(data, LasHeader::Offset) - origin[0],
+        ReadValue<double>(data, LasHeader::Offset + 8) - origin[1],
+        ReadValue<double>(data, LasHeader::Offset + 16) - origin[2]
+    };
+
+    const size_t first = oVertices.size();
+    oVertices.resize(first + pointCount);
+    Vertex* out = oVertices.data() + first;
+    const uchar* record = data + pointOffset;
+
+    QVector3D min(std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity());
+    QVector3D max = -min;
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    // X and Y share one register and Z gets the other, the 16 byte load is safe since every record is at least 20 bytes long
+    const __m128d scaleXY = _mm_set_pd(scale[1], scale[0]);
+    const __m128d shiftXY = _mm_set_pd(shift[1], shift[0]);
+    const __m128d scaleZ = _mm_set_pd(0.0, scale[2]);
+    const __m128d shiftZ = _mm_set_pd(0.0, shift[2]);
+    __m128 minV = _mm_set1_ps(std::numeric_limits<float>::infinity());
+    __m128 maxV = _mm_set1_ps(-std::numeric_limits<float>::infinity());
+
+    for (quint64 i = 0; i < pointCount; ++i, record += recordLength)
+    {
+        const __m128i raw = _mm_loadu_si128(reinterpret_cast<const __m128i*>(record));
+        const __m128d xy = _mm_add_pd(_mm_mul_pd(_mm_cvtepi32_pd(raw), scaleXY), shiftXY);
+        const __m128d z = _mm_add_pd(_mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(raw, 8)), scaleZ), shiftZ);
+
+        // Lanes are x, y, z in LAS order, then reordered to x, height, y when stored
+        const __m128 position = _mm_movelh_ps(_mm_cvtpd_ps(xy), _mm_cvtpd_ps(z));
+        minV = _mm_min_ps(minV, position);
+        maxV = _mm_max_ps(maxV, position);
+
+        alignas(16) float p[4];
+        _mm_store_ps(p, position);
+        out[i] = Vertex(p[0], p[2], p[1], 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+    }
+
+    alignas(16) float lo[4], hi[4];
+    _mm_store_ps(lo, minV);
+    _mm_store_ps(hi, maxV);
+    min = QVector3D(lo[0], lo[2], lo[1]);
+    max = QVector3D(hi[0], hi[2], hi[1]);
+#else
+    for (quint64 i = 0; i < pointCount; ++i, record += recordLength)
+    {
+        const float x = static_cast<float>(ReadValue<qint32>(record, 0) * scale[0] + shift[0]);
+        const float y = static_cast<float>(ReadValue<qint32>(record, 4) * scale[1] + shift[1]);
+        const float z = static_cast<float>(ReadValue<qint32>(record, 8) * scale[2] + shift[2]);
+        const QVector3D position(x, z, y);
+
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            min[axis] = std::min(position[axis], min[axis]);
+            max[axis] = std::max(position[axis], max[axis]);
+        }
+        out[i] = Vertex(x, z, y, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+    }
+#endif
+
+    // The attributes get a pass of their own, so each column is written sequentially
+    if (oAttributes)
+    {
+        oAttributes->resize(first + pointCount);
+        // Formats 6 and up have 4 bit return fields and a whole byte for the class, the older ones pack the class with 3 flag bits
+        const bool extended = format >= 6;
+        record = data + pointOffset;
+        for (quint64 i = 0; i < pointCount; ++i, record += recordLength)
+        {
+            const uchar returns = record[14];
+            oAttributes->intensity[first + i] = ReadValue<quint16>(record, 12);
+            oAttributes->returnNumber[first + i] = extended ? (returns & 0x0F) : (returns & 0x07);
+            oAttributes->numberOfReturns[first + i] = extended ? (returns >> 4) : ((returns >> 3) & 0x07);
+            oAttributes->classification[first + i] = extended ? record[16] : (record[15] & 0x1F);
+        }
+    }
+
+    file.unmap(data);
+
+    oBounds = AABB(min, max);
+    return true;
+}
+
+bool PointIO::ReadPoints(const std::string &filename, std::vector<Vertex> &oVertices, AABB &oBounds, std::array<double, 3>* oOrigin, PointAttributes* oAttributes)
+{
+    std::string extension = filename.substr(filename.find_last_of('.') + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return std::tolower(c); });
+
+    if (extension == "las") return ReadLas(filename, oVertices, oBounds, oOrigin, oAttributes);
+    if (oOrigin) *oOrigin = { 0.0, 0.0, 0.0 };
+    return ReadAscii(filename, oVertices, oBounds);
+}
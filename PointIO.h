@@ -0,0 +1,32 @@
+#ifndef POINTIO_H
+#define POINTIO_H
+
+#include <array>
+#include <string>
+#include <vector>
+#include "AABB.h"
+#include "PointAttributes.h"
+#include "Vertex.h"
+
+// Loaders for raw point data, kept separate from PointCloud so they can be reused without building a VisualObject
+namespace PointIO
+{
+
+// Reads the ASCII format written by Tangentials/importlas.py: a point count on the first line followed by one "x y z" line per point
+// Only the position of each Vertex is filled in, oBounds receives the extremes of the points that were read
+bool ReadAscii(const std::string& filename, std::vector<Vertex>& oVertices, AABB& oBounds);
+
+// Reads an uncompressed LAS 1.2 - 1.4 file with point data format 0 - 3 or 6
+// LAS z is height, so it is stored in Vertex::y to match the ASCII files, and Vertex::z holds LAS y
+// Positions are stored relative to the minimum in the LAS header, otherwise UTM coordinates lose most of their decimals as floats
+// That minimum is written to oOrigin (in Vertex axis order) for callers that need to line several files up
+// Intensity, return numbers and classification go to oAttributes, which has to be in step with oVertices before the call
+bool ReadLas(const std::string& filename, std::vector<Vertex>& oVertices, AABB& oBounds, std::array<double, 3>* oOrigin = nullptr, PointAttributes* oAttributes = nullptr);
+
+// Picks a reader from the file extension, .las files use ReadLas and everything else is treated as ASCII
+// ASCII files are read as they are, so their origin is always zero, and they have no attributes
+bool ReadPoints(const std::string& filename, std::vector<Vertex>& oVertices, AABB& oBounds, std::array<double, 3>* oOrigin = nullptr, PointAttributes* oAttributes = nullptr);
+
+}
+
+#endif // POINTIO_H
@@ -0,0 +1,212 @@
+#include "PointLod.h"
+#include <QVector4D>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+#include <unordered_map>
+
+namespace
+{
+
+constexpr int MaxDepth = 20;   // Stops the split when thousands of points share one position
+
+float Coordinate(const Vertex& v, int axis) { return axis == 0 ? v.x : (axis == 1 ? v.y : v.z); }
+
+quint16 Quantize(float value, float origin, float extent)
+{
+    return static_cast<quint16>(std::lround(std::clamp((value - origin) / extent, 0.0f, 1.0f) * 65535.0f));
+}
+
+quint8 QuantizeColor(float value) { return static_cast<quint8>(std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f)); }
+
+}
+
+bool PointLod::Node::isLeaf() const
+{
+    return std::all_of(children.begin(), children.end(), [](int child) { return child < 0; });
+}
+
+PointLod::PointLod(std::vector<Vertex>&& points, const AABB& bounds, int nodeCapacity)
+{
+    // The octree is built on the full vertices and only packed at the end, so the sampling sees exact positions
+    std::vector<Vertex> vertices(std::move(points));
+    if (vertices.empty()) return;
+
+    // The octree works on a cube so all nodes on one level have the same spacing
+    const QVector3D size = bounds.size();
+    const float extent = std::max({ size.x(), size.y(), size.z(), 1e-3f });
+    Node root;
+    root.bounds = AABB(bounds.mMin, bounds.mMin + QVector3D(extent, extent, extent));
+    root.count = static_cast<quint32>(vertices.size());
+    mNodes.push_back(root);
+
+    // Sampling grid per node, scanned terrain is mostly a surface so about grid^2 cells end up occupied
+    const int grid = std::max(2, static_cast<int>(std::ceil(std::sqrt(static_cast<float>(nodeCapacity)))));
+
+    std::vector<std::pair<int, int>> stack{ { 0, 0 } };     // Node and depth
+    std::unordered_map<quint64, quint32> cells;             // Cell to the point closest to its centre
+    std::vector<quint32> chosen;
+    while (!stack.empty())
+    {
+        const auto [index, depth] = stack.back();
+        stack.pop_back();
+
+        // Copies, mNodes grows while the children are added
+        const AABB box = mNodes[index].bounds;
+        const quint32 first = mNodes[index].first;
+        const quint32 end = first + mNodes[index].count;
+        const float cellSize = box.size().x() / grid;
+        mNodes[index].spacing = cellSize;
+
+        // Small enough to keep everything
+        if (end - first <= static_cast<quint32>(nodeCapacity) || depth >= MaxDepth) continue;
+
+        // Keep the point nearest the centre of every occupied cell, that spreads the sample evenly whatever order the scanner wrote the points in
+        cells.clear();
+        for (quint32 i = first; i < end; ++i)
+        {
+            const QVector3D local = (vertices[i].pos() - box.mMin) / cellSize;
+            const quint64 cx = std::clamp(static_cast<int>(local.x()), 0, grid - 1);
+            const quint64 cy = std::clamp(static_cast<int>(local.y()), 0, grid - 1);
+            const quint64 cz = std::clamp(static_cast<int>(local.z()), 0, grid - 1);
+            const quint64 key = (cx * grid + cy) * grid + cz;
+            const QVector3D offset = local - QVector3D(cx + 0.5f, cy + 0.5f, cz + 0.5f);
+
+            auto [it, inserted] = cells.try_emplace(key, i);
+            if (inserted) continue;
+            const QVector3D best = (vertices[it->second].pos() - box.mMin) / cellSize - QVector3D(cx + 0.5f, cy + 0.5f, cz + 0.5f);
+            if (offset.lengthSquared() < best.lengthSquared()) it->second = i;
+        }
+
+        // Move the sample to the front of the range, sorted indices make the swaps safe
+        chosen.clear();
+        for (const auto& [key, point] : cells) chosen.push_back(point);
+        std::sort(chosen.begin(), chosen.end());
+        for (size_t j = 0; j < chosen.size(); ++j) std::swap(vertices[first + j], vertices[chosen[j]]);
+        mNodes[index].count = static_cast<quint32>(chosen.size());
+
+        // Split the rest into octants, octant bits are x << 2 | y << 1 | z
+        const QVector3D centre = box.center();
+        auto split = [&](quint32 begin, quint32 stop, int axis) -> quint32
+        {
+            auto middle = std::partition(vertices.begin() + begin, vertices.begin() + stop,
+                                         [&](const Vertex& v) { return Coordinate(v, axis) < centre[axis]; });
+            return static_cast<quint32>(middle - vertices.begin());
+        };
+        std::array<quint32, 9> ranges;
+        ranges[0] = first + static_cast<quint32>(chosen.size());
+        ranges[8] = end;
+        ranges[4] = split(ranges[0], ranges[8], 0);
+        ranges[2] = split(ranges[0], ranges[4], 1);
+        ranges[6] = split(ranges[4], ranges[8], 1);
+        for (int o = 1; o < 8; o += 2) ranges[o] = split(ranges[o - 1], ranges[o + 1], 2);
+
+        const QVector3D half = box.size() * 0.5f;
+        for (int o = 0; o < 8; ++o)
+        {
+            if (ranges[o + 1] == ranges[o]) continue;
+
+            Node child;
+            const QVector3D corner = box.mMin + QVector3D((o & 4) ? half.x() : 0.0f, (o & 2) ? half.y() : 0.0f, (o & 1) ? half.z() : 0.0f);
+            child.bounds = AABB(corner, corner + half);
+            child.first = ranges[o];
+            child.count = ranges[o + 1] - ranges[o];
+
+            const int childIndex = static_cast<int>(mNodes.size());
+            mNodes[index].children[o] = childIndex;
+            mNodes.push_back(child);
+            stack.emplace_back(childIndex, depth + 1);
+        }
+    }
+
+    // Pack inside the bounds that were given rather than the cube, that keeps the step small on the flat axis of a terrain tile
+    mOrigin = bounds.mMin;
+    mExtent = bounds.size();
+    for (int axis = 0; axis < 3; ++axis) mExtent[axis] = std::max(mExtent[axis], 1e-3f);
+    mPoints.resize(vertices.size());
+    for (size_t i = 0; i < vertices.size(); ++i)
+    {
+        const Vertex& v = vertices[i];
+        mPoints[i] = { Quantize(v.x, mOrigin.x(), mExtent.x()), Quantize(v.y, mOrigin.y(), mExtent.y()), Quantize(v.z, mOrigin.z(), mExtent.z()), 0,
+                       QuantizeColor(v.r), QuantizeColor(v.g), QuantizeColor(v.b), 255 };
+    }
+}
+
+QMatrix4x4 PointLod::pointMatrix() const
+{
+    QMatrix4x4 matrix;
+    matrix.translate(mOrigin);
+    matrix.scale(mExtent);
+    return matrix;
+}
+
+QVector3D PointLod::position(const Point &point) const
+{
+    return mOrigin + QVector3D(point.x, point.y, point.z) / 65535.0f * mExtent;
+}
+
+void PointLod::select(const std::vector<const PointLod*>& trees, const QMatrix4x4& viewProjection, const QVector3D& eye,
+                      float focalPixels, size_t pointBudget, float minPixels, std::vector<Selection>& oSelection)
+{
+    oSelection.clear();
+
+    // Side and far planes of the frustum (Gribb/Hartmann), the near plane is left out since it differs between GL and Vulkan depth ranges
+    const QVector4D r0 = viewProjection.row(0), r1 = viewProjection.row(1), r2 = viewProjection.row(2), r3 = viewProjection.row(3);
+    const std::array<QVector4D, 5> planes{ r3 + r0, r3 - r0, r3 + r1, r3 - r1, r3 - r2 };
+    auto visible = [&](const AABB& box)
+    {
+        for (const QVector4D& plane : planes)
+        {
+            // The corner furthest along the plane normal
+            const QVector3D corner(plane.x() > 0 ? box.mMax.x() : box.mMin.x(),
+                                   plane.y() > 0 ? box.mMax.y() : box.mMin.y(),
+                                   plane.z() > 0 ? box.mMax.z() : box.mMin.z());
+            if (QVector3D::dotProduct(plane.toVector3D(), corner) + plane.w() < 0.0f) return false;
+        }
+        return true;
+    };
+    // Pixels covered by a length at the distance of a node, infinite once the eye is inside it
+    auto projected = [&](const AABB& box, float length)
+    {
+        const float distance = eye.distanceToPoint(box.center()) - box.size().length() * 0.5f;
+        if (distance <= 0.0f) return std::numeric_limits<float>::max();
+        return length * focalPixels / distance;
+    };
+
+    struct Candidate
+    {
+        float priority;
+        int tree;
+        int node;
+        bool operator<(const Candidate& other) const { return priority < other.priority; }
+    };
+    std::priority_queue<Candidate> candidates;
+    for (int t = 0; t < static_cast<int>(trees.size()); ++t)
+    {
+        if (trees[t]->mNodes.empty()) continue;
+        const Node& root = trees[t]->mNodes[0];
+        if (visible(root.bounds)) candidates.push({ projected(root.bounds, root.bounds.size().length()), t, 0 });
+    }
+
+    // Biggest on screen first, stop at the first node that doesn't fit so the budget bounds the frame time
+    size_t used = 0;
+    while (!candidates.empty())
+    {
+        const Candidate top = candidates.top();
+        candidates.pop();
+        const Node& node = trees[top.tree]->mNodes[top.node];
+        if (used + node.count > pointBudget) break;
+        used += node.count;
+        oSelection.push_back({ top.tree, top.node });
+
+        for (int childIndex : node.children)
+        {
+            if (childIndex < 0) continue;
+            const Node& child = trees[top.tree]->mNodes[childIndex];
+            // Refine while this node's points are further apart than minPixels where the child is
+            if (!visible(child.bounds) || projected(child.bounds, node.spacing) < minPixels) continue;
+            candidates.push({ projected(child.bounds, child.bounds.size().length()), top.tree, childIndex });
+        }
+    }
+}
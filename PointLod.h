@@ -0,0 +1,72 @@
+#ifndef POINTLOD_H
+#define POINTLOD_H
+
+#include <QMatrix4x4>
+#include <array>
+#include <vector>
+#include "AABB.h"
+#include "Vertex.h"
+
+// Level of detail octree for drawing raw points
+// Every node keeps a spread out subsample of the points inside it and hands the rest down to its children,
+// so drawing a node and all its ancestors gives the full density of that region (each point is stored exactly once)
+// The points of a node are contiguous in points(), so a node can be uploaded as one vertex buffer
+// Points are kept quantized to 16 bits per axis inside the bounds given to the constructor, 12 bytes instead of a 32 byte Vertex,
+// and go to the GPU as they are, pointMatrix() turns them back into tree coordinates in the vertex shader
+class PointLod
+{
+public:
+    // Matches the point pipeline's vertex layout: R16G16B16A16_UNORM position (w unused) and R8G8B8A8_UNORM color
+    struct Point
+    {
+        quint16 x, y, z, w;
+        quint8 r, g, b, a;
+    };
+
+    struct Node
+    {
+        AABB bounds;                    // Cube, children split it in eight
+        quint32 first{0};               // Range in points()
+        quint32 count{0};
+        float spacing{0.0f};            // Roughly the distance between the points of this node
+        std::array<int, 8> children;    // -1 when empty
+
+        Node() { children.fill(-1); }
+        bool isLeaf() const;
+    };
+
+    // A node picked for drawing, tree is the index into the list given to select()
+    struct Selection
+    {
+        int tree;
+        int node;
+    };
+
+    PointLod() = default;
+    // Reorders points, nodeCapacity is roughly how many points end up in each node
+    PointLod(std::vector<Vertex>&& points, const AABB& bounds, int nodeCapacity = 8192);
+
+    const std::vector<Node>& nodes() const { return mNodes; }
+    const std::vector<Point>& points() const { return mPoints; }
+    const Point* nodePoints(int node) const { return mPoints.data() + mNodes[node].first; }
+    // Maps the 0 to 1 positions the GPU reads from points() to tree coordinates, goes on the right of the model matrix
+    QMatrix4x4 pointMatrix() const;
+    // Back to tree coordinates on the CPU, a step of the quantization grid is bounds size / 65535 (1.5 mm for a 100 m tile)
+    QVector3D position(const Point& point) const;
+
+    // Picks the nodes to draw from several trees sharing one coordinate system, largest on screen first, until pointBudget is used up
+    // viewProjection maps tree coordinates to clip space and is used for frustum culling, eye is in tree coordinates
+    // A node is only refined while its point spacing covers at least minPixels on screen, so distant regions stay coarse
+    static void select(const std::vector<const PointLod*>& trees, const QMatrix4x4& viewProjection, const QVector3D& eye,
+                       float focalPixels, size_t pointBudget, float minPixels, std::vector<Selection>& oSelection);
+
+private:
+    std::vector<Node> mNodes;
+    std::vector<Point> mPoints;
+    QVector3D mOrigin;      // Quantization grid, the bounds given to the constructor
+    QVector3D mExtent;
+};
+
+static_assert(sizeof(PointLod::Point) == 12, "PointLod::Point has to match the point pipeline's vertex stride");
+
+#endif // POINTLOD_H
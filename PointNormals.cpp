@@ -0,0 +1,161 @@
+#include "PointNormals.h"
+#include "KdTree.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+
+constexpr double TwoThirdsPi = 2.0943951023931957;
+
+// Covariance of the neighbours as xx, yy, zz, xy, yz, xz
+// Offsets are taken from origin (the query point) rather than from 0, so UTM sized coordinates don't cancel out in the subtraction
+void Covariance(const std::vector<Vertex>& points, const int* neighbours, int count, const QVector3D& origin, float oCovariance[6])
+{
+    const float inverseCount = 1.0f / count;
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    // One point per register with lanes x, y, z, 0
+    // The squares come from d * d and the cross terms from d times itself rotated by one lane, so both need one multiply per point
+    const __m128 o = _mm_set_ps(0.0f, origin.z(), origin.y(), origin.x());
+    __m128 sum = _mm_setzero_ps();
+    __m128 squares = _mm_setzero_ps();
+    __m128 cross = _mm_setzero_ps();
+    for (int i = 0; i < count; ++i)
+    {
+        // Not a 16 byte load from &x, that would also read r, which Estimate() writes from other threads
+        const Vertex& v = points[neighbours[i]];
+        const __m128 d = _mm_sub_ps(_mm_set_ps(0.0f, v.z, v.y, v.x), o);
+        const __m128 rotated = _mm_shuffle_ps(d, d, _MM_SHUFFLE(3, 0, 2, 1)); // y, z, x
+        sum = _mm_add_ps(sum, d);
+        squares = _mm_add_ps(squares, _mm_mul_ps(d, d));
+        cross = _mm_add_ps(cross, _mm_mul_ps(d, rotated));
+    }
+
+    // E[dd] - E[d]E[d] for both halves, the mean is rotated the same way as the points were
+    const __m128 n = _mm_set1_ps(inverseCount);
+    const __m128 mean = _mm_mul_ps(sum, n);
+    const __m128 meanRotated = _mm_shuffle_ps(mean, mean, _MM_SHUFFLE(3, 0, 2, 1));
+    alignas(16) float diagonal[4], offDiagonal[4];
+    _mm_store_ps(diagonal, _mm_sub_ps(_mm_mul_ps(squares, n), _mm_mul_ps(mean, mean)));
+    _mm_store_ps(offDiagonal, _mm_sub_ps(_mm_mul_ps(cross, n), _mm_mul_ps(mean, meanRotated)));
+
+    oCovariance[0] = diagonal[0];
+    oCovariance[1] = diagonal[1];
+    oCovariance[2] = diagonal[2];
+    oCovariance[3] = offDiagonal[0];   // xy
+    oCovariance[4] = offDiagonal[1];   // yz
+    oCovariance[5] = offDiagonal[2];   // zx
+#else
+    float s[3] = {}, c[6] = {};
+    for (int i = 0; i < count; ++i)
+    {
+        const Vertex& v = points[neighbours[i]];
+        const float dx = v.x - origin.x(), dy = v.y - origin.y(), dz = v.z - origin.z();
+        s[0] += dx; s[1] += dy; s[2] += dz;
+        c[0] += dx * dx; c[1] += dy * dy; c[2] += dz * dz;
+        c[3] += dx * dy; c[4] += dy * dz; c[5] += dz * dx;
+    }
+    const float mx = s[0] * inverseCount, my = s[1] * inverseCount, mz = s[2] * inverseCount;
+    oCovariance[0] = c[0] * inverseCount - mx * mx;
+    oCovariance[1] = c[1] * inverseCount - my * my;
+    oCovariance[2] = c[2] * inverseCount - mz * mz;
+    oCovariance[3] = c[3] * inverseCount - mx * my;
+    oCovariance[4] = c[4] * inverseCount - my * mz;
+    oCovariance[5] = c[5] * inverseCount - mz * mx;
+#endif
+}
+
+}
+
+QVector3D PointNormals::SmallestEigenvector(float xx, float yy, float zz, float xy, float yz, float xz)
+{
+    // Scaled so the largest entry is 1, the closed form squares and cubes the entries and would lose small scans to float underflow otherwise
+    const double scale = std::max({ std::abs(xx), std::abs(yy), std::abs(zz), std::abs(xy), std::abs(yz), std::abs(xz) });
+    if (scale <= 0.0) return QVector3D();
+    const double a00 = xx / scale, a11 = yy / scale, a22 = zz / scale;
+    const double a01 = xy / scale, a12 = yz / scale, a02 = xz / scale;
+
+    // Eigenvalues of a symmetric 3x3 matrix from the trigonometric solution of its characteristic cubic
+    const double offDiagonal = a01 * a01 + a02 * a02 + a12 * a12;
+    const double q = (a00 + a11 + a22) / 3.0;
+    const double b00 = a00 - q, b11 = a11 - q, b22 = a22 - q;
+    const double p2 = b00 * b00 + b11 * b11 + b22 * b22 + 2.0 * offDiagonal;
+    if (p2 <= 1e-24) return QVector3D(); // A multiple of the identity, every direction is an eigenvector
+    const double p = std::sqrt(p2 / 6.0);
+
+    const double determinant = b00 * (b11 * b22 - a12 * a12) - a01 * (a01 * b22 - a12 * a02) + a02 * (a01 * a12 - b11 * a02);
+    const double r = std::clamp(determinant / (2.0 * p * p * p), -1.0, 1.0);
+    const double phi = std::acos(r) / 3.0;
+    const double smallest = q + 2.0 * p * std::cos(phi + TwoThirdsPi);
+
+    // The eigenvector is orthogonal to every row of A - smallest * I, so it is the cross product of two of them
+    // Take the longest of the three products, the rows can be close to parallel when two eigenvalues are close
+    const double rows[3][3] = {
+        { a00 - smallest, a01, a02 },
+        { a01, a11 - smallest, a12 },
+        { a02, a12, a22 - smallest }
+    };
+    double best[3] = {}, bestLength = 0.0;
+    for (int i = 0; i < 3; ++i)
+    {
+        const double* u = rows[i];
+        const double* v = rows[(i + 1) % 3];
+        const double c[3] = { u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2], u[0] * v[1] - u[1] * v[0] };
+        const double length = c[0] * c[0] + c[1] * c[1] + c[2] * c[2];
+        if (length > bestLength) {
+            bestLength = length;
+            std::copy(c, c + 3, best);
+        }
+    }
+    // All rows parallel means the smallest eigenvalue is a double one (points on a line), the normal could be anything around it
+    // The matrix is scaled to 1 and acos loses about half the digits near the ends of its range, hence the loose limit
+    if (bestLength <= 1e-12) return QVector3D();
+
+    const double inverseLength = 1.0 / std::sqrt(bestLength);
+    return QVector3D(best[0] * inverseLength, best[1] * inverseLength, best[2] * inverseLength);
+}
+
+void PointNormals::Estimate(std::vector<Vertex> &ioPoints, int neighbours, const QVector3D &up)
+{
+    const KdTree tree(ioPoints);
+    Estimate(ioPoints, tree, neighbours, up);
+}
+
+void PointNormals::Estimate(std::vector<Vertex> &ioPoints, const KdTree &tree, int neighbours, const QVector3D &up)
+{
+    const QVector3D fallback = up.normalized();
+    // Three points is the least that spans a plane, the query point is its own nearest neighbour
+    neighbours = std::max(3, neighbours);
+
+    // Only r, g and b are written, so the positions the tree and the other threads read stay untouched
+    Parallel::ForBlocks(0, ioPoints.size(), [&](size_t begin, size_t end, unsigned)
+    {
+        std::vector<int> nearest;
+        for (size_t i = begin; i < end; ++i)
+        {
+            Vertex& v = ioPoints[i];
+            const QVector3D position = v.pos();
+            tree.nearest(position, neighbours, nearest);
+
+            QVector3D normal;
+            if (nearest.size() >= 3)
+            {
+                float covariance[6];
+                Covariance(ioPoints, nearest.data(), static_cast<int>(nearest.size()), position, covariance);
+                normal = SmallestEigenvector(covariance[0], covariance[1], covariance[2], covariance[3], covariance[4], covariance[5]);
+            }
+            if (normal.isNull()) normal = fallback;
+            else if (QVector3D::dotProduct(normal, up) < 0.0f) normal = -normal;
+
+            v.r = normal.x();
+            v.g = normal.y();
+            v.b = normal.z();
+        }
+    });
+}
@@ -0,0 +1,27 @@
+#ifndef POINTNORMALS_H
+#define POINTNORMALS_H
+
+#include <QVector3D>
+#include <vector>
+#include "Vertex.h"
+class KdTree;
+
+// Normals for raw points without a triangulation, from a principal component analysis of each point's nearest neighbours
+// The neighbourhood is flattest along the eigenvector with the smallest eigenvalue of its covariance, and that is the normal
+namespace PointNormals
+{
+
+// Writes a unit normal into Vertex::r, g and b of every point, the same place PointCloud puts its accumulated face normals
+// PCA can't tell the two sides of a surface apart, so every normal is flipped to the side up points to
+// Points whose neighbours don't span a plane (a single scan line, duplicates) get up as their normal
+void Estimate(std::vector<Vertex>& ioPoints, int neighbours = 16, const QVector3D& up = QVector3D(0.0f, 1.0f, 0.0f));
+// Same, with a tree that was already built over ioPoints
+void Estimate(std::vector<Vertex>& ioPoints, const KdTree& tree, int neighbours = 16, const QVector3D& up = QVector3D(0.0f, 1.0f, 0.0f));
+
+// Unit eigenvector for the smallest eigenvalue of the symmetric matrix [xx xy xz; xy yy yz; xz yz zz]
+// Returns a zero vector when that eigenvalue isn't unique, the matrix is solved in closed form so there is no iteration count to tune
+QVector3D SmallestEigenvector(float xx, float yy, float zz, float xy, float yz, float xz);
+
+}
+
+#endif // POINTNORMALS_H
@@ -0,0 +1,213 @@
+#include "PointTiles.h"
+#include "PointIO.h"
+#include <QDebug>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <map>
+
+namespace
+{
+
+constexpr char Magic[8] = {'V', 'S', 'T', 'I', 'L', 'E', 'S', '0'};
+constexpr quint32 Version = 1;
+
+struct FileHeader
+{
+    char magic[8];
+    quint32 version;
+    quint32 tileCount;
+    double origin[3];
+    float tileSize;
+    quint32 pointSize;      // sizeof the stored point type, catches readers built with a different layout
+};
+
+struct FileTile
+{
+    float min[3];
+    float max[3];
+    quint64 offset;
+    quint32 count;
+    quint32 padding;
+};
+
+using TileKey = std::pair<int, int>;
+
+std::string SpillName(const std::string& tileFile, const TileKey& key)
+{
+    return tileFile + ".spill." + std::to_string(key.first) + "_" + std::to_string(key.second);
+}
+
+// Simple blue - green - brown ramp, low ground is blue and the highest points brown
+QVector3D HeightColor(float t)
+{
+    const QVector3D low(0.1f, 0.3f, 0.8f), middle(0.2f, 0.7f, 0.2f), high(0.6f, 0.4f, 0.2f);
+    t = std::clamp(t, 0.0f, 1.0f);
+    return t < 0.5f ? low + (middle - low) * (t * 2.0f) : middle + (high - middle) * (t * 2.0f - 1.0f);
+}
+
+}
+
+bool PointTiles::Build(const std::vector<std::string> &sourceFiles, const std::string &tileFile, float tileSize)
+{
+    if (sourceFiles.empty() || tileSize <= 0.0f) return false;
+
+    bool haveOrigin{false};
+    std::array<double, 3> setOrigin{};
+    float minHeight = std::numeric_limits<float>::infinity(), maxHeight = -minHeight;
+    std::map<TileKey, quint64> tileCounts;
+
+    // First pass: move every point into the frame of the first file and append it to the spill file of its tile
+    for (const std::string& source : sourceFiles)
+    {
+        std::vector<Vertex> points;
+        AABB bounds;
+        std::array<double, 3> origin;
+        if (!PointIO::ReadPoints(source, points, bounds, &origin)) continue;
+
+        if (!haveOrigin) {
+            setOrigin = origin;
+            haveOrigin = true;
+        }
+        const QVector3D shift(origin[0] - setOrigin[0], origin[1] - setOrigin[1], origin[2] - setOrigin[2]);
+
+        std::map<TileKey, std::vector<Vertex>> binned;
+        for (Vertex v : points)
+        {
+            v.x += shift.x();
+            v.y += shift.y();
+            v.z += shift.z();
+            minHeight = std::min(v.y, minHeight);
+            maxHeight = std::max(v.y, maxHeight);
+            binned[{ static_cast<int>(std::floor(v.x / tileSize)), static_cast<int>(std::floor(v.z / tileSize)) }].push_back(v);
+        }
+
+        for (const auto& [key, tilePoints] : binned)
+        {
+            // A tile seen for the first time truncates its spill file, in case an earlier run was interrupted
+            const std::ios::openmode mode = tileCounts.count(key) ? std::ios::app : std::ios::trunc;
+            std::ofstream spill(SpillName(tileFile, key), std::ios::binary | mode);
+            spill.write(reinterpret_cast<const char*>(tilePoints.data()), tilePoints.size() * sizeof(Vertex));
+            tileCounts[key] += tilePoints.size();
+        }
+        qDebug() << "Tiled " << source.c_str() << " into " << binned.size() << " tiles.";
+    }
+
+    if (tileCounts.empty()) return false;
+
+    std::ofstream out(tileFile, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        qDebug() << "ERROR: Could not open file for writing: " << tileFile.c_str();
+        return false;
+    }
+
+    FileHeader header{};
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = Version;
+    header.tileCount = static_cast<quint32>(tileCounts.size());
+    std::copy(setOrigin.begin(), setOrigin.end(), header.origin);
+    header.tileSize = tileSize;
+    header.pointSize = sizeof(Vertex);
+
+    // Second pass: the table is written once up front to reserve its space, then again once the offsets are known
+    std::vector<FileTile> table(tileCounts.size());
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(FileTile));
+
+    size_t tileIndex = 0;
+    for (const auto& [key, count] : tileCounts)
+    {
+        const std::string spillName = SpillName(tileFile, key);
+        std::vector<Vertex> points(count);
+        {
+            std::ifstream spill(spillName, std::ios::binary);
+            spill.read(reinterpret_cast<char*>(points.data()), count * sizeof(Vertex));
+        }
+        std::remove(spillName.c_str());
+
+        FileTile& entry = table[tileIndex++];
+        QVector3D min = points.front().pos(), max = min;
+        for (Vertex& v : points)
+        {
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                min[axis] = std::min(v.pos()[axis], min[axis]);
+                max[axis] = std::max(v.pos()[axis], max[axis]);
+            }
+            const QVector3D color = HeightColor((v.y - minHeight) / std::max(maxHeight - minHeight, 1e-6f));
+            v.r = color.x();
+            v.g = color.y();
+            v.b = color.z();
+        }
+
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            entry.min[axis] = min[axis];
+            entry.max[axis] = max[axis];
+        }
+        entry.offset = static_cast<quint64>(out.tellp());
+        entry.count = static_cast<quint32>(count);
+        out.write(reinterpret_cast<const char*>(points.data()), points.size() * sizeof(Vertex));
+    }
+
+    out.seekp(sizeof(header));
+    out.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(FileTile));
+    if (!out) {
+        qDebug() << "ERROR: Failed while writing tile set: " << tileFile.c_str();
+        return false;
+    }
+
+    qDebug() << "Wrote " << table.size() << " tiles to " << tileFile.c_str();
+    return true;
+}
+
+bool PointTiles::ReadIndex(const std::string &tileFile, TileSet &oTileSet)
+{
+    std::ifstream in(tileFile, std::ios::binary);
+    if (!in) {
+        qDebug() << "ERROR: Could not open file for reading: " << tileFile.c_str();
+        return false;
+    }
+
+    FileHeader header;
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!in || std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 || header.version != Version || header.pointSize != sizeof(Vertex)) {
+        qDebug() << "ERROR: Not a supported tile set: " << tileFile.c_str();
+        return false;
+    }
+
+    std::vector<FileTile> table(header.tileCount);
+    in.read(reinterpret_cast<char*>(table.data()), table.size() * sizeof(FileTile));
+    if (!in) return false;
+
+    oTileSet.tileSize = header.tileSize;
+    std::copy(header.origin, header.origin + 3, oTileSet.origin);
+    oTileSet.tiles.resize(table.size());
+
+    QVector3D setMin(std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity());
+    QVector3D setMax = -setMin;
+    for (size_t i = 0; i < table.size(); ++i)
+    {
+        const QVector3D min(table[i].min[0], table[i].min[1], table[i].min[2]);
+        const QVector3D max(table[i].max[0], table[i].max[1], table[i].max[2]);
+        oTileSet.tiles[i] = { AABB(min, max), table[i].offset, table[i].count };
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            setMin[axis] = std::min(min[axis], setMin[axis]);
+            setMax[axis] = std::max(max[axis], setMax[axis]);
+        }
+    }
+    oTileSet.bounds = AABB(setMin, setMax);
+    return true;
+}
+
+bool PointTiles::ReadTile(std::ifstream &file, const Tile &tile, std::vector<Vertex> &oVertices)
+{
+    oVertices.resize(tile.count);
+    file.clear();
+    file.seekg(static_cast<std::streamoff>(tile.offset));
+    file.read(reinterpret_cast<char*>(oVertices.data()), tile.count * sizeof(Vertex));
+    return static_cast<bool>(file);
+}
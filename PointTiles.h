@@ -0,0 +1,41 @@
+#ifndef POINTTILES_H
+#define POINTTILES_H
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include "AABB.h"
+#include "Vertex.h"
+
+// On-disk layout for point clouds that are too large to load at once
+// A tile set is one file: a header, a table with the bounds and location of every tile, then the points of each tile back to back
+namespace PointTiles
+{
+
+struct Tile
+{
+    AABB bounds;
+    quint64 offset{0};      // Byte offset of the first point in the tile set file
+    quint32 count{0};
+};
+
+struct TileSet
+{
+    float tileSize{0.0f};
+    double origin[3]{0.0, 0.0, 0.0};    // Every point is stored relative to this, in Vertex axis order
+    AABB bounds;                        // Union of all tile bounds, relative to origin
+    std::vector<Tile> tiles;
+};
+
+// Offline step: bins the points of every source file into square tiles in the XZ plane and writes a tile set
+// Sources are loaded one at a time and spilled to disk per tile, so only the largest source and the largest tile have to fit in memory
+// Points are coloured by height, since the tiles are drawn as plain points without normals
+bool Build(const std::vector<std::string>& sourceFiles, const std::string& tileFile, float tileSize = 100.0f);
+
+bool ReadIndex(const std::string& tileFile, TileSet& oTileSet);
+// Reads the points of one tile from an already open tile set file, safe to call from any thread as long as each thread has its own stream
+bool ReadTile(std::ifstream& file, const Tile& tile, std::vector<Vertex>& oVertices);
+
+}
+
+#endif // POINTTILES_H
@@ -0,0 +1,174 @@
+#include "Predicates.h"
+#include <cmath>
+
+namespace
+{
+
+// Half a unit in the last place of a double, the rounding error of one operation is at most this times the result
+constexpr double Epsilon = 1.1102230246251565e-16;
+constexpr double OrientBound = (3.0 + 16.0 * Epsilon) * Epsilon;
+constexpr double InCircleBound = (10.0 + 96.0 * Epsilon) * Epsilon;
+
+// An exact value stored as the unevaluated sum of its terms, nonoverlapping and in increasing magnitude (Shewchuk's expansions)
+// The capacity is fixed so the exact path never allocates, the sign of the sum is the sign of the largest term
+template <int N>
+struct Expansion
+{
+    double term[N];
+    int size{0};
+    double sign() const { return term[size - 1]; }
+};
+
+// x + y == a + b exactly, with x the rounded sum
+void TwoSum(double a, double b, double& x, double& y)
+{
+    x = a + b;
+    const double bVirtual = x - a, aVirtual = x - bVirtual;
+    y = (a - aVirtual) + (b - bVirtual);
+}
+
+// Same, for |a| >= |b|
+void FastTwoSum(double a, double b, double& x, double& y)
+{
+    x = a + b;
+    y = b - (x - a);
+}
+
+// x + y == a * b exactly, the fused multiply-add gives the rounding error of the product
+void TwoProduct(double a, double b, double& x, double& y)
+{
+    x = a * b;
+    y = std::fma(a, b, -x);
+}
+
+Expansion<2> Difference(double a, double b)
+{
+    Expansion<2> result;
+    double x, y;
+    TwoSum(a, -b, x, y);
+    if (y != 0.0) result.term[result.size++] = y;
+    result.term[result.size++] = x;
+    return result;
+}
+
+// Merges two expansions into one that sums to e + f, dropping zero terms (fast_expansion_sum_zeroelim)
+int Sum(const double* e, int eSize, const double* f, int fSize, double* out)
+{
+    int ei = 0, fi = 0, size = 0;
+    // Takes whichever term of e and f is smaller in magnitude next
+    auto next = [&]() { return (fi == fSize || (ei < eSize && (f[fi] > e[ei]) == (f[fi] > -e[ei]))) ? e[ei++] : f[fi++]; };
+
+    double q = next(), sum, error;
+    if (ei < eSize && fi < fSize)
+    {
+        FastTwoSum(next(), q, sum, error);
+        q = sum;
+        if (error != 0.0) out[size++] = error;
+    }
+    while (ei < eSize || fi < fSize)
+    {
+        TwoSum(q, next(), sum, error);
+        q = sum;
+        if (error != 0.0) out[size++] = error;
+    }
+    if (q != 0.0 || size == 0) out[size++] = q;
+    return size;
+}
+
+// e times b, dropping zero terms (scale_expansion_zeroelim)
+int Scale(const double* e, int eSize, double b, double* out)
+{
+    int size = 0;
+    double q, error;
+    TwoProduct(e[0], b, q, error);
+    if (error != 0.0) out[size++] = error;
+    for (int i = 1; i < eSize; ++i)
+    {
+        double high, low, sum;
+        TwoProduct(e[i], b, high, low);
+        TwoSum(q, low, sum, error);
+        if (error != 0.0) out[size++] = error;
+        FastTwoSum(high, sum, q, error);
+        if (error != 0.0) out[size++] = error;
+    }
+    if (q != 0.0 || size == 0) out[size++] = q;
+    return size;
+}
+
+template <int M, int N>
+Expansion<M + N> operator+(const Expansion<M>& e, const Expansion<N>& f)
+{
+    Expansion<M + N> result;
+    result.size = Sum(e.term, e.size, f.term, f.size, result.term);
+    return result;
+}
+
+template <int N>
+Expansion<N> operator-(Expansion<N> e)
+{
+    for (int i = 0; i < e.size; ++i) e.term[i] = -e.term[i];
+    return e;
+}
+
+// e times every term of f, summed up
+template <int M, int N>
+Expansion<2 * M * N> operator*(const Expansion<M>& e, const Expansion<N>& f)
+{
+    Expansion<2 * M * N> result, sum;
+    double scaled[2 * M];
+    result.size = Scale(e.term, e.size, f.term[0], result.term);
+    for (int i = 1; i < f.size; ++i)
+    {
+        const int scaledSize = Scale(e.term, e.size, f.term[i], scaled);
+        sum.size = Sum(result.term, result.size, scaled, scaledSize, sum.term);
+        result = sum;
+    }
+    return result;
+}
+
+double Orient2dExact(const QVector2D& a, const QVector2D& b, const QVector2D& c)
+{
+    const Expansion<2> acx = Difference(a.x(), c.x()), acy = Difference(a.y(), c.y());
+    const Expansion<2> bcx = Difference(b.x(), c.x()), bcy = Difference(b.y(), c.y());
+    return (acx * bcy + -(acy * bcx)).sign();
+}
+
+double InCircleExact(const QVector2D& a, const QVector2D& b, const QVector2D& c, const QVector2D& d)
+{
+    const Expansion<2> adx = Difference(a.x(), d.x()), ady = Difference(a.y(), d.y());
+    const Expansion<2> bdx = Difference(b.x(), d.x()), bdy = Difference(b.y(), d.y());
+    const Expansion<2> cdx = Difference(c.x(), d.x()), cdy = Difference(c.y(), d.y());
+    const Expansion<16> aLift = adx * adx + ady * ady, bLift = bdx * bdx + bdy * bdy, cLift = cdx * cdx + cdy * cdy;
+    const Expansion<16> bc = bdx * cdy + -(bdy * cdx), ca = cdx * ady + -(cdy * adx), ab = adx * bdy + -(ady * bdx);
+    return (aLift * bc + bLift * ca + cLift * ab).sign();
+}
+
+}
+
+double Predicates::Orient2d(const QVector2D &a, const QVector2D &b, const QVector2D &c)
+{
+    const double left = (double(a.x()) - c.x()) * (double(b.y()) - c.y());
+    const double right = (double(a.y()) - c.y()) * (double(b.x()) - c.x());
+    const double determinant = left - right;
+
+    // Opposite signs can't cancel, so the rounded result already has the right sign
+    if ((left > 0.0 && right <= 0.0) || (left < 0.0 && right >= 0.0) || left == 0.0) return determinant;
+    if (std::abs(determinant) >= OrientBound * std::abs(left + right)) return determinant;
+    return Orient2dExact(a, b, c);
+}
+
+double Predicates::InCircle(const QVector2D &a, const QVector2D &b, const QVector2D &c, const QVector2D &d)
+{
+    const double adx = double(a.x()) - d.x(), ady = double(a.y()) - d.y();
+    const double bdx = double(b.x()) - d.x(), bdy = double(b.y()) - d.y();
+    const double cdx = double(c.x()) - d.x(), cdy = double(c.y()) - d.y();
+
+    const double bdxcdy = bdx * cdy, cdxbdy = cdx * bdy, cdxady = cdx * ady, adxcdy = adx * cdy, adxbdy = adx * bdy, bdxady = bdx * ady;
+    const double aLift = adx * adx + ady * ady, bLift = bdx * bdx + bdy * bdy, cLift = cdx * cdx + cdy * cdy;
+    const double determinant = aLift * (bdxcdy - cdxbdy) + bLift * (cdxady - adxcdy) + cLift * (adxbdy - bdxady);
+    const double permanent = (std::abs(bdxcdy) + std::abs(cdxbdy)) * aLift + (std::abs(cdxady) + std::abs(adxcdy)) * bLift
+                           + (std::abs(adxbdy) + std::abs(bdxady)) * cLift;
+
+    if (std::abs(determinant) > InCircleBound * permanent) return determinant;
+    return InCircleExact(a, b, c, d);
+}
@@ -0,0 +1,23 @@
+#ifndef PREDICATES_H
+#define PREDICATES_H
+
+#include <QVector2D>
+
+// Orientation and incircle tests with exact signs, after Shewchuk's adaptive precision predicates
+// The determinant is first evaluated in double with a bound on its rounding error, only when the result is within that bound
+// is it evaluated again with exact expansion arithmetic. That happens for (nearly) collinear and cocircular points, so gridded
+// LiDAR data takes the slow path a lot more than random points, but the answer is never wrong either way
+namespace Predicates
+{
+
+// Positive when a, b, c turn counterclockwise (with y up), negative when clockwise and 0 when they are collinear
+// The magnitude is twice the area of the triangle when the fast path answers it, only the sign is exact
+double Orient2d(const QVector2D& a, const QVector2D& b, const QVector2D& c);
+
+// Positive when d is inside the circle through a, b, c, negative outside and 0 on it, for a, b, c counterclockwise
+// The sign flips when a, b, c are clockwise
+double InCircle(const QVector2D& a, const QVector2D& b, const QVector2D& c, const QVector2D& d);
+
+}
+
+#endif // PREDICATES_H
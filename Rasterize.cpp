@@ -0,0 +1,181 @@
+#include "Rasterize.h"
+#include "Parallel.h"
+#include <QDebug>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+namespace
+{
+
+// Push-pull on a bare array so the coarse levels don't need a HeightGrid each
+void FillLevel(std::vector<float>& ioHeights, int width, int depth)
+{
+    size_t known = 0;
+    for (float h : ioHeights) known += !std::isnan(h);
+    if (known == ioHeights.size() || known == 0) return;
+
+    // Push: every coarse node averages the known nodes of its 2x2 block
+    const int coarseWidth = (width + 1) / 2, coarseDepth = (depth + 1) / 2;
+    std::vector<float> coarse(static_cast<size_t>(coarseWidth) * coarseDepth);
+    Parallel::For(0, coarseDepth, [&](size_t cd)
+    {
+        for (int cw = 0; cw < coarseWidth; ++cw)
+        {
+            float sum = 0.0f;
+            int count = 0;
+            for (int d = 2 * static_cast<int>(cd); d < std::min(depth, 2 * static_cast<int>(cd) + 2); ++d)
+                for (int w = 2 * cw; w < std::min(width, 2 * cw + 2); ++w)
+                {
+                    const float h = ioHeights[static_cast<size_t>(d) * width + w];
+                    if (std::isnan(h)) continue;
+                    sum += h;
+                    ++count;
+                }
+            coarse[cd * coarseWidth + cw] = count ? sum / count : std::numeric_limits<float>::quiet_NaN();
+        }
+    }, 16);
+    FillLevel(coarse, coarseWidth, coarseDepth);
+
+    // Pull: holes take the coarse level bilinearly interpolated at their position, fine node w sits at (w - 0.5) / 2 on the coarse level
+    Parallel::For(0, depth, [&](size_t d)
+    {
+        const float cz = std::clamp((static_cast<float>(d) - 0.5f) * 0.5f, 0.0f, coarseDepth - 1.0f);
+        const int z0 = static_cast<int>(cz), z1 = std::min(z0 + 1, coarseDepth - 1);
+        const float tz = cz - z0;
+        for (int w = 0; w < width; ++w)
+        {
+            float& h = ioHeights[d * width + w];
+            if (!std::isnan(h)) continue;
+            const float cx = std::clamp((w - 0.5f) * 0.5f, 0.0f, coarseWidth - 1.0f);
+            const int x0 = static_cast<int>(cx), x1 = std::min(x0 + 1, coarseWidth - 1);
+            const float tx = cx - x0;
+            const float near = coarse[static_cast<size_t>(z0) * coarseWidth + x0] * (1.0f - tx) + coarse[static_cast<size_t>(z0) * coarseWidth + x1] * tx;
+            const float far = coarse[static_cast<size_t>(z1) * coarseWidth + x0] * (1.0f - tx) + coarse[static_cast<size_t>(z1) * coarseWidth + x1] * tx;
+            h = near * (1.0f - tz) + far * tz;
+        }
+    }, 16);
+}
+
+}
+
+bool Rasterize::Grid(const std::vector<Vertex> &points, HeightGrid &oGrid, const Settings &settings)
+{
+    if (points.empty() || settings.cellSize <= 0.0f) return false;
+
+    float minX = std::numeric_limits<float>::infinity(), minZ = minX;
+    float maxX = -minX, maxZ = -minX;
+    for (const Vertex& v : points)
+    {
+        minX = std::min(v.x, minX);
+        minZ = std::min(v.z, minZ);
+        maxX = std::max(v.x, maxX);
+        maxZ = std::max(v.z, maxZ);
+    }
+    const double width = std::floor((maxX - minX) / settings.cellSize + 0.5) + 1;
+    const double depth = std::floor((maxZ - minZ) / settings.cellSize + 0.5) + 1;
+    if (width * depth >= std::numeric_limits<uint32_t>::max()) {
+        qDebug() << "ERROR: A" << width << "x" << depth << "height grid is too big, use a larger cell size";
+        return false;
+    }
+
+    oGrid.width = static_cast<int>(width);
+    oGrid.depth = static_cast<int>(depth);
+    oGrid.cellSize = settings.cellSize;
+    oGrid.origin = QVector2D(minX, minZ);
+    oGrid.heights.assign(static_cast<size_t>(oGrid.width) * oGrid.depth, std::numeric_limits<float>::quiet_NaN());
+
+    // Counting sort of the points by grid row, every row is then reduced by one thread without sharing any cells
+    // Each block counts its own rows so the scatter needs no atomics
+    const unsigned blocks = Parallel::ThreadCount();
+    const float inverseCell = 1.0f / settings.cellSize;
+    std::vector<uint32_t> nodeOf(points.size());
+    std::vector<std::vector<size_t>> rowCounts(blocks);
+    Parallel::ForBlocks(0, points.size(), [&](size_t begin, size_t end, unsigned block)
+    {
+        std::vector<size_t>& counts = rowCounts[block];
+        counts.assign(oGrid.depth, 0);
+        for (size_t i = begin; i < end; ++i)
+        {
+            const int w = std::min(oGrid.width - 1, static_cast<int>((points[i].x - minX) * inverseCell + 0.5f));
+            const int d = std::min(oGrid.depth - 1, static_cast<int>((points[i].z - minZ) * inverseCell + 0.5f));
+            nodeOf[i] = static_cast<uint32_t>(d) * oGrid.width + w;
+            ++counts[d];
+        }
+    }, blocks);
+
+    // Row d starts at rowStart[d], inside it block b writes from rowCounts[b][d] on (reused as the write position)
+    std::vector<size_t> rowStart(oGrid.depth + 1, 0);
+    for (int d = 0; d < oGrid.depth; ++d)
+    {
+        size_t position = rowStart[d];
+        for (std::vector<size_t>& counts : rowCounts)
+        {
+            if (counts.empty()) continue; // Blocks past the point count never ran
+            const size_t count = counts[d];
+            counts[d] = position;
+            position += count;
+        }
+        rowStart[d + 1] = position;
+    }
+    std::vector<uint32_t> order(points.size());
+    Parallel::ForBlocks(0, points.size(), [&](size_t begin, size_t end, unsigned block)
+    {
+        std::vector<size_t>& next = rowCounts[block];
+        for (size_t i = begin; i < end; ++i) order[next[nodeOf[i] / oGrid.width]++] = static_cast<uint32_t>(i);
+    }, blocks);
+    rowCounts = {};
+
+    Parallel::For(0, oGrid.depth, [&](size_t d)
+    {
+        // Value and weight per node of the row, min and max keep the running extreme in value and only use weight as a seen flag
+        thread_local std::vector<float> value, weight;
+        value.assign(oGrid.width, 0.0f);
+        weight.assign(oGrid.width, 0.0f);
+        const float nodeZ = minZ + d * settings.cellSize;
+
+        for (size_t o = rowStart[d]; o < rowStart[d + 1]; ++o)
+        {
+            const Vertex& v = points[order[o]];
+            const int w = static_cast<int>(nodeOf[order[o]] - d * oGrid.width);
+            switch (settings.reduction)
+            {
+            case Reduction::Min:
+                value[w] = weight[w] > 0.0f ? std::min(value[w], v.y) : v.y;
+                weight[w] = 1.0f;
+                break;
+            case Reduction::Max:
+                value[w] = weight[w] > 0.0f ? std::max(value[w], v.y) : v.y;
+                weight[w] = 1.0f;
+                break;
+            case Reduction::Mean:
+                value[w] += v.y;
+                weight[w] += 1.0f;
+                break;
+            case Reduction::Idw:
+            {
+                const float dx = v.x - (minX + w * settings.cellSize), dz = v.z - nodeZ;
+                // A point right on the node would get an infinite weight, a hundredth of a cell is close enough to count as on it
+                const float distance = std::max(std::sqrt(dx * dx + dz * dz), 0.01f * settings.cellSize);
+                const float pointWeight = std::pow(distance, -settings.idwPower);
+                value[w] += v.y * pointWeight;
+                weight[w] += pointWeight;
+                break;
+            }
+            }
+        }
+
+        float* row = oGrid.heights.data() + d * oGrid.width;
+        const bool weighted = settings.reduction == Reduction::Mean || settings.reduction == Reduction::Idw;
+        for (int w = 0; w < oGrid.width; ++w)
+            if (weight[w] > 0.0f) row[w] = weighted ? value[w] / weight[w] : value[w];
+    }, 8);
+
+    if (settings.fillHoles) FillHoles(oGrid);
+    return true;
+}
+
+void Rasterize::FillHoles(HeightGrid &ioGrid)
+{
+    FillLevel(ioGrid.heights, ioGrid.width, ioGrid.depth);
+}
@@ -0,0 +1,51 @@
+#ifndef RASTERIZE_H
+#define RASTERIZE_H
+
+#include <QVector2D>
+#include <vector>
+#include "Vertex.h"
+
+// Regular grid of heights over the XZ plane, node (w, d) sits at origin + (w, d) * cellSize
+// A linear time alternative to triangulating the points when a regular terrain is all that is needed
+struct HeightGrid
+{
+    int width{0};               // Nodes along x
+    int depth{0};               // Nodes along z
+    float cellSize{1.0f};
+    QVector2D origin;           // x and z of node (0, 0)
+    std::vector<float> heights; // width * depth, one row of width nodes per d, NaN where no point landed and holes weren't filled
+
+    float height(int w, int d) const { return heights[static_cast<size_t>(d) * width + w]; }
+};
+
+// Bins points into a HeightGrid
+namespace Rasterize
+{
+
+enum class Reduction
+{
+    Min,        // Lowest point in the cell, closest to the ground under vegetation
+    Max,        // Highest point, a surface model
+    Mean,
+    Idw         // Inverse distance weighted towards the node, smoother than the mean when cells hold few points
+};
+
+struct Settings
+{
+    float cellSize{1.0f};           // Node spacing, in the units of the points
+    Reduction reduction{Reduction::Mean};
+    float idwPower{2.0f};           // Weight is 1 / distance^idwPower
+    bool fillHoles{true};           // Cells without points get heights interpolated from their surroundings
+};
+
+// One pass over the points in parallel, every point goes to its nearest node
+// Returns false when there are no points or the grid would be too big to index
+bool Grid(const std::vector<Vertex>& points, HeightGrid& oGrid, const Settings& settings = Settings());
+
+// Fills the NaN heights with a push-pull pyramid, coarser levels average what is known and holes take the interpolated coarse value
+// Linear in the number of nodes, however big the holes are
+void FillHoles(HeightGrid& ioGrid);
+
+}
+
+#endif // RASTERIZE_H
@@ -9,8 +9,13 @@
 #include "Triangle.h"
 #include "stb_image.h"
 #include "AABB.h"
+#include "Bvh.h"
 #include "WorldAxis.h"
 #include "Light.h"
+#include "TileStreamer.h"
+#include <cstddef>
+#include <numeric>
+#include <unordered_set>
 
 /*** Renderer class ***/
 Renderer::Renderer(QVulkanWindow *w, bool msaa) : mWindow(w)
@@ -32,26 +37,62 @@ Renderer::Renderer(QVulkanWindow *w, bool msaa) : mWindow(w)
     QVector3D boundsMin{ -5.0, -4.0, -5.0};
     QVector3D boundsMax{ 5.0, 2.0, 5.0};
 
-    mPhysicsSystem.mSphereModel = new ObjMesh(assetPath + "sphere.obj");
-    mPhysicsSystem.mSphereModel->setPosition({0.0, -10.0, 0.0});
-    mPhysicsSystem.mSphereModel->setColor({1.0, 1.0, 1.0});
-    mObjects.push_back(mPhysicsSystem.mSphereModel);
-
     //Since the light is a special object we have only one of
     mLight = new Light();
     mLight->setPosition(QVector3D(2.5, 8.0, 2.5));
     mLight->setColor({0.88, 0.7, 0.9});
 
-    mTreeRoot = new Octree(mPhysicsSystem.mTriangles, AABB(boundsMin, boundsMax), 0);
+    mTreeRoot = new Octree(mPhysicsSystem.mTriangles, AABB(boundsMin, boundsMax));
     mPhysicsSystem.mWorldSpace = mTreeRoot;
+    mPhysicsSystem.mBvh = std::make_unique<Bvh>(mPhysicsSystem.mTriangles);
 
     mPhysicsSystem.mSpheres.push_back(Sphere(QVector3D(2.5, 8.0, 2.5), QVector3D(0,0,0)));
 
     mObjects.push_back(mLight);
-    mObjects.push_back(new PointCloud(assetPath + "lasdata.txt", boundsMin, boundsMax, mPhysicsSystem.mTriangles));
     mObjects.push_back(new WorldAxis());
 
-    mObjects.at(2)->setColor({0.7, 0.7, 0.7});
+    //The file based assets load at the same time on the AssetLoader pool and show up as they finish
+    loadObject([]() -> VisualObject*
+    {
+        ObjMesh* sphereModel = new ObjMesh(assetPath + "sphere.obj");
+        sphereModel->setPosition({0.0, -10.0, 0.0});
+        sphereModel->setColor({1.0, 1.0, 1.0});
+        return sphereModel;
+    }, [this](VisualObject* sphereModel) { mPhysicsSystem.mSphereModel = sphereModel; });
+
+    //The collision triangles are collected on the side and handed to the physics on the render thread, where it runs
+    auto terrainTriangles = std::make_shared<std::vector<Triangle>>();
+    loadObject([=]() -> VisualObject*
+    {
+        PointCloud* terrain = new PointCloud(assetPath + "lasdata.txt", boundsMin, boundsMax, *terrainTriangles);
+        terrain->setColor({0.7, 0.7, 0.7});
+        return terrain;
+    }, [this, terrainTriangles](VisualObject* terrain)
+    {
+        std::vector<int>& collision = mCollisionTriangles[terrain];
+        collision.resize(terrainTriangles->size());
+        std::iota(collision.begin(), collision.end(), static_cast<int>(mPhysicsSystem.mTriangles.size()));
+        mPhysicsSystem.mTriangles.insert(mPhysicsSystem.mTriangles.end(), terrainTriangles->begin(), terrainTriangles->end());
+        mPhysicsSystem.rebuildIndex();
+    });
+
+    // Large point clouds are split into tiles offline (File > Build point tiles...) and streamed in around the camera
+    const std::string tileFile = assetPath + "terrain.tiles";
+    if (QFile::exists(QString::fromStdString(tileFile)))
+    {
+        mTileStreamer = std::make_unique<TileStreamer>();
+        if (mTileStreamer->open(tileFile))
+        {
+            // One world unit is 10 metres, with the middle of the tile set at the world origin
+            mTileMatrix.setToIdentity();
+            mTileMatrix.scale(0.1f);
+            mTileMatrix.translate(-mTileStreamer->tileSet().bounds.center());
+        }
+        else
+        {
+            mTileStreamer.reset();
+        }
+    }
 
     // **************************************
 	// Optional: Insert all objects into a map
@@ -69,6 +110,9 @@ Renderer::Renderer(QVulkanWindow *w, bool msaa) : mWindow(w)
     mTimer.start();
 }
 
+//Defined here where TileStreamer is complete, so the unique_ptr can destroy it and join the tile worker
+Renderer::~Renderer() = default;
+
 //Automatically called by Qt on Renderer startup
 void Renderer::initResources()
 {
@@ -137,6 +181,29 @@ void Renderer::initResources()
     vertexInputInfo.pVertexBindingDescriptions = &vertexBindingDesc;
     vertexInputInfo.vertexAttributeDescriptionCount = sizeof(vertexAttrDesc) / sizeof(vertexAttrDesc[0]);   // will be 3
     vertexInputInfo.pVertexAttributeDescriptions = vertexAttrDesc;
+
+    //Streamed points use the packed PointLod::Point instead of Vertex, 16 bit positions and 8 bit colors, both normalized to 0-1
+    //The 4 component formats are used since the 3 component ones aren't guaranteed to be supported for vertex buffers
+    VkVertexInputBindingDescription pointBindingDesc{};
+    pointBindingDesc.binding = 0;
+    pointBindingDesc.stride = sizeof(PointLod::Point);
+    pointBindingDesc.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+    VkVertexInputAttributeDescription pointAttrDesc[2];
+    pointAttrDesc[0].location = 0;
+    pointAttrDesc[0].binding = 0;
+    pointAttrDesc[0].format = VK_FORMAT_R16G16B16A16_UNORM;
+    pointAttrDesc[0].offset = offsetof(PointLod::Point, x);
+
+    pointAttrDesc[1].location = 1;
+    pointAttrDesc[1].binding = 0;
+    pointAttrDesc[1].format = VK_FORMAT_R8G8B8A8_UNORM;
+    pointAttrDesc[1].offset = offsetof(PointLod::Point, r);
+
+    VkPipelineVertexInputStateCreateInfo pointInputInfo = vertexInputInfo;
+    pointInputInfo.pVertexBindingDescriptions = &pointBindingDesc;
+    pointInputInfo.vertexAttributeDescriptionCount = sizeof(pointAttrDesc) / sizeof(pointAttrDesc[0]);
+    pointInputInfo.pVertexAttributeDescriptions = pointAttrDesc;
     /*******************************************************/
 
     // Pipeline cache - supposed to increase performance
@@ -301,6 +368,39 @@ void Renderer::initResources()
     if (result != VK_SUCCESS)
         qFatal("Failed to create color graphics pipeline: %d", result);
 
+    //Making a pipeline for drawing points, using color.frag
+
+    mPointMaterial.vertShaderModule = createShader(QStringLiteral(":/point_vert.spv"));
+    VkPipelineShaderStageCreateInfo vertShaderCreateInfoPt = vertShaderCreateInfoC;
+    vertShaderCreateInfoPt.module = mPointMaterial.vertShaderModule;
+    VkPipelineShaderStageCreateInfo shaderStagesPt[] = { vertShaderCreateInfoPt, fragShaderCreateInfoC };
+
+    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_POINT_LIST;      // draw points
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pStages = shaderStagesPt;
+    pipelineInfo.pVertexInputState = &pointInputInfo;
+    result = mDeviceFunctions->vkCreateGraphicsPipelines(logicalDevice, mPipelineCache, 1, &pipelineInfo, nullptr, &mPointMaterial.pipeline);
+    if (result != VK_SUCCESS)
+        qFatal("Failed to create point graphics pipeline: %d", result);
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+
+    // Same shader over the full Vertex layout, for point clouds colored per point (drawType 4)
+    result = mDeviceFunctions->vkCreateGraphicsPipelines(logicalDevice, mPipelineCache, 1, &pipelineInfo, nullptr, &mPointMaterial.vertexPipeline);
+    if (result != VK_SUCCESS)
+        qFatal("Failed to create vertex point graphics pipeline: %d", result);
+
+    //Making a pipeline for drawing shaded points, using phong.frag
+
+    mPointPhongMaterial.vertShaderModule = createShader(QStringLiteral(":/pointphong_vert.spv"));
+    VkPipelineShaderStageCreateInfo vertShaderCreateInfoPP = vertShaderCreateInfoP;
+    vertShaderCreateInfoPP.module = mPointPhongMaterial.vertShaderModule;
+    VkPipelineShaderStageCreateInfo shaderStagesPP[] = { vertShaderCreateInfoPP, fragShaderCreateInfoP };
+
+    pipelineInfo.pStages = shaderStagesPP;
+    result = mDeviceFunctions->vkCreateGraphicsPipelines(logicalDevice, mPipelineCache, 1, &pipelineInfo, nullptr, &mPointPhongMaterial.pipeline);
+    if (result != VK_SUCCESS)
+        qFatal("Failed to create point phong graphics pipeline: %d", result);
+
 	// Destroying the shader modules, we won't need them anymore after the pipeline is created
     if (mPhongMaterial.vertShaderModule)
         mDeviceFunctions->vkDestroyShaderModule(logicalDevice, mPhongMaterial.vertShaderModule, nullptr);
@@ -310,6 +410,10 @@ void Renderer::initResources()
         mDeviceFunctions->vkDestroyShaderModule(logicalDevice, mColorMaterial.vertShaderModule, nullptr);
     if (mColorMaterial.fragShaderModule)
         mDeviceFunctions->vkDestroyShaderModule(logicalDevice, mColorMaterial.fragShaderModule, nullptr);
+    if (mPointMaterial.vertShaderModule)
+        mDeviceFunctions->vkDestroyShaderModule(logicalDevice, mPointMaterial.vertShaderModule, nullptr);
+    if (mPointPhongMaterial.vertShaderModule)
+        mDeviceFunctions->vkDestroyShaderModule(logicalDevice, mPointPhongMaterial.vertShaderModule, nullptr);
 
 	// Create the uniform buffer
 	createUniformBuffer();
@@ -319,7 +423,16 @@ void Renderer::initResources()
     // Create the texture sampler
     createTextureSampler();
 
-    mTextureHandle = createTexture((assetPath + "Hund.bmp")); //Heightmap.jpg HundA.bmp
+    //Decoded on the AssetLoader pool, uploaded on the render thread
+    mAssetLoader.submit([this]()
+    {
+        auto image = std::make_shared<ImageData>(decodeImage(assetPath + "Hund.bmp")); //Heightmap.jpg HundA.bmp
+        mAssetLoader.postToRenderThread([this, image]()
+        {
+            if (mTextureHandle.mImage) destroyTexture(mTextureHandle);
+            mTextureHandle = createTexture(*image);
+        });
+    });
     //getVulkanHWInfo(); // if you want to get info about the Vulkan hardware
     qDebug("InitResouce finished");
 }
@@ -354,6 +467,10 @@ void Renderer::startNextFrame()
     mVulkanWindow->handleInput();
     mCamera.update();               //input can have moved the camera
 
+    mAssetLoader.runRenderThreadTasks();    //upload the assets that finished loading since the last frame
+    destroyRetiredBuffers();
+    updateTiles();                  //page point tiles in and out around the new camera position
+
     VkCommandBuffer commandBuffer = mWindow->currentCommandBuffer();
 
 	setRenderPassParameters(commandBuffer);
@@ -433,9 +550,47 @@ void Renderer::startNextFrame()
             mDeviceFunctions->vkCmdDraw(commandBuffer, (*it)->getVertices().size(), 1, 0, 0);
     }
 
-    // Instanced Sphere rendering
+    // Point clouds shaded with estimated normals, same as the phong pass but without indices
+    mDeviceFunctions->vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mPointPhongMaterial.pipeline);
+    for (std::vector<VisualObject*>::iterator it=mObjects.begin(); it!=mObjects.end(); it++)
+    {
+        if ((*it)->getDrawType() != 3)
+            continue;
+
+        setModelMatrix((*it)->getMatrix(), (*it)->color());
+        mDeviceFunctions->vkCmdBindVertexBuffers(commandBuffer, 0, 1, &(*it)->getVBuffer(), &vbOffset);
+        mDeviceFunctions->vkCmdDraw(commandBuffer, (*it)->vertexCount(), 1, 0, 0);
+    }
+
+    // Point clouds with a color per point, like the change detection distances
+    mDeviceFunctions->vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mPointMaterial.vertexPipeline);
+    for (std::vector<VisualObject*>::iterator it=mObjects.begin(); it!=mObjects.end(); it++)
+    {
+        if ((*it)->getDrawType() != 4)
+            continue;
+
+        setModelMatrix((*it)->getMatrix(), (*it)->color());
+        mDeviceFunctions->vkCmdBindVertexBuffers(commandBuffer, 0, 1, &(*it)->getVBuffer(), &vbOffset);
+        mDeviceFunctions->vkCmdDraw(commandBuffer, (*it)->vertexCount(), 1, 0, 0);
+    }
+
+    // Streamed point tiles, the octree nodes picked in updateTiles() with the model matrix of their tile
+    if (!mGpuNodes.empty())
+    {
+        mDeviceFunctions->vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mPointMaterial.pipeline);
+        for (const auto& [key, gpuNode] : mGpuNodes)
+        {
+            setModelMatrix(gpuNode.matrix, QVector3D(0.0, 0.0, 0.0)); // black object color means use the vertex colors
+            mDeviceFunctions->vkCmdBindVertexBuffers(commandBuffer, 0, 1, &gpuNode.buffer.mBuffer, &vbOffset);
+            mDeviceFunctions->vkCmdDraw(commandBuffer, gpuNode.pointCount, 1, 0, 0);
+        }
+    }
+
+    // Instanced Sphere rendering, once the sphere model has loaded
     for (const Sphere& sphere : mPhysicsSystem.mSpheres)
     {
+        if (!mPhysicsSystem.mSphereModel) break;
+
         QMatrix4x4 sphereMatrix;
         sphereMatrix.translate(sphere.mPosition);
         setModelMatrix(sphereMatrix, QVector3D(0.8, 0.8, 0.8));
@@ -643,6 +798,40 @@ void Renderer::createBuffer(VkDevice logicalDevice, const VkDeviceSize uniformAl
     mDeviceFunctions->vkUnmapMemory(logicalDevice, visualObject->getVBufferMemory());
 }
 
+std::future<VisualObject*> Renderer::loadObject(std::function<VisualObject*()> load, std::function<void(VisualObject*)> onAdded)
+{
+    auto added = std::make_shared<std::promise<VisualObject*>>();
+    std::future<VisualObject*> future = added->get_future();
+
+    mAssetLoader.submit([this, load = std::move(load), onAdded = std::move(onAdded), added]()
+    {
+        VisualObject* visualObject = load();
+
+        //Buffers can only be made on the render thread, between frames
+        mAssetLoader.postToRenderThread([this, visualObject, onAdded, added]()
+        {
+            if (visualObject)
+            {
+                addObject(visualObject);
+                if (onAdded) onAdded(visualObject);
+            }
+            added->set_value(visualObject);
+        });
+    });
+    return future;
+}
+
+void Renderer::addObject(VisualObject* visualObject)
+{
+    const VkDeviceSize uniformAlignment = mWindow->physicalDeviceProperties()->limits.minUniformBufferOffsetAlignment;
+    createVertexBuffer(uniformAlignment, visualObject);
+    if (visualObject->getIndices().size() > 0) //If object has indices
+        createIndexBuffer(uniformAlignment, visualObject);
+
+    mObjects.push_back(visualObject);
+    mMap.insert(std::pair<std::string, VisualObject*>{visualObject->getName(), visualObject});
+}
+
 //Very similar to createBuffer, but here we find and set the memory type explicitly
 //Also the generation of the buffer is in a separate function
 //and copy data to GPU read only memory
@@ -665,8 +854,7 @@ void Renderer::createVertexBuffer(const VkDeviceSize uniformAlignment, VisualObj
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT); // Device local memory (GPU VRam) is faster to access than host visible memory (CPU RAM)
 	
     //Set the buffer and buffer memory in the VisualObject for use in the draw call
-	visualObject->setVBuffer(gpuHandle.mBuffer);
-	visualObject->setVBufferMemory(gpuHandle.mBufferMemory);
+	visualObject->getVBufferHandle() = gpuHandle;
 
     //Copy the data from the staging buffer to the GPU buffer
 	VkCommandBuffer commandBuffer = BeginTransientCommandBuffer();
@@ -700,8 +888,7 @@ void Renderer::createIndexBuffer(const VkDeviceSize uniformAlignment, VisualObje
 		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT); // Device local memory (GPU VRam) is faster to access than host visible memory (CPU RAM)
 
 	//Set the buffer and buffer memory in the VisualObject for use in the draw call
-	visualObject->setIBuffer(gpuHandle.mBuffer);
-	visualObject->setIBufferMemory(gpuHandle.mBufferMemory);
+	visualObject->getIBufferHandle() = gpuHandle;
 
 	//Copy the data from the staging buffer to the GPU buffer:
 	VkCommandBuffer commandBuffer = BeginTransientCommandBuffer();
@@ -751,10 +938,251 @@ BufferHandle Renderer::createGeneralBuffer(const VkDeviceSize size, VkBufferUsag
     }
 
     mDeviceFunctions->vkBindBufferMemory(mWindow->device(), bufferHandle.mBuffer, bufferHandle.mBufferMemory, 0);
+    bufferHandle.mSize = size;
 
     return bufferHandle;
 }
 
+void Renderer::createDeviceLocalBuffers(const std::vector<std::pair<const void*, VkDeviceSize>>& blocks, VkBufferUsageFlags usage, std::vector<BufferHandle>& oBuffers, PendingUpload& oUpload)
+{
+    oBuffers.clear();
+    oUpload = PendingUpload();
+    VkDeviceSize totalSize = 0;
+    for (const auto& block : blocks) totalSize += block.second;
+    if (totalSize == 0) return;
+
+    BufferHandle stagingHandle = createGeneralBuffer(totalSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    char* mapped{ nullptr };
+    mDeviceFunctions->vkMapMemory(mWindow->device(), stagingHandle.mBufferMemory, 0, totalSize, 0, reinterpret_cast<void**>(&mapped));
+    VkDeviceSize offset = 0;
+    for (const auto& [data, size] : blocks) {
+        memcpy(mapped + offset, data, size);
+        offset += size;
+    }
+    mDeviceFunctions->vkUnmapMemory(mWindow->device(), stagingHandle.mBufferMemory);
+
+    //All copies go in one command buffer, so there is only one fence for the whole batch
+    VkCommandBuffer commandBuffer = BeginTransientCommandBuffer();
+    offset = 0;
+    for (const auto& [data, size] : blocks)
+    {
+        BufferHandle gpuHandle = createGeneralBuffer(size, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        VkBufferCopy copyRegion{};
+        copyRegion.srcOffset = offset;
+        copyRegion.size = size;
+        mDeviceFunctions->vkCmdCopyBuffer(commandBuffer, stagingHandle.mBuffer, gpuHandle.mBuffer, 1, &copyRegion);
+        oBuffers.push_back(gpuHandle);
+        offset += size;
+    }
+    mDeviceFunctions->vkEndCommandBuffer(commandBuffer);
+
+    //No wait here, the staging buffer and the command buffer are in use until the fence signals
+    oUpload.fence = SubmitTransientCommandBuffer(commandBuffer);
+    oUpload.commandBuffer = commandBuffer;
+    oUpload.staging = stagingHandle;
+}
+
+void Renderer::finishUpload(PendingUpload& upload)
+{
+    mDeviceFunctions->vkDestroyFence(mWindow->device(), upload.fence, nullptr);
+    mDeviceFunctions->vkFreeCommandBuffers(mWindow->device(), mWindow->graphicsCommandPool(), 1, &upload.commandBuffer);
+    mDeviceFunctions->vkDestroyBuffer(mWindow->device(), upload.staging.mBuffer, nullptr);
+    mDeviceFunctions->vkFreeMemory(mWindow->device(), upload.staging.mBufferMemory, nullptr);
+    upload = PendingUpload();
+}
+
+void Renderer::updateBuffer(BufferHandle &buffer, VkBufferUsageFlags usage, const void *data, VkDeviceSize size, std::vector<VkBufferCopy> &regions)
+{
+    if (size == 0) return;
+
+    //Too small: a new buffer with room to grow, filled completely, the old one goes once no frame uses it any more
+    const VkDeviceSize alignment = mWindow->physicalDeviceProperties()->limits.minUniformBufferOffsetAlignment;
+    if (size > buffer.mSize)
+    {
+        if (buffer.mBuffer != VK_NULL_HANDLE) retireBuffer(buffer);
+        buffer = createGeneralBuffer(aligned(size + size / 2, alignment), usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        regions.assign(1, VkBufferCopy{ 0, 0, size });
+    }
+
+    VkDeviceSize stagingSize = 0;
+    for (VkBufferCopy& region : regions) {
+        region.srcOffset = stagingSize;
+        stagingSize += region.size;
+    }
+    if (stagingSize == 0) return;
+
+    BufferHandle stagingHandle = createGeneralBuffer(stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    char* mapped{ nullptr };
+    mDeviceFunctions->vkMapMemory(mWindow->device(), stagingHandle.mBufferMemory, 0, stagingSize, 0, reinterpret_cast<void**>(&mapped));
+    for (const VkBufferCopy& region : regions)
+        memcpy(mapped + region.srcOffset, static_cast<const char*>(data) + region.dstOffset, region.size);
+    mDeviceFunctions->vkUnmapMemory(mWindow->device(), stagingHandle.mBufferMemory);
+
+    //The frames in flight may still read the buffer, the first barrier holds the copy back until they are done with it
+    //and the second makes the new data visible to the draws after it
+    VkCommandBuffer commandBuffer = BeginTransientCommandBuffer();
+    mDeviceFunctions->vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 0, nullptr);
+    mDeviceFunctions->vkCmdCopyBuffer(commandBuffer, stagingHandle.mBuffer, buffer.mBuffer, static_cast<uint32_t>(regions.size()), regions.data());
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+    mDeviceFunctions->vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    EndTransientCommandBuffer(commandBuffer);
+
+    mDeviceFunctions->vkDestroyBuffer(mWindow->device(), stagingHandle.mBuffer, nullptr);
+    mDeviceFunctions->vkFreeMemory(mWindow->device(), stagingHandle.mBufferMemory, nullptr);
+}
+
+void Renderer::applyEdits(PointCloud *cloud)
+{
+    std::vector<uint32_t> triangles, vertices;
+    cloud->takeEdits(triangles, vertices);
+    if (triangles.empty() && vertices.empty()) return;
+
+    //Runs of neighbouring slots become one copy region each
+    auto toRegions = [](const std::vector<uint32_t>& slots, VkDeviceSize stride)
+    {
+        std::vector<VkBufferCopy> regions;
+        for (size_t i = 0; i < slots.size();)
+        {
+            size_t end = i + 1;
+            while (end < slots.size() && slots[end] == slots[end - 1] + 1) ++end;
+            regions.push_back(VkBufferCopy{ 0, slots[i] * stride, (end - i) * stride });
+            i = end;
+        }
+        return regions;
+    };
+
+    const std::vector<Vertex>& cloudVertices = cloud->vertices();
+    const std::vector<uint32_t>& cloudIndices = cloud->indices();
+    std::vector<VkBufferCopy> regions = toRegions(vertices, sizeof(Vertex));
+    updateBuffer(cloud->getVBufferHandle(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, cloudVertices.data(), cloudVertices.size() * sizeof(Vertex), regions);
+    regions = toRegions(triangles, 3 * sizeof(uint32_t));
+    updateBuffer(cloud->getIBufferHandle(), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, cloudIndices.data(), cloudIndices.size() * sizeof(uint32_t), regions);
+
+    //Each slot of the cloud keeps its collision triangle where it is, so no other index into them moves and the collision
+    //index is patched instead of built again. Slots dropped off the end free theirs, new slots are in triangles in order
+    auto found = mCollisionTriangles.find(cloud);
+    if (found == mCollisionTriangles.end()) return;
+    std::vector<int>& collision = found->second;
+    const size_t newCount = cloudIndices.size() / 3;
+    for (; collision.size() > newCount; collision.pop_back()) mPhysicsSystem.removeTriangle(collision.back());
+    for (uint32_t t : triangles)
+    {
+        const Triangle triangle(cloudVertices[cloudIndices[3 * t]], cloudVertices[cloudIndices[3 * t + 1]], cloudVertices[cloudIndices[3 * t + 2]]);
+        if (t < collision.size()) mPhysicsSystem.changeTriangle(collision[t], triangle);
+        else collision.push_back(mPhysicsSystem.addTriangle(triangle));
+    }
+    mPhysicsSystem.updateIndex();
+}
+
+void Renderer::retireBuffer(BufferHandle handle)
+{
+    //+1 since the frame currently being recorded might also use it
+    mRetiredBuffers.emplace_back(handle, mWindow->concurrentFrameCount() + 1);
+}
+
+void Renderer::destroyRetiredBuffers(bool all)
+{
+    for (auto it = mRetiredBuffers.begin(); it != mRetiredBuffers.end();)
+    {
+        if (!all && --it->second > 0) {
+            ++it;
+            continue;
+        }
+        mDeviceFunctions->vkDestroyBuffer(mWindow->device(), it->first.mBuffer, nullptr);
+        mDeviceFunctions->vkFreeMemory(mWindow->device(), it->first.mBufferMemory, nullptr);
+        it = mRetiredBuffers.erase(it);
+    }
+}
+
+void Renderer::updateTiles()
+{
+    if (!mTileStreamer) return;
+
+    //The streamer and the octrees work in tile set coordinates, so move the camera into that space
+    const QVector3D eye = mTileMatrix.inverted().map(mCamera.position());
+    mTileStreamer->update(eye);
+
+    //Pick the octree nodes to draw over all resident tiles, so the point budget is shared by the whole scene
+    const std::vector<int>& tiles = mTileStreamer->residentTiles();
+    std::vector<const PointLod*> lods;
+    lods.reserve(tiles.size());
+    for (int tile : tiles) lods.push_back(&mTileStreamer->tileLod(tile));
+
+    const QMatrix4x4 projection = mCamera.projectionMatrix();
+    const float focalPixels = projection(1, 1) * mWindow->swapChainImageSize().height() * 0.5f;   //Pixels per unit at distance 1
+    std::vector<PointLod::Selection> selection;
+    PointLod::select(lods, projection * mCamera.viewMatrix() * mTileMatrix, eye, focalPixels, mPointBudget, mLodMinPixels, selection);
+
+    auto nodeKey = [&](const PointLod::Selection& selected) { return (quint64(tiles[selected.tree]) << 32) | quint32(selected.node); };
+
+    //Drop the nodes that weren't selected this frame
+    std::unordered_set<quint64> selectedKeys;
+    for (const PointLod::Selection& selected : selection) selectedKeys.insert(nodeKey(selected));
+
+    //Nodes are only drawn once their copy has finished, the uploads still in flight are left for a later frame
+    std::unordered_set<quint64> pendingKeys;
+    for (auto it = mTileUploads.begin(); it != mTileUploads.end();)
+    {
+        if (mDeviceFunctions->vkGetFenceStatus(mWindow->device(), it->upload.fence) != VK_SUCCESS) {
+            for (const auto& [key, gpuNode] : it->nodes) pendingKeys.insert(key);
+            ++it;
+            continue;
+        }
+        finishUpload(it->upload);
+        for (auto& [key, gpuNode] : it->nodes)
+        {
+            if (selectedKeys.count(key)) mGpuNodes[key] = gpuNode;
+            else retireBuffer(gpuNode.buffer);
+        }
+        it = mTileUploads.erase(it);
+    }
+    for (auto it = mGpuNodes.begin(); it != mGpuNodes.end();)
+    {
+        if (selectedKeys.count(it->first)) {
+            ++it;
+            continue;
+        }
+        retireBuffer(it->second.buffer);
+        it = mGpuNodes.erase(it);
+    }
+
+    //Upload the missing nodes, largest on screen first and only up to the per frame budget, the rest follow in later frames
+    //Once the GPU falls behind by a batch per frame in flight, wait for it rather than queue up more copies
+    if (mTileUploads.size() >= size_t(mWindow->concurrentFrameCount())) return;
+    std::vector<std::pair<const void*, VkDeviceSize>> blocks;
+    struct NewNode { quint64 key; uint32_t count; QMatrix4x4 matrix; };
+    std::vector<NewNode> newNodes;
+    VkDeviceSize uploadBytes = 0;
+    for (const PointLod::Selection& selected : selection)
+    {
+        const quint64 key = nodeKey(selected);
+        if (mGpuNodes.count(key) || pendingKeys.count(key)) continue;
+
+        const PointLod& lod = *lods[selected.tree];
+        const uint32_t count = lod.nodes()[selected.node].count;
+        const VkDeviceSize bytes = count * sizeof(PointLod::Point);
+        if (uploadBytes > 0 && uploadBytes + bytes > mTileUploadBudget) break;
+
+        blocks.emplace_back(lod.nodePoints(selected.node), bytes);
+        newNodes.push_back({ key, count, mTileMatrix * lod.pointMatrix() });
+        uploadBytes += bytes;
+    }
+
+    if (blocks.empty()) return;
+    std::vector<BufferHandle> buffers;
+    TileUpload tileUpload;
+    createDeviceLocalBuffers(blocks, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, buffers, tileUpload.upload);
+    for (size_t i = 0; i < buffers.size(); ++i)
+        tileUpload.nodes.emplace_back(newNodes[i].key, GpuNode{ buffers[i], newNodes[i].count, newNodes[i].matrix });
+    mTileUploads.push_back(std::move(tileUpload));
+}
+
 //Create a descriptor set layout that describes the uniform buffer.
 void Renderer::createDescriptorSetLayouts()
 {
@@ -992,6 +1420,21 @@ void Renderer::releaseResources()
         mPipeline2 = VK_NULL_HANDLE;
     }
 
+    if (mPointMaterial.pipeline) {
+        mDeviceFunctions->vkDestroyPipeline(dev, mPointMaterial.pipeline, nullptr);
+        mPointMaterial.pipeline = VK_NULL_HANDLE;
+    }
+
+    if (mPointMaterial.vertexPipeline) {
+        mDeviceFunctions->vkDestroyPipeline(dev, mPointMaterial.vertexPipeline, nullptr);
+        mPointMaterial.vertexPipeline = VK_NULL_HANDLE;
+    }
+
+    if (mPointPhongMaterial.pipeline) {
+        mDeviceFunctions->vkDestroyPipeline(dev, mPointPhongMaterial.pipeline, nullptr);
+        mPointPhongMaterial.pipeline = VK_NULL_HANDLE;
+    }
+
     if (mPhongMaterial.pipelineLayout) {
         mDeviceFunctions->vkDestroyPipelineLayout(dev, mPhongMaterial.pipelineLayout, nullptr);
         mPhongMaterial.pipelineLayout = VK_NULL_HANDLE;
@@ -1028,8 +1471,23 @@ void Renderer::releaseResources()
         }
     }
 
+    // Free the streamed tiles, they are uploaded again after initResources()
+    for (auto& [key, gpuNode] : mGpuNodes)
+        retireBuffer(gpuNode.buffer);
+    mGpuNodes.clear();
+    for (TileUpload& tileUpload : mTileUploads)
+    {
+        mDeviceFunctions->vkWaitForFences(mWindow->device(), 1, &tileUpload.upload.fence, VK_TRUE, UINT64_MAX);
+        finishUpload(tileUpload.upload);
+        for (auto& [key, gpuNode] : tileUpload.nodes)
+            retireBuffer(gpuNode.buffer);
+    }
+    mTileUploads.clear();
+    destroyRetiredBuffers(true);
+
     // Destroy textures
     destroyTexture(mTextureHandle);
+    mTextureHandle = TextureHandle();
 
 	if (mTextureSampler) {
 		mDeviceFunctions->vkDestroySampler(dev, mTextureSampler, nullptr);
@@ -1100,6 +1558,23 @@ VkCommandBuffer Renderer::BeginTransientCommandBuffer()
 	return commandBuffer;
 }
 
+// Function to submit a short lived command buffer without waiting for it, the fence signals when it is done
+VkFence Renderer::SubmitTransientCommandBuffer(VkCommandBuffer commandBuffer)
+{
+	VkFenceCreateInfo fenceInfo{};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	VkFence fence{ VK_NULL_HANDLE };
+	mDeviceFunctions->vkCreateFence(mWindow->device(), &fenceInfo, nullptr, &fence);
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+
+	mDeviceFunctions->vkQueueSubmit(mGraphicsQueue, 1, &submitInfo, fence);
+	return fence;
+}
+
 // Function to end a short lived command buffer
 void Renderer::EndTransientCommandBuffer(VkCommandBuffer commandBuffer)
 {
@@ -1148,66 +1623,66 @@ void Renderer::createTextureSampler()
 		qFatal("Failed to create texture sampler: %d", err);
 }
 
-TextureHandle Renderer::createTexture(const std::string filename)
+//Reads the image into RGBA pixels. Doesn't touch Vulkan, so it can run on the AssetLoader workers
+Renderer::ImageData Renderer::decodeImage(const std::string& filename)
 {
-    int texWidth, texHeight, texChannels;
-    VkDeviceSize bufferSize{};
-    VkFormat format{ VK_FORMAT_R8G8B8A8_SRGB }; //could be VK_FORMAT_R8G8B8_SRGB
-	BufferHandle stagingBuffer{};
-    stbi_uc* pixelData{ nullptr };
+    ImageData image;
 
 	//Open the file and read the data into the imageFileData vector
     std::ifstream file(filename, std::ios::binary);
-
-	//if the file is not open, we create a tiny default texture
-    if (!file.is_open()) 
-    {
-        //Dummy texture 2x2 pixels, 4 bytes per pixel
-        pixelData = new stbi_uc[16]{};  //stbi_uc == unsigned char
-
-		//Set some colors - alpha to 255
-        pixelData[0] = 255;
-		pixelData[3] = 255; //alpha
-        pixelData[5] = 255;
-        pixelData[7] = 255; //alpha
-        pixelData[10] = 255;
-		pixelData[11] = 255; //alpha
-        pixelData[12] = 255;
-        pixelData[13] = 255;
-		pixelData[15] = 255; //alpha
-
-        bufferSize = 16;  // 2 * 2 * 4 bytes
-        texChannels = 4;
-        texWidth = 2;
-        texHeight = 2;
-        stagingBuffer = createGeneralBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-        void* data{};
-        mDeviceFunctions->vkMapMemory(mWindow->device(), stagingBuffer.mBufferMemory, 0, bufferSize, 0, &data);
-        memcpy(data, pixelData, bufferSize);
-    }
-	//if the file is open, we read the data into the imageFileData vector using stb_image
-    else
+    if (file.is_open())
     {
         const std::uint32_t size = std::filesystem::file_size(filename);
         std::vector<std::uint8_t> imageFileData(size);
         file.read(reinterpret_cast<char*>(imageFileData.data()), size);
 
         //Use the stb_image library to load the image
-		//Force all images to RGBA format
-        pixelData = stbi_load_from_memory(imageFileData.data(), size, &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+		//Force all images to RGBA format, texChannels might be 1, 3 or 4
+        int texChannels{ 0 };
+        stbi_uc* pixelData = stbi_load_from_memory(imageFileData.data(), size, &image.width, &image.height, &texChannels, STBI_rgb_alpha);
+        if (pixelData)
+        {
+            image.pixels.assign(pixelData, pixelData + 4 * image.width * image.height);
+            stbi_image_free(pixelData);
+            return image;
+        }
+    }
 
-		//texChannels might be 1, 3 or 4, so hardcode it to 4
-        bufferSize = 4 * texWidth * texHeight;
-        stagingBuffer = createGeneralBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	//if the file could not be read, we create a tiny default texture
+    //Dummy texture 2x2 pixels, 4 bytes per pixel
+    image.pixels.assign(16, 0);
+    image.pixels[0] = 255;
+    image.pixels[3] = 255; //alpha
+    image.pixels[5] = 255;
+    image.pixels[7] = 255; //alpha
+    image.pixels[10] = 255;
+    image.pixels[11] = 255; //alpha
+    image.pixels[12] = 255;
+    image.pixels[13] = 255;
+    image.pixels[15] = 255; //alpha
+    image.width = 2;
+    image.height = 2;
+    return image;
+}
 
-        void* data{};
-        mDeviceFunctions->vkMapMemory(mWindow->device(), stagingBuffer.mBufferMemory, 0, bufferSize, 0, &data);
-        memcpy(data, pixelData, bufferSize);
-    }
+TextureHandle Renderer::createTexture(const std::string filename)
+{
+    return createTexture(decodeImage(filename));
+}
+
+TextureHandle Renderer::createTexture(const ImageData& image)
+{
+    const int texWidth = image.width;
+    const int texHeight = image.height;
+    const VkDeviceSize bufferSize = image.pixels.size();
+    VkFormat format{ VK_FORMAT_R8G8B8A8_SRGB }; //could be VK_FORMAT_R8G8B8_SRGB
 
+	BufferHandle stagingBuffer = createGeneralBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    void* data{};
+    mDeviceFunctions->vkMapMemory(mWindow->device(), stagingBuffer.mBufferMemory, 0, bufferSize, 0, &data);
+    memcpy(data, image.pixels.data(), bufferSize);
 	mDeviceFunctions->vkUnmapMemory(mWindow->device(), stagingBuffer.mBufferMemory);
                                          
 	TextureHandle textureHandle = createImage(texWidth, texHeight, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
@@ -1248,8 +1723,6 @@ TextureHandle Renderer::createTexture(const std::string filename)
 	
     destroyBuffer(stagingBuffer);
 
-	stbi_image_free(pixelData);
-
 	return textureHandle;
 }
 
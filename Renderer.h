@@ -2,9 +2,11 @@
 #define RENDERER_H
 
 #include <QVulkanWindow>
+#include <memory>
 #include <vector>
 #include <qelapsedtimer.h>
 #include <unordered_map>
+#include "AssetLoader.h"
 #include "Camera.h"
 #include "Octree.h"
 #include "PhysicsSystem.h"
@@ -12,13 +14,16 @@
 #include "TriangleSurface.h"
 #include "VisualObject.h"
 #include "Utilities.h"
+class PointCloud;
 class Sphere;
 class TriangleSurface;
+class TileStreamer;
 
 class Renderer : public QVulkanWindowRenderer
 {
 public:
     Renderer(QVulkanWindow *w, bool msaa = false);
+    ~Renderer();
 
     //Initializes the Vulkan resources needed,
     // the buffers
@@ -45,6 +50,14 @@ public:
     std::vector<VisualObject*>& getObjects() { return mObjects; }
     std::unordered_map<std::string, VisualObject*>& getMap() { return mMap; }
 
+    //Runs load (file reading and processing) on the AssetLoader pool, then uploads the object and adds it to the scene from the render thread
+    //onAdded also runs on the render thread, the future is ready once the object is drawn
+    std::future<VisualObject*> loadObject(std::function<VisualObject*()> load, std::function<void(VisualObject*)> onAdded = nullptr);
+    AssetLoader& assetLoader() { return mAssetLoader; }
+
+    //Uploads what changed in cloud since its last insertPoint()/removePoint() calls and patches its collision triangles, on the render thread
+    void applyEdits(PointCloud* cloud);
+
     Octree* mTreeRoot;
     PhysicsSystem mPhysicsSystem;   // Stores all physics Objects in the scene
 
@@ -119,8 +132,19 @@ private:
 	void createDescriptorPool();
     void destroyBuffer(BufferHandle handle);
 
+    //Uploads the buffers of an object created after initResources() and adds it to mObjects and mMap, render thread only
+    void addObject(VisualObject* visualObject);
+
 	void createTextureSampler();
+    //RGBA pixels, 4 bytes per pixel
+    struct ImageData {
+        std::vector<unsigned char> pixels;
+        int width{ 0 };
+        int height{ 0 };
+    };
+    static ImageData decodeImage(const std::string& filename);
     TextureHandle createTexture(const std::string filename);
+    TextureHandle createTexture(const ImageData& image);
 	TextureHandle createImage(int width, int height, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkFormat format);
 	void transitionImageLayout(VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout);
 	void copyBufferToImage(VkBuffer buffer, VkImage image, int width, int height);
@@ -135,11 +159,49 @@ private:
 	uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags requiredProperties);
 
 	BufferHandle createGeneralBuffer(const VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties);
+    //A batch of copies the GPU might still be running, the staging buffer and the command buffer stay until the fence signals
+    struct PendingUpload {
+        VkFence fence{ VK_NULL_HANDLE };
+        VkCommandBuffer commandBuffer{ VK_NULL_HANDLE };
+        BufferHandle staging{};
+    };
+    //Copies each block of data into a new device local buffer through one staging buffer and one command buffer, like createVertexBuffer but without a VisualObject
+    //Returns without waiting, the buffers can be used once oUpload.fence has signalled, then finishUpload(oUpload)
+    void createDeviceLocalBuffers(const std::vector<std::pair<const void*, VkDeviceSize>>& blocks, VkBufferUsageFlags usage, std::vector<BufferHandle>& oBuffers, PendingUpload& oUpload);
+    void finishUpload(PendingUpload& upload);
+    //Copies the regions (dstOffset and size, in bytes) of data into buffer with one staging buffer and one vkCmdCopyBuffer
+    //size is all of data, when it doesn't fit any more the buffer is replaced by a bigger one and all of it is copied instead
+    void updateBuffer(BufferHandle& buffer, VkBufferUsageFlags usage, const void* data, VkDeviceSize size, std::vector<VkBufferCopy>& regions);
+    //Destroys the buffer once the frames that might still be using it are done, without stalling the GPU like destroyBuffer
+    void retireBuffer(BufferHandle handle);
+    void destroyRetiredBuffers(bool all = false);
+    std::unordered_map<VisualObject*, std::vector<int>> mCollisionTriangles; //Index in mPhysicsSystem.mTriangles of each collision triangle of an object, by its triangle slot
+
+    //Streamed point tiles, see TileStreamer and PointLod
+    void updateTiles();
+    std::unique_ptr<TileStreamer> mTileStreamer;   //Its destructor stops and joins the worker thread
+    QMatrix4x4 mTileMatrix;                     //Tile set coordinates (metres) to world
+    struct GpuNode {
+        BufferHandle buffer;
+        uint32_t pointCount{ 0 };
+        QMatrix4x4 matrix;                      //mTileMatrix times the tile's PointLod::pointMatrix(), the buffer holds quantized points
+    };
+    std::unordered_map<quint64, GpuNode> mGpuNodes;             //Key is tile << 32 | PointLod node
+    struct TileUpload {
+        PendingUpload upload;
+        std::vector<std::pair<quint64, GpuNode>> nodes;         //Go into mGpuNodes when upload.fence signals
+    };
+    std::vector<TileUpload> mTileUploads;                       //At most one per frame in flight
+    std::vector<std::pair<BufferHandle, int>> mRetiredBuffers;  //Buffer and the number of frames left before it can be destroyed
+    VkDeviceSize mTileUploadBudget{ 32 << 20 };                 //Bytes of point data in one batch of copies at most, so a batch is done within a frame or two
+    size_t mPointBudget{ 5000000 };                             //Points drawn per frame at most, over all tiles
+    float mLodMinPixels{ 2.0f };                                //Refine a node while its point spacing is wider than this on screen, matches gl_PointSize in point.vert
 
     Camera mCamera;
     class VulkanWindow* mVulkanWindow{ nullptr };
 
 	VkCommandBuffer BeginTransientCommandBuffer();
+	VkFence SubmitTransientCommandBuffer(VkCommandBuffer commandBuffer);
 	void EndTransientCommandBuffer(VkCommandBuffer commandBuffer);
 
     BufferHandle mUniformBuffer{};
@@ -163,6 +225,19 @@ private:
         VkPipeline pipeline{VK_NULL_HANDLE};
     } mColorMaterial;
 
+    // Point shader - color.frag with a vertex shader that sets the point size
+    struct {
+        VkShaderModule vertShaderModule;
+        VkPipeline pipeline{ VK_NULL_HANDLE };          // PointLod::Point input, for the streamed tiles
+        VkPipeline vertexPipeline{ VK_NULL_HANDLE };    // Vertex input, for drawType 4
+    } mPointMaterial;
+
+    // Shaded point shader - phong.frag with a vertex shader that sets the point size, for point clouds with estimated normals
+    struct {
+        VkShaderModule vertShaderModule;
+        VkPipeline pipeline{ VK_NULL_HANDLE };
+    } mPointPhongMaterial;
+
     // Phong shader
     struct {
         VkDeviceSize vertUniSize;
@@ -176,6 +251,9 @@ private:
         VkPipelineLayout pipelineLayout{VK_NULL_HANDLE};
         VkPipeline pipeline{VK_NULL_HANDLE};
     } mPhongMaterial;
+
+    //Declared last so it is destroyed first, its workers post tasks that use the members above
+    AssetLoader mAssetLoader;
 };
 
 #endif // RENDERER_H
@@ -0,0 +1,235 @@
+#include "Simplification.h"
+#include "Predicates.h"
+#include "Triangulation.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+#include <tuple>
+
+namespace
+{
+
+// Spreads the low 16 bits out to the even bits, for Z-order (Morton) keys
+uint32_t Interleave(uint32_t x)
+{
+    x &= 0xffff;
+    x = (x | (x << 8)) & 0x00ff00ff;
+    x = (x | (x << 4)) & 0x0f0f0f0f;
+    x = (x | (x << 2)) & 0x33333333;
+    x = (x | (x << 1)) & 0x55555555;
+    return x;
+}
+
+// Indices of the convex hull corners (Andrew's monotone chain), points on the hull edges are left for the insertion
+std::vector<uint32_t> ConvexHull(const std::vector<QVector2D>& positions)
+{
+    std::vector<uint32_t> order(positions.size());
+    for (uint32_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+    {
+        return positions[a].x() < positions[b].x() || (positions[a].x() == positions[b].x() && positions[a].y() < positions[b].y());
+    });
+    if (order.size() < 3) return order;
+
+    std::vector<uint32_t> hull(2 * order.size());
+    size_t size = 0;
+    auto add = [&](uint32_t i, size_t floor)
+    {
+        while (size >= floor && Predicates::Orient2d(positions[hull[size - 2]], positions[hull[size - 1]], positions[i]) <= 0.0) --size;
+        hull[size++] = i;
+    };
+    for (uint32_t i : order) add(i, 2);
+    const size_t lower = size + 1;
+    for (size_t i = order.size() - 1; i-- > 0;) add(order[i], lower);
+    hull.resize(size - 1);
+    return hull;
+}
+
+}
+
+float Simplification::GreedyInsertion(const std::vector<Vertex> &points, std::vector<uint32_t> &oKept, std::vector<uint32_t> &oIndices,
+                                      const Settings &settings, std::vector<Level> *oLevels)
+{
+    oKept.clear();
+    oIndices.clear();
+    if (oLevels) oLevels->clear();
+
+    // The points go along a Z-order curve first, so the points of a triangle are close together in memory when its list is walked
+    // Everything below works on the sorted copy, oKept is turned back into input indices at the end
+    QVector2D min(std::numeric_limits<float>::max(), std::numeric_limits<float>::max()), max = -min;
+    for (const Vertex& point : points) {
+        min = QVector2D(std::min(min.x(), point.x), std::min(min.y(), point.z));
+        max = QVector2D(std::max(max.x(), point.x), std::max(max.y(), point.z));
+    }
+    const QVector2D scale(65535.0f / std::max(max.x() - min.x(), 1e-30f), 65535.0f / std::max(max.y() - min.y(), 1e-30f));
+    std::vector<std::pair<uint32_t, uint32_t>> keys(points.size());
+    for (uint32_t i = 0; i < points.size(); ++i)
+    {
+        const QVector2D cell = (points[i].poXZ() - min) * scale;
+        keys[i] = { Interleave(static_cast<uint32_t>(cell.x())) | Interleave(static_cast<uint32_t>(cell.y())) << 1, i };
+    }
+    std::sort(keys.begin(), keys.end());
+    std::vector<QVector2D> positions(points.size());
+    std::vector<float> heights(points.size());
+    for (size_t i = 0; i < points.size(); ++i) {
+        positions[i] = points[keys[i].second].poXZ();
+        heights[i] = points[keys[i].second].y;
+    }
+
+    // Vertex i of the TIN is point oKept[i], it starts out as the convex hull so every point is inside a triangle
+    oKept = ConvexHull(positions);
+    std::vector<QVector2D> hullPositions(oKept.size());
+    for (size_t i = 0; i < oKept.size(); ++i) hullPositions[i] = positions[oKept[i]];
+    Triangulation tin(hullPositions);
+    if (tin.empty())
+    {
+        oKept.clear();
+        return 0.0f;
+    }
+
+    // The points that aren't vertices yet, one linked list per triangle slot
+    std::vector<int> first(tin.triangleCount(), -1), following(points.size(), -1);
+    std::vector<bool> isVertex(points.size(), false);
+    for (uint32_t i : oKept) isVertex[i] = true;
+    for (uint32_t i = 0; i < points.size(); ++i)
+    {
+        if (isVertex[i]) continue;
+        const int t = tin.locate(positions[i]);
+        if (t < 0) continue; // Never with exact predicates, the hull holds every point
+        following[i] = first[t];
+        first[t] = static_cast<int>(i);
+    }
+
+    // The worst point of every triangle goes on a max heap, changed triangles get a new version and their old entries are skipped
+    std::vector<int> candidate(tin.triangleCount(), -1);
+    std::vector<uint32_t> version(tin.triangleCount(), 0);
+    std::priority_queue<std::tuple<float, uint32_t, uint32_t>> heap;
+    auto rescan = [&](uint32_t t)
+    {
+        // The plane through the corners as height = a + b * x + c * z, relative to the first corner
+        const std::vector<uint32_t>& indices = tin.indices();
+        const uint32_t i0 = oKept[indices[3 * t]], i1 = oKept[indices[3 * t + 1]], i2 = oKept[indices[3 * t + 2]];
+        const QVector2D origin = positions[i0];
+        const double x1 = double(positions[i1].x()) - origin.x(), z1 = double(positions[i1].y()) - origin.y(), h1 = double(heights[i1]) - heights[i0];
+        const double x2 = double(positions[i2].x()) - origin.x(), z2 = double(positions[i2].y()) - origin.y(), h2 = double(heights[i2]) - heights[i0];
+        const double determinant = x1 * z2 - x2 * z1;
+        const double b = (h1 * z2 - h2 * z1) / determinant, c = (x1 * h2 - x2 * h1) / determinant;
+
+        float worst = -1.0f;
+        candidate[t] = -1;
+        for (int i = first[t]; i >= 0; i = following[i])
+        {
+            const float e = static_cast<float>(std::abs(heights[i] - heights[i0] - b * (double(positions[i].x()) - origin.x()) - c * (double(positions[i].y()) - origin.y())));
+            if (e > worst) {
+                worst = e;
+                candidate[t] = i;
+            }
+        }
+        ++version[t];
+        if (candidate[t] >= 0) heap.emplace(worst, t, version[t]);
+    };
+    for (uint32_t t = 0; t < tin.triangleCount(); ++t) rescan(t);
+
+    std::vector<float> lodTolerances = settings.lodTolerances;
+    std::sort(lodTolerances.begin(), lodTolerances.end(), std::greater<float>());
+    size_t nextLevel = 0;
+    // Points with the XZ of a vertex but another height can't be fitted by any TIN, they stay off it by as much as when they were dropped
+    float droppedError = 0.0f;
+    auto snapshot = [&](float maxError)
+    {
+        for (; oLevels && nextLevel < lodTolerances.size() && maxError <= lodTolerances[nextLevel]; ++nextLevel)
+            oLevels->push_back(Level{ lodTolerances[nextLevel], std::max(maxError, droppedError), oKept.size(), tin.indices() });
+    };
+
+    std::vector<uint32_t> changed, fan, spokes;
+    std::vector<std::pair<uint32_t, size_t>> moved;     // Point and the fan triangle to try first
+    float maxError = 0.0f;
+    while (!heap.empty())
+    {
+        const auto [worst, t, stamp] = heap.top();
+        if (stamp != version[t]) {
+            heap.pop();
+            continue;
+        }
+        maxError = worst;
+        snapshot(maxError);
+        if (worst <= settings.tolerance || (settings.maxVertices && oKept.size() >= settings.maxVertices)) break;
+        heap.pop();
+
+        const uint32_t point = static_cast<uint32_t>(candidate[t]);
+        const int vertex = tin.insert(positions[point]);
+        if (vertex < 0)
+        {
+            // Same XZ as a vertex but another height, the surface can only go through one of them
+            droppedError = std::max(droppedError, worst);
+            int* link = &first[t];
+            while (*link != static_cast<int>(point)) link = &following[*link];
+            *link = following[point];
+            rescan(t);
+            continue;
+        }
+        oKept.push_back(point);
+
+        // The changed triangles are the fan around the new vertex, and together they cover the same area as before the insert
+        // Spoke i runs from the vertex between fan triangles i - 1 and i, a point is in triangle i when it is between spokes i and i + 1
+        tin.takeChanges(changed);
+        tin.trianglesAround(vertex, fan);
+        const std::vector<uint32_t>& indices = tin.indices();
+        spokes.clear();
+        for (uint32_t u : fan)
+        {
+            int k = 0;
+            while (indices[3 * u + k] != static_cast<uint32_t>(vertex)) ++k;
+            spokes.push_back(indices[3 * u + (k + 1) % 3]);
+            if (spokes.size() == fan.size()) spokes.push_back(indices[3 * u + (k + 2) % 3]);
+        }
+
+        // A point mostly lands in the triangle that took over the slot it was in, so the search starts there
+        moved.clear();
+        for (uint32_t u : changed)
+        {
+            if (u >= first.size()) continue;
+            const size_t start = std::find(fan.begin(), fan.end(), u) - fan.begin();
+            for (int i = first[u]; i >= 0; i = following[i])
+                if (i != static_cast<int>(point)) moved.emplace_back(i, start < fan.size() ? start : 0);
+            first[u] = -1;
+        }
+        first.resize(tin.triangleCount(), -1);
+        candidate.resize(tin.triangleCount(), -1);
+        version.resize(tin.triangleCount(), 0);
+
+        const QVector2D& center = positions[point];
+        for (auto [i, n] : moved)
+        {
+            // Clockwise triangles: right of spoke n and left of spoke n + 1, each spoke is tested once
+            auto side = [&](size_t spoke) { return Predicates::Orient2d(center, positions[oKept[spokes[spoke]]], positions[i]); };
+            double before = side(n);
+            size_t tried = 0;
+            for (; tried < fan.size(); ++tried)
+            {
+                const double after = side(n + 1);
+                if (before <= 0.0 && after >= 0.0) break;
+                before = after;
+                if (++n == fan.size()) {
+                    n = 0;
+                    before = side(0);
+                }
+            }
+            if (tried == fan.size()) continue; // Never with exact predicates, the fan covers the points
+            following[i] = first[fan[n]];
+            first[fan[n]] = static_cast<int>(i);
+        }
+        for (uint32_t u : changed) rescan(u);
+    }
+    if (heap.empty()) maxError = 0.0f;
+    snapshot(maxError);
+    oIndices = tin.indices();
+    for (uint32_t& kept : oKept) kept = keys[kept].second;
+
+    // Levels that weren't reached before the vertex limit are the finest TIN there is
+    maxError = std::max(maxError, droppedError);
+    for (; oLevels && nextLevel < lodTolerances.size(); ++nextLevel)
+        oLevels->push_back(Level{ lodTolerances[nextLevel], maxError, oKept.size(), oIndices });
+    return maxError;
+}
@@ -0,0 +1,40 @@
+#ifndef SIMPLIFICATION_H
+#define SIMPLIFICATION_H
+
+#include <vector>
+#include "Vertex.h"
+
+// Terrain simplification into a triangulated irregular network (TIN) by greedy insertion, after Garland and Heckbert's
+// "Fast Polygonal Approximation of Terrains and Height Fields". It starts from the convex hull of the points and keeps inserting
+// the point furthest above or below the surface until every point is within the tolerance, so flat ground ends up with few big
+// triangles and the detail goes where the terrain changes. Heights are Vertex::y, positions in the XZ plane
+namespace Simplification
+{
+
+struct Settings
+{
+    float tolerance{0.1f};              // Largest vertical distance from any input point to the TIN, in the units of the points
+                                        // Points at the XZ of a vertex but another height are beyond reach, see GreedyInsertion()
+    size_t maxVertices{0};              // Stops at this many vertices even if the tolerance isn't met yet, 0 for no limit
+    std::vector<float> lodTolerances;   // Coarser levels to keep on the way, for a LOD pyramid. Each should be above tolerance
+};
+
+// One level of the pyramid. The vertices are kept in insertion order, so every level is the first vertexCount of them
+struct Level
+{
+    float tolerance{0.0f};
+    float maxError{0.0f};               // The largest vertical distance that is actually left at this level
+    size_t vertexCount{0};
+    std::vector<uint32_t> indices;      // Into the kept vertices, like oIndices
+};
+
+// Fills oKept with the indices of the points that make up the TIN, in insertion order, and oIndices with its (Delaunay)
+// triangles as indices into oKept, wound like Delaunay::Triangulate(). Returns the largest vertical distance left, which includes
+// points sharing the XZ of a vertex at another height (LAS multi-returns), so it can stay above tolerance
+// With oLevels, one Level per lodTolerances entry comes back, coarsest first. Points on one line give no triangles
+float GreedyInsertion(const std::vector<Vertex>& points, std::vector<uint32_t>& oKept, std::vector<uint32_t>& oIndices,
+                      const Settings& settings = Settings(), std::vector<Level>* oLevels = nullptr);
+
+}
+
+#endif // SIMPLIFICATION_H
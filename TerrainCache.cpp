@@ -0,0 +1,214 @@
+#include "TerrainCache.h"
+#include "Parallel.h"
+#include "Triangle.h"
+#include <QFile>
+#include <QDebug>
+#include <cstring>
+#include <type_traits>
+
+static_assert(std::is_trivially_copyable<Vertex>::value, "Vertex is written to the cache as raw bytes");
+static_assert(std::is_trivially_copyable<Triangle>::value, "Triangle is written to the cache as raw bytes");
+
+namespace
+{
+
+struct Header
+{
+    char magic[8];
+    quint32 version;
+    quint32 vertexSize;         // sizeof(Vertex) and sizeof(Triangle) when the file was written, catches layout changes the version missed
+    quint32 triangleSize;
+    quint32 padding;
+    quint64 sourceHash;
+    quint64 optionsHash;
+    float min[3];
+    float max[3];
+    quint64 vertexCount;
+    quint64 indexCount;
+    quint64 triangleCount;
+    quint64 attributeCount;     // 0 or vertexCount, the columns of PointAttributes follow the triangles
+};
+
+constexpr char Magic[8] = {'V', 'S', 'T', 'E', 'R', 'R', 'A', 'N'};
+// Every array starts on a 16 byte boundary in the file
+constexpr size_t Alignment = 16;
+// The source is hashed in fixed blocks so the result doesn't depend on how many threads did the work
+constexpr qint64 HashBlockBytes = 16 << 20;
+
+size_t AlignUp(size_t offset) { return (offset + Alignment - 1) & ~(Alignment - 1); }
+
+quint64 Mix(quint64 h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+quint64 HashBytes(const uchar* data, size_t size, quint64 seed)
+{
+    quint64 h = seed ^ (size * 0x9e3779b97f4a7c15ULL);
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        quint64 word;
+        std::memcpy(&word, data + i, 8);
+        h = (h ^ Mix(word)) * 0x9e3779b97f4a7c15ULL;
+    }
+    quint64 tail = 0;
+    std::memcpy(&tail, data + i, size - i);
+    return Mix(h ^ Mix(tail));
+}
+
+bool SameBounds(const float stored[3], const QVector3D& bounds)
+{
+    return stored[0] == bounds.x() && stored[1] == bounds.y() && stored[2] == bounds.z();
+}
+
+}
+
+quint64 TerrainCache::HashCombine(quint64 seed, quint64 value)
+{
+    return Mix(seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2)));
+}
+
+quint64 TerrainCache::HashFile(const std::string &filename)
+{
+    QFile file(QString::fromStdString(filename));
+    if (!file.open(QIODevice::ReadOnly)) return 0;
+
+    const qint64 fileSize = file.size();
+    if (fileSize <= 0) return 0;
+    const uchar* data = file.map(0, fileSize);
+    if (!data) return 0;
+
+    const size_t blockCount = (fileSize + HashBlockBytes - 1) / HashBlockBytes;
+    std::vector<quint64> blockHashes(blockCount);
+    Parallel::For(0, blockCount, [&](size_t block)
+    {
+        const qint64 begin = block * HashBlockBytes;
+        const qint64 size = std::min(HashBlockBytes, fileSize - begin);
+        blockHashes[block] = HashBytes(data + begin, size, block);
+    }, 1);
+
+    file.unmap(const_cast<uchar*>(data));
+    return HashBytes(reinterpret_cast<const uchar*>(blockHashes.data()), blockHashes.size() * sizeof(quint64), fileSize);
+}
+
+bool TerrainCache::Load(const std::string &cacheFile, const Key &key, std::vector<Vertex> &oVertices, std::vector<uint32_t> &oIndices, std::vector<Triangle> &oTriangles,
+                        PointAttributes &oAttributes)
+{
+    QFile file(QString::fromStdString(cacheFile));
+    if (!file.exists() || !file.open(QIODevice::ReadOnly)) return false;
+
+    const qint64 fileSize = file.size();
+    if (fileSize < static_cast<qint64>(sizeof(Header))) return false;
+    uchar* data = file.map(0, fileSize);
+    if (!data) return false;
+
+    Header header;
+    std::memcpy(&header, data, sizeof(Header));
+
+    const size_t vertexOffset = AlignUp(sizeof(Header));
+    const size_t indexOffset = AlignUp(vertexOffset + header.vertexCount * sizeof(Vertex));
+    const size_t triangleOffset = AlignUp(indexOffset + header.indexCount * sizeof(uint32_t));
+    const size_t intensityOffset = AlignUp(triangleOffset + header.triangleCount * sizeof(Triangle));
+    const size_t returnNumberOffset = AlignUp(intensityOffset + header.attributeCount * sizeof(quint16));
+    const size_t numberOfReturnsOffset = AlignUp(returnNumberOffset + header.attributeCount);
+    const size_t classificationOffset = AlignUp(numberOfReturnsOffset + header.attributeCount);
+    const size_t expectedSize = classificationOffset + header.attributeCount;
+
+    const bool valid = std::memcmp(header.magic, Magic, sizeof(Magic)) == 0 && header.version == Version &&
+                       header.vertexSize == sizeof(Vertex) && header.triangleSize == sizeof(Triangle) &&
+                       header.sourceHash == key.sourceHash && header.optionsHash == key.optionsHash &&
+                       SameBounds(header.min, key.min) && SameBounds(header.max, key.max) &&
+                       static_cast<size_t>(fileSize) >= expectedSize;
+    if (!valid) {
+        qDebug() << "Terrain cache " << cacheFile.c_str() << " is out of date, rebuilding.";
+        file.unmap(data);
+        return false;
+    }
+
+    const Vertex* vertices = reinterpret_cast<const Vertex*>(data + vertexOffset);
+    const uint32_t* indices = reinterpret_cast<const uint32_t*>(data + indexOffset);
+    const Triangle* triangles = reinterpret_cast<const Triangle*>(data + triangleOffset);
+
+    oVertices.assign(vertices, vertices + header.vertexCount);
+    oIndices.assign(indices, indices + header.indexCount);
+    oTriangles.insert(oTriangles.end(), triangles, triangles + header.triangleCount);
+
+    const quint16* intensity = reinterpret_cast<const quint16*>(data + intensityOffset);
+    oAttributes.intensity.assign(intensity, intensity + header.attributeCount);
+    oAttributes.returnNumber.assign(data + returnNumberOffset, data + returnNumberOffset + header.attributeCount);
+    oAttributes.numberOfReturns.assign(data + numberOfReturnsOffset, data + numberOfReturnsOffset + header.attributeCount);
+    oAttributes.classification.assign(data + classificationOffset, data + classificationOffset + header.attributeCount);
+
+    file.unmap(data);
+    qDebug() << "Loaded " << header.vertexCount << " points and " << header.triangleCount << " triangles from " << cacheFile.c_str();
+    return true;
+}
+
+bool TerrainCache::Save(const std::string &cacheFile, const Key &key, const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices, const Triangle *triangles, size_t triangleCount,
+                        const PointAttributes &attributes)
+{
+    Header header{};
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = Version;
+    header.vertexSize = sizeof(Vertex);
+    header.triangleSize = sizeof(Triangle);
+    header.sourceHash = key.sourceHash;
+    header.optionsHash = key.optionsHash;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        header.min[axis] = key.min[axis];
+        header.max[axis] = key.max[axis];
+    }
+    header.vertexCount = vertices.size();
+    header.indexCount = indices.size();
+    header.triangleCount = triangleCount;
+    header.attributeCount = attributes.size();
+
+    // Write to a temporary file first, so a crash halfway through never leaves a cache that looks valid
+    const QString finalName = QString::fromStdString(cacheFile);
+    const QString tempName = QString::fromStdString(cacheFile + ".tmp");
+    QFile file(tempName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qDebug() << "ERROR: Could not write terrain cache: " << cacheFile.c_str();
+        return false;
+    }
+
+    size_t written = 0;
+    auto writeAligned = [&](const void* data, size_t size) -> bool
+    {
+        static const char zeros[Alignment] = {};
+        const size_t padding = AlignUp(written) - written;
+        if (file.write(zeros, padding) != static_cast<qint64>(padding)) return false;
+        if (file.write(static_cast<const char*>(data), size) != static_cast<qint64>(size)) return false;
+        written += padding + size;
+        return true;
+    };
+
+    const bool ok = writeAligned(&header, sizeof(Header)) &&
+                    writeAligned(vertices.data(), vertices.size() * sizeof(Vertex)) &&
+                    writeAligned(indices.data(), indices.size() * sizeof(uint32_t)) &&
+                    writeAligned(triangles, triangleCount * sizeof(Triangle)) &&
+                    writeAligned(attributes.intensity.data(), attributes.size() * sizeof(quint16)) &&
+                    writeAligned(attributes.returnNumber.data(), attributes.size()) &&
+                    writeAligned(attributes.numberOfReturns.data(), attributes.size()) &&
+                    writeAligned(attributes.classification.data(), attributes.size());
+    file.close();
+    if (!ok) {
+        qDebug() << "ERROR: Could not write terrain cache: " << cacheFile.c_str();
+        QFile::remove(tempName);
+        return false;
+    }
+
+    QFile::remove(finalName);
+    if (!QFile::rename(tempName, finalName)) {
+        qDebug() << "ERROR: Could not move terrain cache into place: " << cacheFile.c_str();
+        return false;
+    }
+    return true;
+}
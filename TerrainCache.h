@@ -0,0 +1,39 @@
+#ifndef TERRAINCACHE_H
+#define TERRAINCACHE_H
+
+#include <QVector3D>
+#include <string>
+#include <vector>
+#include "PointAttributes.h"
+#include "Vertex.h"
+class Triangle;
+
+// Binary cache of everything PointCloud computes from a source file, so the next start can skip parsing and triangulation
+namespace TerrainCache
+{
+
+// Bump this whenever the file layout, Vertex, Triangle or the processing in PointCloud changes
+constexpr quint32 Version = 4;
+
+// A cache file is only used if every field matches what the caller is about to compute
+struct Key
+{
+    quint64 sourceHash{0};      // Hash of the source file contents
+    quint64 optionsHash{0};     // Hash of the processing options, supplied by the caller
+    QVector3D min;              // Target bounds the points are normalised into
+    QVector3D max;
+};
+
+quint64 HashFile(const std::string& filename);
+// Mixes value into seed, for building Key::optionsHash out of individual settings
+quint64 HashCombine(quint64 seed, quint64 value);
+
+// Returns false if the cache is missing, stale or unreadable, oTriangles is appended to like in PointCloud
+bool Load(const std::string& cacheFile, const Key& key, std::vector<Vertex>& oVertices, std::vector<uint32_t>& oIndices, std::vector<Triangle>& oTriangles,
+          PointAttributes& oAttributes);
+bool Save(const std::string& cacheFile, const Key& key, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const Triangle* triangles, size_t triangleCount,
+          const PointAttributes& attributes);
+
+}
+
+#endif // TERRAINCACHE_H
@@ -0,0 +1,147 @@
+#include "TileStreamer.h"
+#include <QDebug>
+#include <algorithm>
+#include <numeric>
+
+namespace
+{
+
+float DistanceSquared(const AABB& bounds, const QVector3D& point)
+{
+    float distance = 0.0f;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        const float outside = std::max({ bounds.mMin[axis] - point[axis], 0.0f, point[axis] - bounds.mMax[axis] });
+        distance += outside * outside;
+    }
+    return distance;
+}
+
+}
+
+TileStreamer::TileStreamer() {}
+
+TileStreamer::~TileStreamer()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mWake.notify_all();
+    if (mWorker.joinable()) mWorker.join();
+}
+
+bool TileStreamer::open(const std::string &tileFile)
+{
+    if (mWorker.joinable()) return false; // One tile set per streamer
+    if (!PointTiles::ReadIndex(tileFile, mTileSet)) return false;
+
+    mTileFile = tileFile;
+    const size_t tileCount = mTileSet.tiles.size();
+    mState.assign(tileCount, State::Unloaded);
+    mTileLods.assign(tileCount, {});
+    mRamWanted.assign(tileCount, 0);
+    mInFlight.assign(tileCount, 0);
+
+    mWorker = std::thread(&TileStreamer::workerLoop, this);
+    qDebug() << "Streaming " << tileCount << " tiles from " << tileFile.c_str();
+    return true;
+}
+
+void TileStreamer::update(const QVector3D &viewer)
+{
+    if (mTileSet.tiles.empty()) return;
+
+    // Take over everything the worker finished since the last frame
+    std::vector<std::pair<int, PointLod>> completed;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        completed.swap(mCompleted);
+    }
+    for (auto& [tile, lod] : completed)
+    {
+        // Reads for tiles that fell out of the budget while in flight are just dropped
+        if (mState[tile] != State::Queued) continue;
+        mTileLods[tile] = std::move(lod);
+        mState[tile] = State::Resident;
+        mResidentBytes += tileBytes(tile);
+    }
+
+    std::vector<int> order(mTileSet.tiles.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::vector<float> distance(order.size());
+    for (size_t i = 0; i < order.size(); ++i) distance[i] = DistanceSquared(mTileSet.tiles[i].bounds, viewer);
+    std::sort(order.begin(), order.end(), [&](int a, int b) { return distance[a] < distance[b]; });
+
+    // The nearest tiles that fit in the budget
+    std::fill(mRamWanted.begin(), mRamWanted.end(), 0);
+    mResidentTiles.clear();
+    size_t ramUsed = 0;
+    std::vector<int> newRequests;
+    for (int tile : order)
+    {
+        const size_t bytes = tileBytes(tile);
+        if (ramUsed + bytes > mRamBudget) break;
+        ramUsed += bytes;
+        mRamWanted[tile] = 1;
+
+        if (mState[tile] == State::Resident) mResidentTiles.push_back(tile);
+        else if (mState[tile] == State::Unloaded) {
+            mState[tile] = State::Queued;
+            newRequests.push_back(tile);
+        }
+    }
+
+    // Free tiles that fell out of the budget, queued reads for them are cancelled by leaving them out of the new queue
+    for (size_t tile = 0; tile < mState.size(); ++tile)
+    {
+        if (mRamWanted[tile]) continue;
+        if (mState[tile] == State::Resident) {
+            mResidentBytes -= tileBytes(tile);
+            mTileLods[tile] = PointLod();
+        }
+        mState[tile] = State::Unloaded;
+    }
+
+    {
+        // Requests are served nearest first, so rebuild the queue in the new order
+        std::lock_guard<std::mutex> lock(mMutex);
+        mRequests.clear();
+        for (int tile : order)
+        {
+            if (!mRamWanted[tile]) break;
+            if (mState[tile] == State::Queued && !mInFlight[tile]) mRequests.push_back(tile);
+        }
+    }
+    if (!newRequests.empty()) mWake.notify_one();
+}
+
+void TileStreamer::workerLoop()
+{
+    std::ifstream file(mTileFile, std::ios::binary);
+
+    while (true)
+    {
+        int tile{-1};
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mWake.wait(lock, [this]() { return mStopping || !mRequests.empty(); });
+            if (mStopping) return;
+            tile = mRequests.front();
+            mRequests.pop_front();
+            mInFlight[tile] = 1;
+        }
+
+        std::vector<Vertex> points;
+        if (!PointTiles::ReadTile(file, mTileSet.tiles[tile], points)) {
+            qDebug() << "ERROR: Could not read tile " << tile << " from " << mTileFile.c_str();
+            points.clear();
+        }
+        // Building the octree here keeps it off the render thread, it also reorders the points so each node is one range
+        PointLod lod(std::move(points), mTileSet.tiles[tile].bounds);
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        mInFlight[tile] = 0;
+        mCompleted.emplace_back(tile, std::move(lod));
+    }
+}
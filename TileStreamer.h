@@ -0,0 +1,61 @@
+#ifndef TILESTREAMER_H
+#define TILESTREAMER_H
+
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "PointLod.h"
+#include "PointTiles.h"
+
+// Keeps the tiles of a tile set closest to the viewer in memory, reading them and building their PointLod on a background thread
+// Renderer decides what actually goes to the GPU, this class only ranks the tiles and owns the CPU copies
+class TileStreamer
+{
+public:
+    TileStreamer();
+    ~TileStreamer();
+
+    bool open(const std::string& tileFile);
+    void setRamBudget(size_t ramBytes) { mRamBudget = ramBytes; }
+
+    // Call once per frame with the viewer position in tile set coordinates
+    // Ranks the tiles by distance, queues reads for the ones that fit the RAM budget and frees the rest
+    void update(const QVector3D& viewer);
+
+    const PointTiles::TileSet& tileSet() const { return mTileSet; }
+    // Resident tiles, nearest first
+    const std::vector<int>& residentTiles() const { return mResidentTiles; }
+    bool isResident(int tile) const { return mState[tile] == State::Resident; }
+    const PointLod& tileLod(int tile) const { return mTileLods[tile]; }
+    size_t residentBytes() const { return mResidentBytes; }
+
+private:
+    enum class State { Unloaded, Queued, Resident };
+
+    void workerLoop();
+    size_t tileBytes(int tile) const { return mTileSet.tiles[tile].count * sizeof(PointLod::Point); }  // What the tile holds once resident, the full vertices only live during the build
+
+    std::string mTileFile;
+    PointTiles::TileSet mTileSet;
+    std::vector<State> mState;
+    std::vector<PointLod> mTileLods;
+    std::vector<char> mRamWanted;
+    std::vector<int> mResidentTiles;
+    size_t mResidentBytes{0};
+
+    size_t mRamBudget{512u << 20};
+
+    // Shared with the worker thread, everything below is guarded by mMutex
+    std::mutex mMutex;
+    std::condition_variable mWake;
+    std::deque<int> mRequests;
+    std::vector<std::pair<int, PointLod>> mCompleted;
+    std::vector<char> mInFlight;     // Popped by the worker but not completed yet, so update() doesn't queue them twice
+    bool mStopping{false};
+    std::thread mWorker;
+};
+
+#endif // TILESTREAMER_H
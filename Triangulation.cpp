@@ -0,0 +1,577 @@
+#include "Triangulation.h"
+#include "Delaunay.h"
+#include "Predicates.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+Triangulation::Triangulation(const std::vector<QVector2D> &points)
+{
+    build(points);
+}
+
+void Triangulation::build(const std::vector<QVector2D> &points)
+{
+    std::vector<uint32_t> indices;
+    std::vector<int> halfedges;
+    Delaunay::Triangulate(points, indices, &halfedges);
+
+    mPoints = points;
+    mTriangles.swap(indices);
+    mHalfedges.swap(halfedges);
+    mPointEdge.assign(mPoints.size(), -1);
+    for (size_t e = 0; e < mTriangles.size(); ++e) mPointEdge[mTriangles[e]] = static_cast<int>(e);
+    // Everything when there are no triangles, otherwise the duplicates Delaunay::Triangulate() skipped
+    mPending.clear();
+    mDuplicates.clear();
+    for (uint32_t i = 0; i < mPoints.size(); ++i)
+        if (mPointEdge[i] < 0) mPending.push_back(i);
+    mChanged.clear();
+    mLast = 0;
+    buildStarts();
+    queueDuplicates();
+}
+
+void Triangulation::build(const std::vector<QVector2D> &points, const std::vector<uint32_t> &indices)
+{
+    mPoints = points;
+    mTriangles = indices;
+    mHalfedges.assign(mTriangles.size(), -1);
+
+    // Halfedge u -> v pairs up with v -> u, sorting by the unordered pair puts the two next to each other
+    std::vector<std::pair<uint64_t, int>> edges(mTriangles.size());
+    for (size_t e = 0; e < mTriangles.size(); ++e)
+    {
+        const uint64_t u = mTriangles[e], v = mTriangles[next(static_cast<int>(e))];
+        edges[e] = { std::min(u, v) << 32 | std::max(u, v), static_cast<int>(e) };
+    }
+    std::sort(edges.begin(), edges.end());
+    for (size_t i = 0; i + 1 < edges.size(); ++i)
+        if (edges[i].first == edges[i + 1].first) {
+            link(edges[i].second, edges[i + 1].second);
+            ++i;
+        }
+
+    mPointEdge.assign(mPoints.size(), -1);
+    for (size_t e = 0; e < mTriangles.size(); ++e) mPointEdge[mTriangles[e]] = static_cast<int>(e);
+    // Everything when there are no triangles, otherwise the duplicates Delaunay::Triangulate() skipped
+    mPending.clear();
+    mDuplicates.clear();
+    for (uint32_t i = 0; i < mPoints.size(); ++i)
+        if (mPointEdge[i] < 0) mPending.push_back(i);
+    mChanged.clear();
+    mLast = 0;
+    buildStarts();
+    queueDuplicates();
+}
+
+int Triangulation::insert(const QVector2D &point)
+{
+    const uint32_t p = static_cast<uint32_t>(mPoints.size());
+    mPoints.push_back(point);
+    mPointEdge.push_back(-1);
+    if (mTriangles.empty())
+    {
+        mPending.push_back(p);
+        buildFromPending();
+    }
+    else if (!place(p))
+    {
+        mPoints.pop_back();
+        mPointEdge.pop_back();
+        return -1;
+    }
+    return static_cast<int>(p);
+}
+
+bool Triangulation::place(uint32_t p)
+{
+    const QVector2D point = mPoints[p];
+    const int where = locate(point);
+    if (where >= 0)
+    {
+        const uint32_t t = static_cast<uint32_t>(where);
+        int onEdge = -1;
+        for (int k = 0; k < 3; ++k)
+        {
+            const QVector2D& corner = mPoints[mTriangles[3 * t + k]];
+            if (corner == point) return false;
+            if (Predicates::Orient2d(corner, mPoints[mTriangles[next(3 * t + k)]], point) == 0.0) onEdge = 3 * t + k;
+        }
+
+        if (onEdge < 0)
+        {
+            // Inside: a, b, c becomes a, b, p and two new triangles b, c, p and c, a, p
+            const uint32_t a = mTriangles[3 * t], b = mTriangles[3 * t + 1], c = mTriangles[3 * t + 2];
+            const int ab = mHalfedges[3 * t], bc = mHalfedges[3 * t + 1], ca = mHalfedges[3 * t + 2];
+            setTriangle(t, a, b, p);
+            const uint32_t t1 = addTriangle(b, c, p), t2 = addTriangle(c, a, p);
+            link(3 * t, ab);
+            link(3 * t + 1, 3 * t1 + 2);
+            link(3 * t + 2, 3 * t2 + 1);
+            link(3 * t1, bc);
+            link(3 * t1 + 1, 3 * t2 + 2);
+            link(3 * t2, ca);
+            mPointEdge[p] = 3 * t + 2;
+            mPointEdge[a] = 3 * t;
+            mPointEdge[b] = 3 * t1;
+            mPointEdge[c] = 3 * t2;
+            mEdgeStack.insert(mEdgeStack.end(), { static_cast<int>(3 * t), static_cast<int>(3 * t1), static_cast<int>(3 * t2) });
+        }
+        else
+        {
+            // On edge a -> b: both triangles on it are split in two, on the hull there is only one
+            const int f = mHalfedges[onEdge];
+            const uint32_t a = mTriangles[onEdge], b = mTriangles[next(onEdge)], c = mTriangles[previous(onEdge)];
+            const int bc = mHalfedges[next(onEdge)], ca = mHalfedges[previous(onEdge)];
+            setTriangle(t, p, b, c);
+            const uint32_t t1 = addTriangle(a, p, c);
+            link(3 * t + 1, bc);
+            link(3 * t + 2, 3 * t1 + 1);
+            link(3 * t1 + 2, ca);
+            mPointEdge[p] = 3 * t;
+            mPointEdge[a] = 3 * t1;
+            mPointEdge[b] = 3 * t + 1;
+            mPointEdge[c] = 3 * t + 2;
+            mEdgeStack.insert(mEdgeStack.end(), { static_cast<int>(3 * t + 1), static_cast<int>(3 * t1 + 2) });
+            if (f < 0)
+            {
+                link(3 * t, -1);
+                link(3 * t1, -1);
+            }
+            else
+            {
+                const uint32_t u = f / 3;
+                const uint32_t d = mTriangles[previous(f)];
+                const int ad = mHalfedges[next(f)], db = mHalfedges[previous(f)];
+                setTriangle(u, b, p, d);
+                const uint32_t u1 = addTriangle(p, a, d);
+                link(3 * u, 3 * t);
+                link(3 * u + 1, 3 * u1 + 2);
+                link(3 * u + 2, db);
+                link(3 * u1, 3 * t1);
+                link(3 * u1 + 1, ad);
+                mPointEdge[d] = 3 * u + 2;
+                mEdgeStack.insert(mEdgeStack.end(), { static_cast<int>(3 * u + 2), static_cast<int>(3 * u1 + 1) });
+            }
+        }
+    }
+    else
+    {
+        // Outside the hull: a fan of triangles over every hull edge the point can see
+        const int start = -2 - where;
+        auto visible = [&](int e) { return Predicates::Orient2d(mPoints[mTriangles[e]], mPoints[mTriangles[next(e)]], point) > 0.0; };
+        int first = start;
+        for (int e = hullPrevious(start); e != start && visible(e); e = hullPrevious(e)) first = e;
+        std::vector<int> hull;
+        for (int e = first; visible(e) && (hull.empty() || e != first); e = hullNext(e)) hull.push_back(e);
+
+        int previousTriangle = -1;
+        for (int e : hull)
+        {
+            const uint32_t x = mTriangles[e], y = mTriangles[next(e)];
+            const uint32_t t = addTriangle(y, x, p);
+            link(3 * t, e);
+            if (previousTriangle >= 0) link(3 * t + 1, 3 * previousTriangle + 2);
+            previousTriangle = static_cast<int>(t);
+            mEdgeStack.push_back(static_cast<int>(3 * t));
+        }
+        mPointEdge[p] = 3 * previousTriangle + 2;
+    }
+
+    legalize();
+    return true;
+}
+
+bool Triangulation::remove(uint32_t point)
+{
+    if (!contains(point))
+    {
+        const auto pending = std::find(mPending.begin(), mPending.end(), point);
+        if (pending != mPending.end()) {
+            mPending.erase(pending);
+            return true;
+        }
+        const auto duplicate = std::find_if(mDuplicates.begin(), mDuplicates.end(), [&](const auto& waiting) { return waiting.second == point; });
+        if (duplicate == mDuplicates.end()) return false;
+        mDuplicates.erase(duplicate);
+        return true;
+    }
+
+    // The fan of halfedges leaving point, in winding order. On the hull it starts at the hull edge
+    std::vector<int> fan;
+    int e = mPointEdge[point];
+    for (int back; mHalfedges[e] >= 0 && (back = next(mHalfedges[e])) != mPointEdge[point];) e = back;
+    const int first = e;
+    bool closed = false;
+    while (true)
+    {
+        fan.push_back(e);
+        e = mHalfedges[previous(e)];
+        if (e < 0) break;
+        if (e == first) {
+            closed = true;
+            break;
+        }
+    }
+
+    // The ring of neighbours around the hole, and the halfedge on the far side of each ring edge (ring[i] -> ring[i + 1])
+    std::vector<uint32_t> ring, slots;
+    std::vector<int> outer;
+    for (int f : fan)
+    {
+        ring.push_back(mTriangles[next(f)]);
+        outer.push_back(mHalfedges[next(f)]);
+        slots.push_back(f / 3);
+    }
+    if (!closed) ring.push_back(mTriangles[previous(fan.back())]);
+    mPointEdge[point] = -1;
+
+    // Until the new triangles are there, every neighbour keeps a halfedge from the triangles outside the hole (if there are any)
+    for (uint32_t r : ring) mPointEdge[r] = -1;
+    for (size_t i = 0; i < outer.size(); ++i)
+    {
+        if (outer[i] < 0) continue;
+        mPointEdge[ring[(i + 1) % ring.size()]] = outer[i];
+        mPointEdge[ring[i]] = next(outer[i]);
+    }
+
+    // Ear clipping, an ear is a corner turning the same way as the triangles that has point outside it, so the ear stays inside the hole
+    size_t used = 0;
+    auto corner = [&](size_t i) { return mPoints[ring[i % ring.size()]]; };
+    auto isEar = [&](size_t i, bool strict)
+    {
+        const size_t before = i + ring.size() - 1;
+        if (Predicates::Orient2d(corner(before), corner(i), corner(i + 1)) >= 0.0) return false;
+        return !strict || Predicates::Orient2d(corner(i + 1), corner(before), mPoints[point]) >= 0.0;
+    };
+    auto clip = [&](size_t i)
+    {
+        const size_t before = (i + ring.size() - 1) % ring.size(), after = (i + 1) % ring.size();
+        const uint32_t t = slots[used++];
+        setTriangle(t, ring[before], ring[i], ring[after]);
+        link(3 * t, outer[before]);
+        link(3 * t + 1, outer[i]);
+        mHalfedges[3 * t + 2] = -1;
+        mPointEdge[ring[before]] = 3 * t;
+        mPointEdge[ring[i]] = 3 * t + 1;
+        mPointEdge[ring[after]] = 3 * t + 2;
+        mEdgeStack.insert(mEdgeStack.end(), { static_cast<int>(3 * t), static_cast<int>(3 * t + 1), static_cast<int>(3 * t + 2) });
+        // The new edge ring[before] -> ring[after] has the new triangle on its far side
+        outer[before] = 3 * t + 2;
+        ring.erase(ring.begin() + i);
+        outer.erase(outer.begin() + i);
+    };
+    if (closed)
+    {
+        while (ring.size() > 3)
+        {
+            size_t ear = ring.size();
+            for (size_t i = 0; i < ring.size() && ear == ring.size(); ++i) if (isEar(i, true)) ear = i;
+            for (size_t i = 0; i < ring.size() && ear == ring.size(); ++i) if (isEar(i, false)) ear = i;
+            if (ear == ring.size()) break;
+            clip(ear);
+        }
+        if (ring.size() == 3)
+        {
+            const uint32_t t = slots[used++];
+            setTriangle(t, ring[0], ring[1], ring[2]);
+            for (int k = 0; k < 3; ++k) {
+                link(3 * t + k, outer[k]);
+                mPointEdge[ring[k]] = 3 * t + k;
+                mEdgeStack.push_back(3 * t + k);
+            }
+        }
+    }
+    else
+    {
+        // Open at the hull, the corners that turn the other way are the new hull
+        while (ring.size() > 2)
+        {
+            size_t ear = 0;
+            for (size_t i = 1; i + 1 < ring.size() && !ear; ++i) if (isEar(i, true)) ear = i;
+            if (!ear) break;
+            clip(ear);
+        }
+        for (size_t i = 0; i + 1 < ring.size(); ++i)
+            if (outer[i] >= 0) mHalfedges[outer[i]] = -1;
+    }
+
+    legalize();
+
+    // Leftover slots go from the back, so the last triangle moved into a free slot is never another leftover
+    std::sort(slots.begin() + used, slots.end(), std::greater<uint32_t>());
+    for (size_t i = used; i < slots.size(); ++i) freeTriangle(slots[i]);
+
+    // Neighbours without any triangle left (the rest ended up on one line) wait for a point off that line
+    for (uint32_t r : ring)
+        if (mPointEdge[r] < 0) mPending.push_back(r);
+    // A duplicate of point takes its place, any others wait for that one now
+    const auto [firstTwin, lastTwin] = mDuplicates.equal_range(point);
+    std::vector<uint32_t> twins;
+    for (auto twin = firstTwin; twin != lastTwin; ++twin) twins.push_back(twin->second);
+    mDuplicates.erase(point);
+    if (!twins.empty())
+    {
+        if (!mTriangles.empty() && place(twins.front()))
+            for (size_t i = 1; i < twins.size(); ++i) mDuplicates.emplace(twins.front(), twins[i]);
+        else mPending.insert(mPending.end(), twins.begin(), twins.end());
+    }
+    if (mTriangles.empty()) buildFromPending();
+    else
+        mPending.erase(std::remove_if(mPending.begin(), mPending.end(), [&](uint32_t i) { return place(i); }), mPending.end());
+    return true;
+}
+
+void Triangulation::trianglesAround(uint32_t point, std::vector<uint32_t> &oTriangles) const
+{
+    oTriangles.clear();
+    if (!contains(point)) return;
+    int e = mPointEdge[point];
+    for (int back; mHalfedges[e] >= 0 && (back = next(mHalfedges[e])) != mPointEdge[point];) e = back;
+    const int first = e;
+    do {
+        oTriangles.push_back(e / 3);
+        e = mHalfedges[previous(e)];
+    } while (e >= 0 && e != first);
+}
+
+void Triangulation::takeChanges(std::vector<uint32_t> &oTriangles)
+{
+    std::sort(mChanged.begin(), mChanged.end());
+    mChanged.erase(std::unique(mChanged.begin(), mChanged.end()), mChanged.end());
+    mChanged.erase(std::lower_bound(mChanged.begin(), mChanged.end(), static_cast<uint32_t>(triangleCount())), mChanged.end());
+    oTriangles.swap(mChanged);
+    mChanged.clear();
+}
+
+int Triangulation::locate(const QVector2D &point) const
+{
+    return locate(point, mLast);
+}
+
+int Triangulation::locate(const QVector2D &point, uint32_t &ioHint) const
+{
+    if (mTriangles.empty()) return -1;
+    uint32_t t = ioHint < triangleCount() ? ioHint : 0;
+
+    // Queries that follow each other (a camera, a moving sphere, the next point of a scan) are a few steps from the hint
+    // Anything further away starts over from the triangle filed under its cell, so random queries don't cross the terrain either
+    int found = walk(point, t, ShortWalk);
+    if (found == -1)
+    {
+        if (!mStarts.empty())
+        {
+            const uint32_t start = mStarts[startCell(point)];
+            if (start < triangleCount()) t = start;
+        }
+        // A visibility walk always ends on a Delaunay triangulation, the step limit is only there in case it was built from something else
+        found = walk(point, t, triangleCount());
+    }
+
+    if (found == -1)
+    {
+        int hull = -1;
+        for (t = 0; t < triangleCount() && found == -1; ++t)
+        {
+            int exit = -1;
+            for (int k = 0; k < 3 && exit < 0; ++k)
+            {
+                const int e = 3 * t + k;
+                if (Predicates::Orient2d(mPoints[mTriangles[e]], mPoints[mTriangles[next(e)]], point) > 0.0) exit = e;
+            }
+            if (exit < 0) found = static_cast<int>(t);
+            else if (mHalfedges[exit] < 0 && hull < 0) hull = exit;
+        }
+        if (found == -1) found = -2 - hull;
+        t = found >= 0 ? found : 0;
+    }
+    ioHint = t;
+    return found;
+}
+
+int Triangulation::walk(const QVector2D &point, uint32_t &ioTriangle, size_t maxSteps) const
+{
+    uint32_t t = ioTriangle;
+    for (size_t steps = 0; steps <= maxSteps; ++steps)
+    {
+        int exit = -1;
+        for (int k = 0; k < 3 && exit < 0; ++k)
+        {
+            const int e = 3 * t + k;
+            if (Predicates::Orient2d(mPoints[mTriangles[e]], mPoints[mTriangles[next(e)]], point) > 0.0) exit = e;
+        }
+        ioTriangle = t;
+        if (exit < 0) return static_cast<int>(t);
+        if (mHalfedges[exit] < 0) return -2 - exit;
+        t = mHalfedges[exit] / 3;
+    }
+    return -1;
+}
+
+void Triangulation::link(int a, int b)
+{
+    mHalfedges[a] = b;
+    if (b >= 0) mHalfedges[b] = a;
+}
+
+void Triangulation::setTriangle(uint32_t t, uint32_t i0, uint32_t i1, uint32_t i2)
+{
+    mTriangles[3 * t] = i0;
+    mTriangles[3 * t + 1] = i1;
+    mTriangles[3 * t + 2] = i2;
+    mChanged.push_back(t);
+    fileStart(t);
+}
+
+uint32_t Triangulation::addTriangle(uint32_t i0, uint32_t i1, uint32_t i2)
+{
+    const uint32_t t = static_cast<uint32_t>(triangleCount());
+    mTriangles.insert(mTriangles.end(), { i0, i1, i2 });
+    mHalfedges.insert(mHalfedges.end(), { -1, -1, -1 });
+    mChanged.push_back(t);
+    fileStart(t);
+    return t;
+}
+
+void Triangulation::freeTriangle(uint32_t t)
+{
+    const uint32_t last = static_cast<uint32_t>(triangleCount() - 1);
+    if (t != last)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            const int from = 3 * last + k, to = 3 * t + k;
+            mTriangles[to] = mTriangles[from];
+            link(to, mHalfedges[from]);
+            if (mPointEdge[mTriangles[to]] == from) mPointEdge[mTriangles[to]] = to;
+        }
+        mChanged.push_back(t);
+        fileStart(t);
+    }
+    mTriangles.resize(3 * last);
+    mHalfedges.resize(3 * last);
+    if (mLast >= last) mLast = t < last ? t : 0;
+}
+
+void Triangulation::legalize()
+{
+    while (!mEdgeStack.empty())
+    {
+        const int e = mEdgeStack.back();
+        mEdgeStack.pop_back();
+        const int f = mHalfedges[e];
+        if (f < 0) continue;
+
+        // Triangles a, b, c and b, a, d on either side of a -> b, the edge is fine unless d is inside the circle through a, b, c
+        // The triangles wind clockwise (normals up in XZ), which flips the sign of the incircle test
+        const uint32_t a = mTriangles[e], b = mTriangles[next(e)], c = mTriangles[previous(e)], d = mTriangles[previous(f)];
+        if (Predicates::InCircle(mPoints[a], mPoints[b], mPoints[c], mPoints[d]) >= 0.0) continue;
+
+        const uint32_t t = e / 3, u = f / 3;
+        const int ca = mHalfedges[previous(e)], bc = mHalfedges[next(e)], ad = mHalfedges[next(f)], db = mHalfedges[previous(f)];
+        setTriangle(t, c, a, d);
+        setTriangle(u, d, b, c);
+        link(3 * t, ca);
+        link(3 * t + 1, ad);
+        link(3 * t + 2, 3 * u + 2);
+        link(3 * u, db);
+        link(3 * u + 1, bc);
+        mPointEdge[a] = 3 * t + 1;
+        mPointEdge[b] = 3 * u + 1;
+        mPointEdge[c] = 3 * t;
+        mPointEdge[d] = 3 * u;
+        mEdgeStack.insert(mEdgeStack.end(), { static_cast<int>(3 * t), static_cast<int>(3 * t + 1), static_cast<int>(3 * u), static_cast<int>(3 * u + 1) });
+        mLast = t;
+    }
+}
+
+int Triangulation::hullNext(int e) const
+{
+    int h = next(e);
+    while (mHalfedges[h] >= 0) h = next(mHalfedges[h]);
+    return h;
+}
+
+int Triangulation::hullPrevious(int e) const
+{
+    int h = previous(e);
+    while (mHalfedges[h] >= 0) h = previous(mHalfedges[h]);
+    return h;
+}
+
+void Triangulation::buildStarts()
+{
+    mStarts.clear();
+    if (triangleCount() < 4 * ShortWalk) return;
+
+    // About four triangles per cell. Edits file every triangle they write under its cell again, see fileStart(). A cell can still
+    // point at a slot that went somewhere else when nothing was written there since, but any triangle is a valid place to start a walk
+    QVector2D min = mPoints[mTriangles[0]], max = min;
+    for (uint32_t i : mTriangles) {
+        min = QVector2D(std::min(min.x(), mPoints[i].x()), std::min(min.y(), mPoints[i].y()));
+        max = QVector2D(std::max(max.x(), mPoints[i].x()), std::max(max.y(), mPoints[i].y()));
+    }
+    const QVector2D size = max - min;
+    mStartsCell = std::max(std::sqrt(size.x() * size.y() * 4.0f / triangleCount()), std::max(size.x(), size.y()) / 65536.0f);
+    mStartsMin = min;
+    mStartsColumns = static_cast<int>(size.x() / mStartsCell) + 1;
+    mStartsRows = static_cast<int>(size.y() / mStartsCell) + 1;
+    mStarts.assign(size_t(mStartsColumns) * mStartsRows, UINT32_MAX);
+    for (uint32_t t = 0; t < triangleCount(); ++t) fileStart(t);
+}
+
+size_t Triangulation::startCell(const QVector2D &point) const
+{
+    const int column = std::clamp(static_cast<int>((point.x() - mStartsMin.x()) / mStartsCell), 0, mStartsColumns - 1);
+    const int row = std::clamp(static_cast<int>((point.y() - mStartsMin.y()) / mStartsCell), 0, mStartsRows - 1);
+    return size_t(row) * mStartsColumns + column;
+}
+
+void Triangulation::fileStart(uint32_t t)
+{
+    if (mStarts.empty()) return;
+    mStarts[startCell((mPoints[mTriangles[3 * t]] + mPoints[mTriangles[3 * t + 1]] + mPoints[mTriangles[3 * t + 2]]) / 3.0f)] = t;
+}
+
+void Triangulation::buildFromPending()
+{
+    if (mPending.size() < 3) return;
+    std::vector<QVector2D> points(mPending.size());
+    for (size_t i = 0; i < mPending.size(); ++i) points[i] = mPoints[mPending[i]];
+    std::vector<uint32_t> indices;
+    std::vector<int> halfedges;
+    Delaunay::Triangulate(points, indices, &halfedges);
+    if (indices.empty()) return; // Still all on one line
+
+    mTriangles.resize(indices.size());
+    for (size_t e = 0; e < indices.size(); ++e) {
+        mTriangles[e] = mPending[indices[e]];
+        mPointEdge[mTriangles[e]] = static_cast<int>(e);
+    }
+    mHalfedges.swap(halfedges);
+    for (uint32_t t = 0; t < triangleCount(); ++t) mChanged.push_back(t);
+
+    mPending.erase(std::remove_if(mPending.begin(), mPending.end(), [&](uint32_t i) { return mPointEdge[i] >= 0; }), mPending.end());
+    mLast = 0;
+    buildStarts();
+    queueDuplicates();
+}
+
+void Triangulation::queueDuplicates()
+{
+    if (mTriangles.empty()) return;
+    mPending.erase(std::remove_if(mPending.begin(), mPending.end(), [&](uint32_t i)
+    {
+        const int where = locate(mPoints[i]);
+        for (int k = 0; k < 3 && where >= 0; ++k)
+        {
+            const uint32_t corner = mTriangles[3 * where + k];
+            if (mPoints[corner] == mPoints[i]) {
+                mDuplicates.emplace(corner, i);
+                return true;
+            }
+        }
+        return false;   // A near duplicate the sweep couldn't place, it gets another try after each removal
+    }), mPending.end());
+}
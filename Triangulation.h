@@ -0,0 +1,100 @@
+#ifndef TRIANGULATION_H
+#define TRIANGULATION_H
+
+#include <QVector2D>
+#include <unordered_map>
+#include <vector>
+
+// Delaunay triangulation that stays editable after it is built, for survey updates and live scan increments
+// Stored as halfedges like Delaunay::Triangulate() returns them: halfedge 3t + k runs from corner k to corner k + 1 of triangle t,
+// and its twin runs the other way in the neighbouring triangle (-1 on the convex hull). Triangles wind the same way, normals up
+// Edits only touch the triangles around the point and keep the slots dense: a freed slot is refilled with the last triangle
+// The slots that changed are collected until takeChanges(), so a copy of indices() (an index buffer) can be patched instead of replaced
+class Triangulation
+{
+public:
+    Triangulation() = default;
+    explicit Triangulation(const std::vector<QVector2D>& points);
+
+    // Triangulates points with Delaunay::Triangulate()
+    void build(const std::vector<QVector2D>& points);
+    // Takes over a triangulation that was already made of points (e.g. by Delaunay::TriangulateTiled()), only the twins are worked out
+    void build(const std::vector<QVector2D>& points, const std::vector<uint32_t>& indices);
+
+    // Adds point and returns its index (points are never renumbered), -1 when there already is a point at that position
+    // The point is connected to the triangle or hull edges around it and the triangulation is flipped back to Delaunay
+    int insert(const QVector2D& point);
+    // Takes point out and retriangulates the hole it leaves, false if it isn't in the triangulation or waiting to go in
+    // A point skipped by build() for duplicating this one goes in at the same spot (insert() turns duplicates away instead)
+    bool remove(uint32_t point);
+
+    bool empty() const { return mTriangles.empty(); }
+    size_t triangleCount() const { return mTriangles.size() / 3; }
+    const std::vector<uint32_t>& indices() const { return mTriangles; }
+    const std::vector<int>& halfedges() const { return mHalfedges; }
+    const std::vector<QVector2D>& points() const { return mPoints; }
+    // False for removed and duplicate points, and for points that wait for enough others to make a first triangle
+    bool contains(uint32_t point) const { return point < mPointEdge.size() && mPointEdge[point] >= 0; }
+
+    // Triangle containing point, or with point on one of its edges. When point is outside the hull it is the hull halfedge point is
+    // outside of, returned as -2 - halfedge, and -1 when empty(). Walks from the last triangle found, so points close together are quick
+    int locate(const QVector2D& point) const;
+    // The same, starting from and updating ioHint instead. It only reads the triangulation, so several threads can locate at once
+    int locate(const QVector2D& point, uint32_t& ioHint) const;
+
+    // The triangles with point as a corner, in winding order around it
+    void trianglesAround(uint32_t point, std::vector<uint32_t>& oTriangles) const;
+
+    // Sorted slots whose indices changed since the last call, slots past triangleCount() were dropped off the end
+    void takeChanges(std::vector<uint32_t>& oTriangles);
+
+private:
+    static int next(int e) { return e % 3 == 2 ? e - 2 : e + 1; }
+    static int previous(int e) { return e % 3 == 0 ? e + 2 : e - 1; }
+
+    // Connects point p (already in mPoints) to the triangulation, false when it duplicates a point that is in it
+    bool place(uint32_t p);
+
+    // Visibility walk from ioTriangle for at most maxSteps triangles, -1 if it didn't get there. ioTriangle is where it stopped
+    int walk(const QVector2D& point, uint32_t& ioTriangle, size_t maxSteps) const;
+
+    void link(int a, int b);
+    void setTriangle(uint32_t t, uint32_t i0, uint32_t i1, uint32_t i2);
+    uint32_t addTriangle(uint32_t i0, uint32_t i1, uint32_t i2);
+    // Moves the last triangle into slot t, nothing may point at t any more
+    void freeTriangle(uint32_t t);
+    // Lawson flips, starting from the halfedges on mEdgeStack, until every edge they lead to is locally Delaunay
+    void legalize();
+    // Hull halfedge after / before hull halfedge e
+    int hullNext(int e) const;
+    int hullPrevious(int e) const;
+    // Triangulates from scratch once the waiting points are enough for a first triangle
+    void buildFromPending();
+    // Moves the pending points that have the position of a point in the triangulation to mDuplicates
+    void queueDuplicates();
+    // Files a triangle under every cell of a coarse grid, for locate() to start from when the hint is far off
+    void buildStarts();
+    // The cell of the grid point is in, points outside it go to the nearest cell on the border
+    size_t startCell(const QVector2D& point) const;
+    // Files triangle t under the cell of its center, every edit that writes a triangle calls it so the grid follows the edits
+    void fileStart(uint32_t t);
+
+    static constexpr size_t ShortWalk = 4;  // Steps locate() takes from the hint before it starts over from the grid
+
+    std::vector<QVector2D> mPoints;
+    std::vector<uint32_t> mTriangles;
+    std::vector<int> mHalfedges;
+    std::vector<int> mPointEdge;        // A halfedge starting at each point, -1 when the point isn't in the triangulation
+    std::vector<uint32_t> mPending;     // Points that couldn't make a triangle yet (too few, or all on one line)
+    std::unordered_multimap<uint32_t, uint32_t> mDuplicates;    // Point in the triangulation -> a point at the same position waiting for it to go
+    std::vector<uint32_t> mChanged;
+    std::vector<int> mEdgeStack;
+    mutable uint32_t mLast{0};          // Where the next locate() starts
+    std::vector<uint32_t> mStarts;      // See buildStarts(), row major
+    QVector2D mStartsMin;
+    float mStartsCell{1.0f};
+    int mStartsColumns{0};
+    int mStartsRows{0};
+};
+
+#endif // TRIANGULATION_H
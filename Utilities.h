@@ -15,6 +15,7 @@ struct BufferHandle
 {
     VkDeviceMemory mBufferMemory{ VK_NULL_HANDLE };
     VkBuffer mBuffer{ VK_NULL_HANDLE };
+    VkDeviceSize mSize{ 0 };
 };
 
 struct TextureHandle
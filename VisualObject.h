@@ -25,12 +25,17 @@ public:
     inline VkBuffer& getIBuffer() { return mIndexBuffer.mBuffer; }
     inline void setIBuffer(VkBuffer bufferIn) { mIndexBuffer.mBuffer = bufferIn; }
     inline void setIBufferMemory(VkDeviceMemory bufferMemoryIn) { mIndexBuffer.mBufferMemory = bufferMemoryIn; }
+    inline BufferHandle& getVBufferHandle() { return mVertexBuffer; }
+    inline BufferHandle& getIBufferHandle() { return mIndexBuffer; }
     inline void setName(std::string name) { mName = name; }
     inline std::string getName() const { return mName; }
     inline int getDrawType() const { return drawType; }
     inline QMatrix4x4 getMatrix() const {return mMatrix;}
 	inline std::vector<Vertex> getVertices() const { return mVertices; }
 	inline std::vector<uint32_t> getIndices() const { return mIndices; }
+    inline size_t vertexCount() const { return mVertices.size(); } // Without copying the vertices like getVertices() does
+    inline const std::vector<Vertex>& vertices() const { return mVertices; }
+    inline const std::vector<uint32_t>& indices() const { return mIndices; }
 
     void setPosition(float x, float y, float z);
     void setPosition(const QVector3D& newPosition) { setPosition(newPosition.x(), newPosition.y(), newPosition.z()); };
@@ -52,7 +57,7 @@ protected:
 	BufferHandle mIndexBuffer;
     //VkPrimitiveTopology mTopology{ VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST }; //not used
 
-    int drawType{ 0 }; // 0 = fill color, 1 = line color, 2 = fill phong
+    int drawType{ 0 }; // 0 = fill color, 1 = line color, 2 = fill phong, 3 = phong points, 4 = color points
 };
 
 #endif // VISUALOBJECT_H
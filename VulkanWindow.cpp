@@ -60,6 +60,15 @@ void VulkanWindow::keyPressEvent(QKeyEvent *event)
         dynamic_cast<Renderer*>(mRenderer)->mCamera.rotate(45, 0.0f, 0.0f, 1.0f);
     }
 
+    //Switches the physics between the octree and the BVH to compare them on the same scene
+    if(event->key() == Qt::Key_B)
+    {
+        PhysicsSystem& physics = dynamic_cast<Renderer*>(mRenderer)->mPhysicsSystem;
+        const bool toBvh = physics.collisionIndex() == PhysicsSystem::CollisionIndex::Octree;
+        physics.setCollisionIndex(toBvh ? PhysicsSystem::CollisionIndex::Bvh : PhysicsSystem::CollisionIndex::Octree);
+        qDebug("Collision index: %s", toBvh ? "BVH" : "Octree");
+    }
+
     //    You get the keyboard input like this
     if(event->key() == Qt::Key_W)
     {
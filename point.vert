@@ -0,0 +1,37 @@
+#version 450
+
+//PointLod::Point: the position is 0-1 inside its tile (16 bit unorm) and the model matrix scales it back out, color is 8 bit unorm
+//Also used with the plain Vertex layout for drawType 4, where both are floats
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 color;
+
+layout(location = 0) out vec3 vColor;
+
+layout(push_constant) uniform mod {
+    mat4 model;
+    vec3 objectColor;
+} uModel;
+
+layout(set = 0, binding = 0) uniform cam {
+    mat4 view;
+    mat4 projection;
+} uBuffer;
+
+out gl_PerVertex {
+    vec4 gl_Position;
+    float gl_PointSize;
+};
+
+//Same as color.vert, but point lists need an explicit point size and the input is the packed point layout
+void main()
+{
+    //if objectcolor is not set (== black), use vertex color
+    float colorTest = uModel.objectColor.r + uModel.objectColor.g +uModel.objectColor.b;
+    if (colorTest < 0.001)
+        vColor = color;
+    //else use objectcolor
+    else
+        vColor = uModel.objectColor;
+    gl_Position =   uBuffer.projection * uBuffer.view * uModel.model * vec4(position, 1.0);
+    gl_PointSize = 2.0;
+}
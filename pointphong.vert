@@ -0,0 +1,38 @@
+#version 450
+
+layout(location = 0) in vec3 vertexPosition;
+layout(location = 1) in vec3 vertexNormal;
+layout(location = 2) in vec2 vertexUV;          //not used when we don't use textures
+
+layout(location = 0) out vec3 fragmentPosition;
+layout(location = 1) out vec3 normalTransposed;
+layout(location = 2) out vec2 UV;
+layout(location = 3) out vec3 objectColor;
+
+layout(push_constant) uniform mod {
+    mat4 mMatrix;
+    vec3 objectColor;
+} uModel;
+
+layout(std140, binding = 0) uniform buf {
+   mat4 vMatrix;
+   mat4 pMatrix;
+} uBuffer;
+
+out gl_PerVertex {
+    vec4 gl_Position;
+    float gl_PointSize;
+};
+
+//Same as phong.vert, but point lists need an explicit point size
+//Used for point clouds that have normals from PointNormals instead of a triangulation
+void main()
+{
+   fragmentPosition = vec3(uModel.mMatrix * vec4(vertexPosition, 1.0));
+   normalTransposed = mat3(transpose(inverse(uModel.mMatrix))) * vertexNormal;
+
+   UV = vertexUV;
+   objectColor = uModel.objectColor;
+   gl_Position = uBuffer.pMatrix * uBuffer.vMatrix * uModel.mMatrix * vec4(vertexPosition, 1.0);
+   gl_PointSize = 2.0;
+}